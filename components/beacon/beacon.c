@@ -0,0 +1,133 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "esp_log.h"
+#include "esp_wifi.h"
+#include "lwip/sockets.h"
+#include "mbedtls/md.h"
+#include "mdns.h"
+#include "beacon.h"
+
+static const char *TAG = "BEACON";
+
+static int s_sock = -1;
+static struct sockaddr_in s_addr;
+static char s_key[64];
+static uint8_t s_mac[6];
+static beacon_stats_t s_stats = {0};
+
+esp_err_t beacon_parse_uri(const char *uri, char *group, uint16_t *port)
+{
+    if (strncmp(uri, "udp://", 6) != 0) return ESP_ERR_INVALID_ARG;
+    uri += 6;
+
+    const char *colon = strchr(uri, ':');
+    size_t len = colon ? (size_t)(colon - uri) : strlen(uri);
+    if (len == 0 || len > 15) return ESP_ERR_INVALID_ARG;
+    memcpy(group, uri, len);
+    group[len] = '\0';
+
+    *port = BEACON_DEFAULT_PORT;
+    if (colon) {
+        long value = strtol(colon + 1, NULL, 10);
+        if (value <= 0 || value > 65535) return ESP_ERR_INVALID_ARG;
+        *port = (uint16_t)value;
+    }
+
+    // 224.0.0.0/4
+    struct in_addr addr;
+    if (inet_aton(group, &addr) == 0 || (ntohl(addr.s_addr) >> 28) != 0xE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t mdns_announce(const char *serial, uint16_t http_port, const char *group, uint16_t port)
+{
+    char hostname[32];
+    char beacon[24];
+
+    // Имя хоста: serial в нижнем регистре, только допустимые символы
+    size_t i;
+    for (i = 0; serial[i] && i < sizeof(hostname) - 1; i++) {
+        char c = serial[i];
+        if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+        hostname[i] = ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')) ? c : '-';
+    }
+    hostname[i] = '\0';
+    snprintf(beacon, sizeof(beacon), "%s:%u", group, port);
+
+    esp_err_t ret = mdns_init();
+    if (ret == ESP_OK) ret = mdns_hostname_set(hostname);
+    if (ret == ESP_OK) ret = mdns_instance_name_set(serial);
+    if (ret != ESP_OK) return ret;
+
+    mdns_txt_item_t txt[] = {
+        { "serial", serial },
+        { "version", TELEMETRY_VERSION },
+        { "beacon", beacon },
+    };
+    return mdns_service_add(serial, BEACON_MDNS_SERVICE, "_tcp", http_port,
+                            txt, sizeof(txt) / sizeof(txt[0]));
+}
+
+esp_err_t beacon_start(const char *group, uint16_t port, const char *serial,
+                       const char *key, uint16_t http_port)
+{
+    if (s_sock >= 0) return ESP_ERR_INVALID_STATE;
+
+    memset(&s_addr, 0, sizeof(s_addr));
+    s_addr.sin_family = AF_INET;
+    s_addr.sin_port = htons(port);
+    if (inet_aton(group, &s_addr.sin_addr) == 0) return ESP_ERR_INVALID_ARG;
+
+    s_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s_sock < 0) return ESP_FAIL;
+
+    // Кадры не выходят за пределы локального сегмента
+    uint8_t ttl = BEACON_TTL;
+    setsockopt(s_sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+
+    strncpy(s_key, key, sizeof(s_key) - 1);
+    esp_wifi_get_mac(WIFI_IF_STA, s_mac);
+
+    esp_err_t ret = mdns_announce(serial, http_port, group, port);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "mDNS announce failed: %s", esp_err_to_name(ret));
+    }
+
+    s_stats.enabled = true;
+    ESP_LOGI(TAG, "Beacon to %s:%u, mDNS %s._tcp", group, port, BEACON_MDNS_SERVICE);
+    return ESP_OK;
+}
+
+esp_err_t beacon_send(const telemetry_sample_t *sample, int rssi, uint16_t interval_s)
+{
+    uint8_t frame[TELEMETRY_FRAME_SIZE + TELEMETRY_FRAME_TAG_SIZE];
+    uint8_t tag[32];
+
+    if (s_sock < 0) return ESP_OK;
+
+    telemetry_encode_frame(s_mac, rssi, s_stats.seq++, interval_s, sample, frame);
+    int ret = mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256),
+                              (const unsigned char *)s_key, strlen(s_key),
+                              frame, TELEMETRY_FRAME_SIZE, tag);
+    if (ret != 0) {
+        s_stats.errors++;
+        return ESP_FAIL;
+    }
+    memcpy(frame + TELEMETRY_FRAME_SIZE, tag, TELEMETRY_FRAME_TAG_SIZE);
+
+    if (sendto(s_sock, frame, sizeof(frame), 0, (struct sockaddr *)&s_addr, sizeof(s_addr)) < 0) {
+        // Нет сети - кадр теряется, приемник увидит пропуск в seq
+        s_stats.errors++;
+        return ESP_FAIL;
+    }
+    s_stats.sent++;
+    return ESP_OK;
+}
+
+void beacon_get_stats(beacon_stats_t *stats)
+{
+    *stats = s_stats;
+}
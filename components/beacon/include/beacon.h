@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "telemetry.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * UDP маяк: каждое измерение рассылается многоадресным кадром
+ * (формат см. telemetry_encode_frame), а устройство объявляет себя по
+ * mDNS как _hydra._tcp. Шлюз собирает данные пассивно, без соединений
+ * с каждым устройством (tools/beacon_listen.py).
+ */
+
+#define BEACON_DEFAULT_GROUP    "239.255.76.72"
+#define BEACON_DEFAULT_PORT     7272
+#define BEACON_TTL              1
+#define BEACON_MDNS_SERVICE     "_hydra"
+
+typedef struct {
+    bool enabled;
+    uint32_t sent;
+    uint32_t errors;
+    uint32_t seq;
+} beacon_stats_t;
+
+/**
+ * @brief Разбор адреса вида udp://239.255.76.72:7272 (порт необязателен)
+ * @param uri Адрес
+ * @param group Буфер для группы (не меньше 16 байт)
+ * @param port Указатель для сохранения порта
+ * @return ESP_OK при успехе, ESP_ERR_INVALID_ARG если адрес не многоадресный
+ */
+esp_err_t beacon_parse_uri(const char *uri, char *group, uint16_t *port);
+
+/**
+ * @brief Включение маяка и объявления mDNS
+ * @param group Многоадресная группа
+ * @param port UDP порт
+ * @param serial Имя устройства (имя экземпляра mDNS)
+ * @param key Ключ подписи кадров
+ * @param http_port Порт веб-сервера для записи _hydra._tcp
+ * @return ESP_OK при успехе
+ */
+esp_err_t beacon_start(const char *group, uint16_t port, const char *serial,
+                       const char *key, uint16_t http_port);
+
+/**
+ * @brief Отправка кадра с измерением (ничего не делает, если маяк выключен)
+ * @param sample Измерение
+ * @param rssi Уровень сигнала (dBm)
+ * @param interval_s Период отправки (с)
+ * @return ESP_OK при успехе
+ */
+esp_err_t beacon_send(const telemetry_sample_t *sample, int rssi, uint16_t interval_s);
+
+/**
+ * @brief Получение статистики
+ * @param stats Указатель для сохранения статистики
+ */
+void beacon_get_stats(beacon_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -2,7 +2,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
-#include "driver/i2c.h"
+#include "dlog.h"
 #include "bme280.h"
 
 static const char *TAG = "BME280";
@@ -26,9 +26,12 @@ static const char *TAG = "BME280";
 #define BME280_OVERSAMP_TEMP    0x01
 #define BME280_OVERSAMP_PRES    0x01
 #define BME280_OVERSAMP_HUM     0x01
-#define BME280_MODE_NORMAL      0x03
+#define BME280_MODE_SLEEP       0x00
+#define BME280_MODE_FORCED      0x01
+#define BME280_STATUS_MEASURING 0x08
 #define BME280_STANDBY_500      0x00
 #define BME280_FILTER_OFF       0x00
+#define BME280_CONFIG           ((BME280_STANDBY_500 << 5) | (BME280_FILTER_OFF << 2))
 
 // Структура для калибровочных данных
 typedef struct {
@@ -65,7 +68,24 @@ static esp_err_t bme280_read_reg(uint8_t reg, uint8_t *data)
     i2c_master_write_byte(cmd, (BME280_ADDR << 1) | I2C_MASTER_READ, true);
     i2c_master_read_byte(cmd, data, I2C_MASTER_LAST_NACK);
     i2c_master_stop(cmd);
-    esp_err_t ret = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, pdMS_TO_TICKS(1000));
+    esp_err_t ret = i2c_bus_cmd(BME280_ADDR, cmd);
+    i2c_cmd_link_delete(cmd);
+    return ret;
+}
+
+// Чтение нескольких регистров одной транзакцией: датчик не обновляет
+// выходные регистры, пока идет пакетное чтение, поэтому T, P и H из одного измерения
+static esp_err_t bme280_read_regs(uint8_t reg, uint8_t *data, size_t len)
+{
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (BME280_ADDR << 1) | I2C_MASTER_WRITE, true);
+    i2c_master_write_byte(cmd, reg, true);
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (BME280_ADDR << 1) | I2C_MASTER_READ, true);
+    i2c_master_read(cmd, data, len, I2C_MASTER_LAST_NACK);
+    i2c_master_stop(cmd);
+    esp_err_t ret = i2c_bus_cmd(BME280_ADDR, cmd);
     i2c_cmd_link_delete(cmd);
     return ret;
 }
@@ -78,23 +98,21 @@ static esp_err_t bme280_write_reg(uint8_t reg, uint8_t data)
     i2c_master_write_byte(cmd, reg, true);
     i2c_master_write_byte(cmd, data, true);
     i2c_master_stop(cmd);
-    esp_err_t ret = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, pdMS_TO_TICKS(1000));
+    esp_err_t ret = i2c_bus_cmd(BME280_ADDR, cmd);
     i2c_cmd_link_delete(cmd);
     return ret;
 }
 
 static esp_err_t bme280_read_calib_data(void)
 {
-    uint8_t calib[32];
+    uint8_t calib[26];
     esp_err_t ret;
     
     // Чтение калибровочных данных температуры и давления
-    for (int i = 0; i < 26; i++) {
-        ret = bme280_read_reg(0x88 + i, &calib[i]);
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to read calibration data at 0x%02X", 0x88 + i);
-            return ret;
-        }
+    ret = bme280_read_regs(0x88, calib, sizeof(calib));
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to read calibration data at 0x88");
+        return ret;
     }
     
     // Распаковка калибровочных данных
@@ -114,12 +132,10 @@ static esp_err_t bme280_read_calib_data(void)
     
     // Чтение калибровочных данных влажности
     uint8_t h_calib[7];
-    for (int i = 0; i < 7; i++) {
-        ret = bme280_read_reg(0xE1 + i, &h_calib[i]);
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to read humidity calibration data at 0x%02X", 0xE1 + i);
-            return ret;
-        }
+    ret = bme280_read_regs(0xE1, h_calib, sizeof(h_calib));
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to read humidity calibration data at 0xE1");
+        return ret;
     }
     
     calib_data.dig_H2 = (h_calib[1] << 8) | h_calib[0];
@@ -128,6 +144,12 @@ static esp_err_t bme280_read_calib_data(void)
     calib_data.dig_H5 = (h_calib[5] << 4) | (h_calib[4] >> 4);
     calib_data.dig_H6 = h_calib[6];
     
+    // Нули или 0xFF вместо констант - чтение пришлось на сбой шины
+    if (calib_data.dig_T1 == 0 || calib_data.dig_P1 == 0 ||
+        calib_data.dig_T1 == 0xFFFF || calib_data.dig_P1 == 0xFFFF) {
+        ESP_LOGE(TAG, "Calibration data invalid");
+        return ESP_ERR_INVALID_RESPONSE;
+    }
     return ESP_OK;
 }
 
@@ -174,16 +196,15 @@ esp_err_t bme280_init(void)
     }
     
     // Настройка конфигурации
-    ret = bme280_write_reg(BME280_REG_CONFIG, 
-        (BME280_STANDBY_500 << 5) | (BME280_FILTER_OFF << 2));
+    ret = bme280_write_reg(BME280_REG_CONFIG, BME280_CONFIG);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to configure BME280: %s", esp_err_to_name(ret));
         return ret;
     }
     
-    // Настройка измерений
+    // Настройка измерений: датчик спит, измерение запускается bme280_trigger
     ret = bme280_write_reg(BME280_REG_CTRL_MEAS, 
-        (BME280_OVERSAMP_TEMP << 5) | (BME280_OVERSAMP_PRES << 2) | BME280_MODE_NORMAL);
+        (BME280_OVERSAMP_TEMP << 5) | (BME280_OVERSAMP_PRES << 2) | BME280_MODE_SLEEP);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to configure measurements: %s", esp_err_to_name(ret));
         return ret;
@@ -193,26 +214,63 @@ esp_err_t bme280_init(void)
     return ESP_OK;
 }
 
-esp_err_t bme280_read(float *temperature, float *humidity, float *pressure)
+uint32_t bme280_measure_time_us(void)
+{
+    // Максимальное время измерения по datasheet (раздел 9.1); коды 1..5
+    // настроек передискретизации соответствуют x1..x16
+    static const uint8_t oversampling[] = {0, 1, 2, 4, 8, 16};
+    uint32_t t = oversampling[BME280_OVERSAMP_TEMP];
+    uint32_t p = oversampling[BME280_OVERSAMP_PRES];
+    uint32_t h = oversampling[BME280_OVERSAMP_HUM];
+    return 1250 + 2300 * t + (p ? 2300 * p + 575 : 0) + (h ? 2300 * h + 575 : 0);
+}
+
+esp_err_t bme280_trigger(void)
+{
+    esp_err_t ret = bme280_write_reg(BME280_REG_CTRL_MEAS,
+        (BME280_OVERSAMP_TEMP << 5) | (BME280_OVERSAMP_PRES << 2) | BME280_MODE_FORCED);
+    if (ret != ESP_OK) {
+        DLOGE(TAG, "Failed to start measurement: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+esp_err_t bme280_collect(float *temperature, float *humidity, float *pressure)
 {
     uint8_t data[8];
+    uint8_t ctrl[4];
     int32_t adc_T, adc_P, adc_H;
     int32_t var1, var2;
     int32_t t_fine;
 
-    // Чтение данных
-    for (int i = 0; i < 8; i++) {
-        esp_err_t ret = bme280_read_reg(BME280_REG_PRESS_MSB + i, &data[i]);
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to read sensor data: %s", esp_err_to_name(ret));
-            return ret;
-        }
+    // ctrl_hum, status, ctrl_meas, config одним чтением: заодно видно,
+    // не сбросил ли провал питания настройки датчика
+    esp_err_t ret = bme280_read_regs(BME280_REG_CTRL_HUM, ctrl, sizeof(ctrl));
+    if (ret == ESP_OK && (ctrl[1] & BME280_STATUS_MEASURING)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (ret == ESP_OK && (ctrl[0] != BME280_OVERSAMP_HUM || ctrl[3] != BME280_CONFIG)) {
+        DLOGW(TAG, "Configuration lost: 0x%02x 0x%02x", ctrl[0], ctrl[3]);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    if (ret == ESP_OK) {
+        ret = bme280_read_regs(BME280_REG_PRESS_MSB, data, sizeof(data));
+    }
+    if (ret != ESP_OK) {
+        DLOGE(TAG, "Failed to read sensor data: %s", esp_err_to_name(ret));
+        return ret;
     }
 
     adc_P = (data[0] << 12) | (data[1] << 4) | (data[2] >> 4);
     adc_T = (data[3] << 12) | (data[4] << 4) | (data[5] >> 4);
     adc_H = (data[6] << 8) | data[7];
 
+    // Значения "измерение пропущено": датчик не получил команду запуска
+    if (adc_T == 0x80000 || adc_H == 0x8000) {
+        DLOGW(TAG, "Measurement skipped");
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
     // Компенсация температуры
     var1 = ((((adc_T >> 3) - ((int32_t)calib_data.dig_T1 << 1))) * 
             ((int32_t)calib_data.dig_T2)) >> 11;
@@ -233,7 +291,7 @@ esp_err_t bme280_read(float *temperature, float *humidity, float *pressure)
     
     if (var1 == 0) {
         *pressure = 0;
-        ESP_LOGW(TAG, "Pressure calculation failed (division by zero)");
+        DLOGW(TAG, "Pressure calculation failed (division by zero)");
     } else {
         int64_t p = (((uint32_t)(1048576 - adc_P) - (var2 >> 12))) * 3125;
         p = (p / var1) * 2;
@@ -258,4 +316,18 @@ esp_err_t bme280_read(float *temperature, float *humidity, float *pressure)
     *humidity = (v_x1_u32r >> 12) / 1024.0f;
 
     return ESP_OK;
-}
\ No newline at end of file
+}
+
+esp_err_t bme280_read(float *temperature, float *humidity, float *pressure)
+{
+    esp_err_t ret = bme280_trigger();
+    if (ret != ESP_OK) return ret;
+
+    vTaskDelay(pdMS_TO_TICKS(bme280_measure_time_us() / 1000) + 1);
+    for (int i = 0; i < 5; i++) {
+        ret = bme280_collect(temperature, humidity, pressure);
+        if (ret != ESP_ERR_INVALID_STATE) break;
+        vTaskDelay(1);
+    }
+    return ret;
+}
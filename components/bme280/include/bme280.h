@@ -1,24 +1,49 @@
 #pragma once
 
+#include <stdint.h>
 #include "esp_err.h"
-#include "driver/i2c.h"
+#include "i2c_bus.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// I2C определения
-#define I2C_MASTER_NUM              I2C_NUM_0
 #define BME280_ADDR                 0x76
 
 /**
- * @brief Инициализация BME280
- * @return ESP_OK при успехе
+ * @brief Инициализация BME280 (сброс, калибровка, настройка); повторный вызов
+ *        восстанавливает датчик после провала питания
+ * @return ESP_OK при успехе, ESP_ERR_INVALID_RESPONSE при негодной калибровке
  */
 esp_err_t bme280_init(void);
 
 /**
- * @brief Чтение данных с BME280
+ * @brief Максимальное время измерения при текущих настройках (datasheet)
+ * @return Время (мкс)
+ */
+uint32_t bme280_measure_time_us(void);
+
+/**
+ * @brief Запуск одного измерения (forced mode)
+ *
+ * Пока идет измерение, шина I2C и CPU свободны. Результат забирается
+ * bme280_collect не раньше чем через bme280_measure_time_us().
+ * @return ESP_OK при успехе
+ */
+esp_err_t bme280_trigger(void);
+
+/**
+ * @brief Чтение результата измерения, запущенного bme280_trigger
+ * @param temperature Указатель для сохранения температуры (°C)
+ * @param humidity Указатель для сохранения влажности (%)
+ * @param pressure Указатель для сохранения давления (hPa)
+ * @return ESP_OK при успехе, ESP_ERR_INVALID_STATE если измерение еще идет,
+ *         ESP_ERR_INVALID_RESPONSE если датчик потерял настройки (нужен bme280_init)
+ */
+esp_err_t bme280_collect(float *temperature, float *humidity, float *pressure);
+
+/**
+ * @brief Измерение с ожиданием результата (bme280_trigger + bme280_collect)
  * @param temperature Указатель для сохранения температуры (°C)
  * @param humidity Указатель для сохранения влажности (%)
  * @param pressure Указатель для сохранения давления (hPa)
@@ -0,0 +1,481 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "cJSON.h"
+#include "config_store.h"
+#include "jsonstr.h"
+
+static const char *TAG = "CONFIG";
+
+#define VERSION_KEY     "version"
+#define SECRET_MASK     "***"
+#define LINE_LEN        128
+
+typedef enum {
+    FIELD_STR,
+    FIELD_U32,
+    FIELD_I32,
+} field_type_t;
+
+typedef struct {
+    const char *key;            // Ключ NVS (до 15 символов) и имя в JSON
+    field_type_t type;
+    uint8_t flags;
+    uint16_t offset;
+    uint16_t size;
+    int32_t min;                // Число - диапазон, строка - наименьшая длина
+    int32_t max;
+    const char *(*check)(const void *value);
+} field_t;
+
+#define FIELD(name, t, f, lo, hi, fn) \
+    { #name, t, f, offsetof(app_config_t, name), sizeof(((app_config_t *)0)->name), lo, hi, fn }
+
+// В JSON строки экранируются (jsonstr), управляющие символы не допускаются
+// ради заголовков HTTP, журнала и построчного config.txt
+static const char *check_text(const void *value)
+{
+    for (const char *p = value; *p; p++) {
+        if ((unsigned char)*p < 0x20) return "must not contain control characters";
+    }
+    return NULL;
+}
+
+static const char *check_name(const void *value)
+{
+    if (strpbrk(value, "/+#")) return "must not contain / + #";
+    return check_text(value);
+}
+
+static const char *check_psk(const void *value)
+{
+    size_t len = strlen(value);
+    if (len != 0 && len < 8) return "must be empty or 8..64 characters";
+    return check_text(value);
+}
+
+static const char *check_server_url(const void *value)
+{
+    if (strncmp(value, "http://", 7) != 0 && strncmp(value, "https://", 8) != 0) {
+        return "must start with http:// or https://";
+    }
+    return check_text(value);
+}
+
+static const char *check_mqtt_uri(const void *value)
+{
+    if (*(const char *)value && strncmp(value, "mqtt://", 7) != 0) return "must be empty or mqtt://";
+    return check_text(value);
+}
+
+static const char *check_beacon_uri(const void *value)
+{
+    if (*(const char *)value && strncmp(value, "udp://", 6) != 0) return "must be empty or udp://";
+    return check_text(value);
+}
+
+// GPIO6-11 заняты флеш-памятью
+static const char *check_gpio(const void *value)
+{
+    int32_t gpio = *(const int32_t *)value;
+    if (gpio >= 6 && gpio <= 11) return "GPIO6-11 are used by flash";
+    return NULL;
+}
+
+static const field_t s_fields[CONFIG_FIELD_COUNT] = {
+    [CONFIG_DEVICE_NAME]   = FIELD(device_name,   FIELD_STR, CONFIG_RESTART, 1, 0, check_name),
+    [CONFIG_AKEY]          = FIELD(akey,          FIELD_STR, CONFIG_RESTART | CONFIG_SECRET, 1, 0, check_text),
+    [CONFIG_WIFI_SSID]     = FIELD(wifi_ssid,     FIELD_STR, CONFIG_RESTART, 0, 0, check_text),
+    [CONFIG_WIFI_PASS]     = FIELD(wifi_pass,     FIELD_STR, CONFIG_RESTART | CONFIG_SECRET, 0, 0, check_psk),
+    [CONFIG_AP_SSID]       = FIELD(ap_ssid,       FIELD_STR, CONFIG_RESTART, 1, 0, check_text),
+    [CONFIG_AP_PASS]       = FIELD(ap_pass,       FIELD_STR, CONFIG_RESTART | CONFIG_SECRET, 8, 0, check_text),
+    [CONFIG_SERVER_URL]    = FIELD(server_url,    FIELD_STR, CONFIG_RESTART, 1, 0, check_server_url),
+    [CONFIG_MQTT_URI]      = FIELD(mqtt_uri,      FIELD_STR, CONFIG_RESTART, 0, 0, check_mqtt_uri),
+    [CONFIG_BEACON_URI]    = FIELD(beacon_uri,    FIELD_STR, CONFIG_RESTART, 0, 0, check_beacon_uri),
+    [CONFIG_SAMPLE_MS]     = FIELD(sample_ms,     FIELD_U32, 0, 1000, 600000, NULL),
+    [CONFIG_PUBLISH_MS]    = FIELD(publish_ms,    FIELD_U32, 0, 10000, 86400000, NULL),
+    [CONFIG_SENSOR_MS]     = FIELD(sensor_ms,     FIELD_U32, 0, 1000, 600000, NULL),
+    [CONFIG_AVG_COUNT]     = FIELD(avg_count,     FIELD_U32, 0, 1, CONFIG_AVG_MAX, NULL),
+    [CONFIG_ALTITUDE]      = FIELD(altitude,      FIELD_I32, 0, -500, 9000, NULL),
+    [CONFIG_STATS_SHORT_S] = FIELD(stats_short_s, FIELD_U32, CONFIG_RESTART, 10, 604800, NULL),
+    [CONFIG_STATS_LONG_S]  = FIELD(stats_long_s,  FIELD_U32, CONFIG_RESTART, 10, 604800, NULL),
+    [CONFIG_SDA_IO]        = FIELD(sda_io,        FIELD_I32, CONFIG_RESTART, 0, 16, check_gpio),
+    [CONFIG_SCL_IO]        = FIELD(scl_io,        FIELD_I32, CONFIG_RESTART, 0, 16, check_gpio),
+    [CONFIG_BUTTON1_IO]    = FIELD(button1_io,    FIELD_I32, CONFIG_RESTART, 0, 16, check_gpio),
+    [CONFIG_BUTTON2_IO]    = FIELD(button2_io,    FIELD_I32, CONFIG_RESTART, 0, 16, check_gpio),
+};
+
+#define NUMERIC_FIELDS  (CONFIG_BIT(CONFIG_FIELD_COUNT) - CONFIG_BIT(CONFIG_SAMPLE_MS))
+
+static app_config_t s_defaults;
+static app_config_t s_config;           // Сохраненные значения
+static config_store_stats_t s_stats = {0};
+static char s_error[80];
+
+static void *field_ptr(const field_t *field, const app_config_t *config)
+{
+    return (char *)config + field->offset;
+}
+
+static const char *check_field(const field_t *field, const app_config_t *config)
+{
+    const void *value = field_ptr(field, config);
+    if (field->type == FIELD_STR) {
+        if ((int32_t)strnlen(value, field->size) < field->min) return "is too short";
+    } else if (field->type == FIELD_U32) {
+        uint32_t v = *(const uint32_t *)value;
+        if (v < (uint32_t)field->min || v > (uint32_t)field->max) return "is out of range";
+    } else {
+        int32_t v = *(const int32_t *)value;
+        if (v < field->min || v > field->max) return "is out of range";
+    }
+    return field->check ? field->check(value) : NULL;
+}
+
+// Проверки, связывающие несколько полей
+static const char *check_all(const app_config_t *config)
+{
+    if (config->publish_ms < config->sample_ms) return "publish_ms must not be less than sample_ms";
+    if (config->stats_short_s * 1000 < config->sensor_ms || config->stats_long_s * 1000 < config->sensor_ms) {
+        return "stats windows must not be shorter than sensor_ms";
+    }
+    const int32_t pins[] = { config->sda_io, config->scl_io, config->button1_io, config->button2_io };
+    for (size_t i = 0; i < sizeof(pins) / sizeof(pins[0]); i++) {
+        for (size_t j = i + 1; j < sizeof(pins) / sizeof(pins[0]); j++) {
+            if (pins[i] == pins[j]) return "sda_io, scl_io, button1_io and button2_io must differ";
+        }
+    }
+    return NULL;
+}
+
+static esp_err_t read_field(nvs_handle handle, const field_t *field, app_config_t *config)
+{
+    void *value = field_ptr(field, config);
+    size_t len = field->size;
+    switch (field->type) {
+        case FIELD_STR: return nvs_get_str(handle, field->key, value, &len);
+        case FIELD_U32: return nvs_get_u32(handle, field->key, value);
+        default:        return nvs_get_i32(handle, field->key, value);
+    }
+}
+
+static esp_err_t write_field(nvs_handle handle, const field_t *field, const app_config_t *config)
+{
+    const void *value = field_ptr(field, config);
+    switch (field->type) {
+        case FIELD_STR: return nvs_set_str(handle, field->key, value);
+        case FIELD_U32: return nvs_set_u32(handle, field->key, *(const uint32_t *)value);
+        default:        return nvs_set_i32(handle, field->key, *(const int32_t *)value);
+    }
+}
+
+static esp_err_t save(nvs_handle handle, const app_config_t *config, uint32_t mask)
+{
+    esp_err_t ret = ESP_OK;
+    for (int i = 0; i < CONFIG_FIELD_COUNT && ret == ESP_OK; i++) {
+        if (mask & CONFIG_BIT(i)) {
+            ret = write_field(handle, &s_fields[i], config);
+        }
+    }
+    return ret;
+}
+
+// Значения из NVS; неверные заменяются значениями по умолчанию
+static void read_all(nvs_handle handle)
+{
+    for (int i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        const field_t *field = &s_fields[i];
+        esp_err_t ret = read_field(handle, field, &s_config);
+        const char *err = NULL;
+        if (ret == ESP_OK) {
+            err = check_field(field, &s_config);
+        } else if (ret != ESP_ERR_NVS_NOT_FOUND) {
+            err = esp_err_to_name(ret);
+        }
+        if (err) {
+            ESP_LOGW(TAG, "%s: %s, using default", field->key, err);
+            memcpy(field_ptr(field, &s_config), field_ptr(field, &s_defaults), field->size);
+            s_stats.invalid |= CONFIG_BIT(i);
+        }
+    }
+
+    // Несовместимые числа (периоды, выводы) - все по умолчанию, строки остаются
+    const char *err = check_all(&s_config);
+    if (err) {
+        ESP_LOGW(TAG, "%s, numeric settings reset to defaults", err);
+        for (int i = CONFIG_SAMPLE_MS; i < CONFIG_FIELD_COUNT; i++) {
+            const field_t *field = &s_fields[i];
+            memcpy(field_ptr(field, &s_config), field_ptr(field, &s_defaults), field->size);
+        }
+        s_stats.invalid |= NUMERIC_FIELDS;
+    }
+}
+
+static void import_text(config_field_t index, const char *text, uint32_t *mask)
+{
+    const field_t *field = &s_fields[index];
+    app_config_t next = s_config;
+    strncpy(field_ptr(field, &next), text, field->size - 1);
+    if (check_field(field, &next) == NULL) {
+        s_config = next;
+        *mask |= CONFIG_BIT(index);
+    }
+}
+
+static void import_number(config_field_t index, int32_t number, uint32_t *mask)
+{
+    const field_t *field = &s_fields[index];
+    app_config_t next = s_config;
+    memcpy(field_ptr(field, &next), &number, sizeof(number));
+    if (check_field(field, &next) == NULL && check_all(&next) == NULL) {
+        s_config = next;
+        *mask |= CONFIG_BIT(index);
+    }
+}
+
+// Формат config.txt прошивок до версии 1: имя, ключ, затем строки с префиксами
+static uint32_t import_legacy(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL) return 0;
+
+    char line[LINE_LEN];
+    uint32_t mask = 0;
+    for (int n = 0; fgets(line, sizeof(line), f); n++) {
+        line[strcspn(line, "\r\n")] = 0;
+        if (n == 0) {
+            import_text(CONFIG_DEVICE_NAME, line, &mask);
+        } else if (n == 1) {
+            import_text(CONFIG_AKEY, line, &mask);
+        } else if (strncmp(line, "https://", 8) == 0 || strncmp(line, "http://", 7) == 0) {
+            import_text(CONFIG_SERVER_URL, line, &mask);
+        } else if (strncmp(line, "mqtt://", 7) == 0) {
+            import_text(CONFIG_MQTT_URI, line, &mask);
+        } else if (strncmp(line, "udp://", 6) == 0) {
+            import_text(CONFIG_BEACON_URI, line, &mask);
+        } else if (strncmp(line, "alt=", 4) == 0) {
+            import_number(CONFIG_ALTITUDE, atoi(line + 4), &mask);
+        } else if (strncmp(line, "stats=", 6) == 0) {
+            uint32_t periods[2] = { s_config.stats_short_s, s_config.stats_long_s };
+            sscanf(line + 6, "%u,%u", &periods[0], &periods[1]);
+            import_number(CONFIG_STATS_SHORT_S, periods[0], &mask);
+            import_number(CONFIG_STATS_LONG_S, periods[1], &mask);
+        }
+    }
+    fclose(f);
+    return mask;
+}
+
+// Приведение NVS к текущей версии схемы. В NVS лежат только значения,
+// отличные от значений по умолчанию прошивки, записавшей их
+static esp_err_t migrate(nvs_handle handle, uint32_t from)
+{
+    uint32_t mask = 0;
+
+    switch (from) {
+        case 0:
+            // До версии 1 настройки читались из config.txt. Файл остается на
+            // месте для отката на прежнюю прошивку
+            mask = import_legacy(CONFIG_STORE_LEGACY_PATH);
+            s_stats.legacy_imported = mask != 0;
+            ESP_LOGI(TAG, "Imported 0x%05x from %s", mask, CONFIG_STORE_LEGACY_PATH);
+            break;
+        // Переименование поля или смена единиц в версии 2 - case 1
+        default:
+            break;
+    }
+
+    esp_err_t ret = save(handle, &s_config, mask);
+    if (ret == ESP_OK) ret = nvs_set_u32(handle, VERSION_KEY, CONFIG_STORE_VERSION);
+    if (ret == ESP_OK) ret = nvs_commit(handle);
+    s_stats.migrated = ret == ESP_OK;
+    return ret;
+}
+
+esp_err_t config_store_load(const app_config_t *defaults, app_config_t *config)
+{
+    int64_t started = esp_timer_get_time();
+    s_defaults = *defaults;
+    s_config = *defaults;
+
+    nvs_handle handle;
+    esp_err_t ret = nvs_open(CONFIG_STORE_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret == ESP_OK) {
+        uint32_t version = 0;
+        nvs_get_u32(handle, VERSION_KEY, &version);
+        s_stats.version = version;
+        if (version > 0) {
+            read_all(handle);
+        }
+        // Более новую версию (откат прошивки) не трогаем: неизвестные поля игнорируются
+        if (version < CONFIG_STORE_VERSION) {
+            ret = migrate(handle, version);
+        }
+        nvs_close(handle);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "NVS: %s, running with defaults where unset", esp_err_to_name(ret));
+    }
+
+    *config = s_config;
+    s_stats.load_us = (uint32_t)(esp_timer_get_time() - started);
+    ESP_LOGI(TAG, "Config v%u loaded in %u us", s_stats.version, s_stats.load_us);
+    return ret;
+}
+
+static const char *reject(const char *key, const char *err)
+{
+    snprintf(s_error, sizeof(s_error), "%s %s", key, err);
+    return s_error;
+}
+
+static const char *parse_item(const field_t *field, app_config_t *next, const cJSON *item)
+{
+    void *value = field_ptr(field, next);
+    if (field->type == FIELD_STR) {
+        if (!cJSON_IsString(item)) return "must be a string";
+        if ((field->flags & CONFIG_SECRET) && strcmp(item->valuestring, SECRET_MASK) == 0) return NULL;
+        if (strlen(item->valuestring) >= field->size) return "is too long";
+        strcpy(value, item->valuestring);
+    } else {
+        double number = item->valuedouble;
+        if (!cJSON_IsNumber(item) || number != (double)(int64_t)number ||
+            number < (double)field->min || number > (double)field->max) {
+            return cJSON_IsNumber(item) ? "is out of range" : "must be a number";
+        }
+        if (field->type == FIELD_U32) {
+            *(uint32_t *)value = (uint32_t)number;
+        } else {
+            *(int32_t *)value = (int32_t)number;
+        }
+    }
+    return check_field(field, next);
+}
+
+static int find_field(const char *key)
+{
+    for (int i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        if (strcmp(s_fields[i].key, key) == 0) return i;
+    }
+    return -1;
+}
+
+const char *config_store_patch(const char *json, uint32_t *changed)
+{
+    const char *err = NULL;
+    app_config_t next = s_config;
+    uint32_t mask = 0;
+
+    *changed = 0;
+    cJSON *root = cJSON_Parse(json);
+    if (!cJSON_IsObject(root)) {
+        err = "Body must be a JSON object";
+    } else {
+        const cJSON *item;
+        cJSON_ArrayForEach(item, root) {
+            int index = find_field(item->string);
+            if (index < 0) {
+                err = reject(item->string, "is not a setting");
+                break;
+            }
+            const field_t *field = &s_fields[index];
+            const char *field_err = parse_item(field, &next, item);
+            if (field_err) {
+                err = reject(field->key, field_err);
+                break;
+            }
+            if (memcmp(field_ptr(field, &next), field_ptr(field, &s_config), field->size) != 0) {
+                mask |= CONFIG_BIT(index);
+            }
+        }
+    }
+    cJSON_Delete(root);
+    if (!err) err = check_all(&next);
+
+    if (!err && mask) {
+        nvs_handle handle;
+        esp_err_t ret = nvs_open(CONFIG_STORE_NAMESPACE, NVS_READWRITE, &handle);
+        if (ret == ESP_OK) {
+            ret = save(handle, &next, mask);
+            if (ret == ESP_OK) ret = nvs_commit(handle);
+            nvs_close(handle);
+        }
+        if (ret != ESP_OK) {
+            err = reject("NVS write", esp_err_to_name(ret));
+        }
+    }
+    if (err) {
+        s_stats.rejected++;
+        return err;
+    }
+
+    s_config = next;
+    s_stats.patches++;
+    for (int i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        if ((mask & CONFIG_BIT(i)) && (s_fields[i].flags & CONFIG_RESTART)) {
+            s_stats.restart_pending |= CONFIG_BIT(i);
+        }
+    }
+    *changed = mask;
+    ESP_LOGI(TAG, "Changed 0x%05x, restart pending 0x%05x", mask, s_stats.restart_pending);
+    return NULL;
+}
+
+const app_config_t *config_store_get(void)
+{
+    return &s_config;
+}
+
+int config_store_json(char *buf, size_t len)
+{
+    int pos = snprintf(buf, len, "{\"version\":%u,\"values\":{", CONFIG_STORE_VERSION);
+    for (int i = 0; i < CONFIG_FIELD_COUNT && pos > 0 && (size_t)pos < len; i++) {
+        const field_t *field = &s_fields[i];
+        const void *value = field_ptr(field, &s_config);
+        const char *sep = i ? "," : "";
+        if (field->type == FIELD_STR) {
+            const char *text = value;
+            if ((field->flags & CONFIG_SECRET) && text[0]) text = SECRET_MASK;
+            pos += snprintf(buf + pos, len - pos, "%s\"%s\":", sep, field->key);
+            if (pos < 0 || (size_t)pos >= len) break;
+            int n = jsonstr_quote(buf + pos, len - pos, text);
+            if (n < 0) return -1;
+            pos += n;
+        } else if (field->type == FIELD_U32) {
+            pos += snprintf(buf + pos, len - pos, "%s\"%s\":%u", sep, field->key, *(const uint32_t *)value);
+        } else {
+            pos += snprintf(buf + pos, len - pos, "%s\"%s\":%d", sep, field->key, *(const int32_t *)value);
+        }
+    }
+    if (pos > 0 && (size_t)pos < len) {
+        pos += snprintf(buf + pos, len - pos, "},\"restart\":[");
+    }
+    int listed = 0;
+    for (int i = 0; i < CONFIG_FIELD_COUNT && pos > 0 && (size_t)pos < len; i++) {
+        if (s_stats.restart_pending & CONFIG_BIT(i)) {
+            pos += snprintf(buf + pos, len - pos, "%s\"%s\"", listed++ ? "," : "", s_fields[i].key);
+        }
+    }
+    if (pos > 0 && (size_t)pos < len) {
+        pos += snprintf(buf + pos, len - pos, "]}");
+    }
+    return (pos > 0 && (size_t)pos < len) ? pos : -1;
+}
+
+const char *config_store_field_name(config_field_t field)
+{
+    return s_fields[field].key;
+}
+
+uint8_t config_store_field_flags(config_field_t field)
+{
+    return s_fields[field].flags;
+}
+
+void config_store_get_stats(config_store_stats_t *stats)
+{
+    *stats = s_stats;
+}
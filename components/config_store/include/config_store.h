@@ -0,0 +1,157 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Настройки устройства в NVS (пространство "config"). Каждое поле схемы -
+ * отдельный типизированный ключ, поэтому загрузка при старте - это поиск по
+ * индексу страниц NVS, а не разбор файла, и поле, добавленное в новой версии
+ * прошивки, получает значение по умолчанию без миграции. Миграция по номеру
+ * версии нужна только при переименовании поля или смене его единиц; первая
+ * (версия 0 -> 1) переносит настройки из config.txt.
+ *
+ * Значения по умолчанию передает приложение (это прежние #define в main.c).
+ * Изменения через config_store_patch проверяются целиком и пишутся в NVS
+ * одной фиксацией; поля с CONFIG_RESTART вступают в силу после перезагрузки,
+ * остальные приложение применяет сразу.
+ */
+
+#define CONFIG_STORE_VERSION        1
+#define CONFIG_STORE_NAMESPACE      "config"
+#define CONFIG_STORE_LEGACY_PATH    "/spiffs/config.txt"
+
+#define CONFIG_AVG_MAX              16      // Наибольшее окно скользящего среднего
+
+// Признаки полей схемы
+#define CONFIG_SECRET               0x01    // В /config выдается как "***"
+#define CONFIG_RESTART              0x02    // Применяется после перезагрузки
+
+// Поля схемы; номер поля - бит в масках изменений
+typedef enum {
+    CONFIG_DEVICE_NAME,
+    CONFIG_AKEY,
+    CONFIG_WIFI_SSID,
+    CONFIG_WIFI_PASS,
+    CONFIG_AP_SSID,
+    CONFIG_AP_PASS,
+    CONFIG_SERVER_URL,
+    CONFIG_MQTT_URI,
+    CONFIG_BEACON_URI,
+    CONFIG_SAMPLE_MS,
+    CONFIG_PUBLISH_MS,
+    CONFIG_SENSOR_MS,
+    CONFIG_AVG_COUNT,
+    CONFIG_ALTITUDE,
+    CONFIG_STATS_SHORT_S,
+    CONFIG_STATS_LONG_S,
+    CONFIG_SDA_IO,
+    CONFIG_SCL_IO,
+    CONFIG_BUTTON1_IO,
+    CONFIG_BUTTON2_IO,
+    CONFIG_FIELD_COUNT
+} config_field_t;
+
+#define CONFIG_BIT(field)           (1UL << (field))
+
+typedef struct {
+    char device_name[32];
+    char akey[32];
+    char wifi_ssid[33];
+    char wifi_pass[65];
+    char ap_ssid[33];
+    char ap_pass[65];
+    char server_url[96];        // http:// или https://
+    char mqtt_uri[64];          // Пусто - отправка HTTP POST
+    char beacon_uri[32];        // Пусто - маяк выключен
+    uint32_t sample_ms;         // Период снятия измерения в буфер телеметрии
+    uint32_t publish_ms;        // Период отправки
+    uint32_t sensor_ms;         // Период измерений BME280
+    uint32_t avg_count;         // Окно скользящего среднего (1..CONFIG_AVG_MAX)
+    int32_t altitude;           // Высота станции, м
+    uint32_t stats_short_s;     // Окна сводок
+    uint32_t stats_long_s;
+    int32_t sda_io;
+    int32_t scl_io;
+    int32_t button1_io;
+    int32_t button2_io;
+} app_config_t;
+
+typedef struct {
+    uint32_t version;           // Версия формата в NVS до загрузки (0 - не было)
+    bool migrated;              // Выполнена миграция при этой загрузке
+    bool legacy_imported;       // Перенесен config.txt
+    uint32_t invalid;           // Поля с неверным значением в NVS, взяты по умолчанию (маска)
+    uint32_t patches;           // Принятых изменений через config_store_patch
+    uint32_t rejected;          // Отклоненных изменений
+    uint32_t restart_pending;   // Сохраненные поля, ждущие перезагрузки (маска)
+    uint32_t load_us;           // Время загрузки при старте
+} config_store_stats_t;
+
+/**
+ * @brief Загрузка настроек из NVS с миграцией формата
+ *
+ * Вызывать после nvs_flash_init и монтирования SPIFFS (для переноса
+ * config.txt). Отсутствующие и неверные значения заменяются значениями по
+ * умолчанию; ошибка NVS не мешает старту с настройками по умолчанию.
+ * @param defaults Значения по умолчанию (должны проходить проверку)
+ * @param config Загруженные настройки
+ * @return ESP_OK при успехе, иначе код ошибки NVS (config все равно заполнен)
+ */
+esp_err_t config_store_load(const app_config_t *defaults, app_config_t *config);
+
+/**
+ * @brief Проверка и сохранение изменений из JSON объекта {"поле":значение,...}
+ *
+ * Изменение принимается только целиком: неизвестное поле, неверный тип или
+ * значение вне диапазона отклоняют весь объект. Значение "***" у секретного
+ * поля означает "не менять".
+ * @param json Тело запроса (с завершающим нулем)
+ * @param changed Маска измененных полей
+ * @return NULL при успехе, иначе текст ошибки для ответа
+ */
+const char *config_store_patch(const char *json, uint32_t *changed);
+
+/**
+ * @brief Сохраненные настройки (с учетом изменений, ждущих перезагрузки)
+ * @return Указатель на внутреннюю копию; читать из задачи, вызывающей config_store_patch
+ */
+const app_config_t *config_store_get(void);
+
+/**
+ * @brief Описание настроек в JSON: значения, версия, поля, ждущие перезагрузки
+ * @param buf Буфер
+ * @param len Размер буфера
+ * @return Длина строки или -1, если не поместилось
+ */
+int config_store_json(char *buf, size_t len);
+
+/**
+ * @brief Имя поля (ключ NVS и имя в JSON)
+ * @param field Номер поля
+ * @return Имя поля
+ */
+const char *config_store_field_name(config_field_t field);
+
+/**
+ * @brief Признаки поля (CONFIG_SECRET, CONFIG_RESTART)
+ * @param field Номер поля
+ * @return Признаки
+ */
+uint8_t config_store_field_flags(config_field_t field);
+
+/**
+ * @brief Получение статистики
+ * @param stats Указатель для сохранения статистики
+ */
+void config_store_get_stats(config_store_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,213 @@
+#include <string.h>
+#include "delta.h"
+
+// Состояния разбора команд
+#define ST_OP           0
+#define ST_SRC_DELTA    1
+#define ST_LEN          2
+#define ST_DATA         3
+#define ST_DONE         4
+
+#define OP_END          0x00
+#define OP_COPY         0x01
+#define OP_ADD          0x02
+#define OP_INSERT       0x03
+
+static uint32_t get_u32_le(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+int delta_parse_header(const uint8_t *data, size_t len, delta_header_t *header)
+{
+    if (len < DELTA_HEADER_SIZE || memcmp(data, DELTA_MAGIC, 4) != 0) {
+        return DELTA_ERR_FORMAT;
+    }
+
+    header->src_size = get_u32_le(data + 4);
+    header->dst_size = get_u32_le(data + 8);
+    memcpy(header->src_sha256, data + 12, sizeof(header->src_sha256));
+    header->window_bits = data[44];
+    header->length_bits = data[45];
+
+    if (header->window_bits < 4 || header->window_bits > DELTA_WINDOW_BITS_MAX ||
+        header->length_bits < 2 || header->length_bits > 8) {
+        return DELTA_ERR_FORMAT;
+    }
+    return DELTA_OK;
+}
+
+int delta_init(delta_decoder_t *decoder, const delta_header_t *header,
+               delta_read_fn read, delta_write_fn write, void *ctx)
+{
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->header = *header;
+    decoder->read = read;
+    decoder->write = write;
+    decoder->ctx = ctx;
+    decoder->state = ST_OP;
+    return DELTA_OK;
+}
+
+static int flush_out(delta_decoder_t *d)
+{
+    if (d->out_len == 0) return DELTA_OK;
+    if (d->write(d->ctx, d->out_buf, d->out_len) != 0) return DELTA_ERR_IO;
+    d->out_len = 0;
+    return DELTA_OK;
+}
+
+static int put_out(delta_decoder_t *d, uint8_t b)
+{
+    d->out_buf[d->out_len++] = b;
+    d->written++;
+    return d->out_len == DELTA_BUF_SIZE ? flush_out(d) : DELTA_OK;
+}
+
+// Байт исходного образа в позиции src_pos (чтение блоками по DELTA_BUF_SIZE)
+static int get_src(delta_decoder_t *d, uint8_t *b)
+{
+    if (d->src_pos < d->src_buf_pos || d->src_pos >= d->src_buf_pos + d->src_buf_len) {
+        uint32_t n = d->header.src_size - d->src_pos;
+        if (n > DELTA_BUF_SIZE) n = DELTA_BUF_SIZE;
+        if (d->read(d->ctx, d->src_pos, d->src_buf, n) != 0) return DELTA_ERR_IO;
+        d->src_buf_pos = d->src_pos;
+        d->src_buf_len = n;
+    }
+    *b = d->src_buf[d->src_pos - d->src_buf_pos];
+    d->src_pos++;
+    return DELTA_OK;
+}
+
+// Команда известна полностью: проверка границ и выполнение копирования
+static int start_op(delta_decoder_t *d)
+{
+    if (d->written + d->remaining > d->header.dst_size) return DELTA_ERR_RANGE;
+    if (d->op != OP_INSERT && (d->src_pos > d->header.src_size ||
+                               d->remaining > d->header.src_size - d->src_pos)) {
+        return DELTA_ERR_RANGE;
+    }
+
+    if (d->op == OP_COPY) {
+        while (d->remaining > 0) {
+            uint8_t b;
+            int ret = get_src(d, &b);
+            if (ret == DELTA_OK) ret = put_out(d, b);
+            if (ret != DELTA_OK) return ret;
+            d->remaining--;
+        }
+    }
+
+    d->state = (d->remaining > 0) ? ST_DATA : ST_OP;
+    return DELTA_OK;
+}
+
+static int op_byte(delta_decoder_t *d, uint8_t b)
+{
+    int ret;
+
+    switch (d->state) {
+        case ST_OP:
+            d->op = b;
+            d->varint = 0;
+            d->varint_shift = 0;
+            if (b == OP_END) {
+                ret = flush_out(d);
+                if (ret != DELTA_OK) return ret;
+                if (d->written != d->header.dst_size) return DELTA_ERR_FORMAT;
+                d->state = ST_DONE;
+                return DELTA_DONE;
+            } else if (b == OP_COPY || b == OP_ADD) {
+                d->state = ST_SRC_DELTA;
+            } else if (b == OP_INSERT) {
+                d->state = ST_LEN;
+            } else {
+                return DELTA_ERR_FORMAT;
+            }
+            return DELTA_OK;
+
+        case ST_SRC_DELTA:
+        case ST_LEN:
+            if (d->varint_shift > 28) return DELTA_ERR_FORMAT;
+            d->varint |= (uint32_t)(b & 0x7F) << d->varint_shift;
+            d->varint_shift += 7;
+            if (b & 0x80) return DELTA_OK;
+
+            if (d->state == ST_SRC_DELTA) {
+                int32_t delta = (int32_t)(d->varint >> 1) ^ -(int32_t)(d->varint & 1);
+                d->src_pos += delta;
+                d->varint = 0;
+                d->varint_shift = 0;
+                d->state = ST_LEN;
+                return DELTA_OK;
+            }
+            d->remaining = d->varint;
+            return start_op(d);
+
+        case ST_DATA:
+            if (d->op == OP_ADD) {
+                uint8_t src;
+                ret = get_src(d, &src);
+                if (ret != DELTA_OK) return ret;
+                b = (uint8_t)(src + b);
+            }
+            ret = put_out(d, b);
+            if (ret != DELTA_OK) return ret;
+            if (--d->remaining == 0) d->state = ST_OP;
+            return DELTA_OK;
+
+        default:
+            return DELTA_DONE;
+    }
+}
+
+// Байт распакованного потока: запоминается в окне и передается разбору команд
+static int emit(delta_decoder_t *d, uint8_t b)
+{
+    d->window[d->window_pos] = b;
+    d->window_pos = (d->window_pos + 1) & ((1u << d->header.window_bits) - 1);
+    return op_byte(d, b);
+}
+
+static uint32_t take_bits(delta_decoder_t *d, uint8_t n)
+{
+    uint32_t value = (d->bits >> (d->bit_count - n)) & ((1u << n) - 1);
+    d->bit_count -= n;
+    d->bits &= (1u << d->bit_count) - 1;
+    return value;
+}
+
+int delta_feed(delta_decoder_t *decoder, const uint8_t *data, size_t len)
+{
+    delta_decoder_t *d = decoder;
+    const uint8_t backref_bits = 1 + d->header.window_bits + d->header.length_bits;
+    const uint32_t mask = (1u << d->header.window_bits) - 1;
+
+    if (d->state == ST_DONE) return DELTA_DONE;
+
+    for (size_t i = 0; i < len; i++) {
+        d->bits = (d->bits << 8) | data[i];
+        d->bit_count += 8;
+
+        // Токен: 1 + 8 бит литерал или 0 + смещение + длина
+        while (d->bit_count > 0) {
+            int literal = (d->bits >> (d->bit_count - 1)) & 1;
+            if (d->bit_count < (literal ? 9 : backref_bits)) break;
+            take_bits(d, 1);
+
+            int ret;
+            if (literal) {
+                ret = emit(d, (uint8_t)take_bits(d, 8));
+            } else {
+                uint32_t distance = take_bits(d, d->header.window_bits) + 1;
+                uint32_t count = take_bits(d, d->header.length_bits) + 3;
+                ret = DELTA_OK;
+                while (count-- > 0 && ret == DELTA_OK) {
+                    ret = emit(d, d->window[(d->window_pos - distance) & mask]);
+                }
+            }
+            if (ret != DELTA_OK) return ret;
+        }
+    }
+    return DELTA_OK;
+}
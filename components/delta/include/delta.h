@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Формат патча HDP1 (создается tools/mkdelta.py):
+ *
+ *   заголовок: "HDP1", src_size (u32 LE), dst_size (u32 LE),
+ *              SHA-256 исходного образа (32 байта), window_bits, length_bits
+ *   далее:     поток команд, сжатый LZSS с окном 2^window_bits
+ *
+ * Команды (числа - LEB128, смещения - zigzag относительно позиции в исходном образе):
+ *   0x00                          конец патча
+ *   0x01 <смещение> <длина>       копирование из исходного образа
+ *   0x02 <смещение> <длина> <d..> исходный байт + d (по модулю 256)
+ *   0x03 <длина> <байты>          вставка новых байтов
+ */
+
+#define DELTA_MAGIC             "HDP1"
+#define DELTA_HEADER_SIZE       46
+#define DELTA_WINDOW_BITS_MAX   10
+#define DELTA_BUF_SIZE          128
+
+// Коды возврата
+#define DELTA_OK                0
+#define DELTA_DONE              1
+#define DELTA_ERR_FORMAT        (-1)
+#define DELTA_ERR_RANGE         (-2)
+#define DELTA_ERR_IO            (-3)
+
+typedef struct {
+    uint32_t src_size;
+    uint32_t dst_size;
+    uint8_t src_sha256[32];
+    uint8_t window_bits;
+    uint8_t length_bits;
+} delta_header_t;
+
+// Чтение исходного образа: 0 при успехе
+typedef int (*delta_read_fn)(void *ctx, uint32_t offset, uint8_t *buf, size_t len);
+// Запись результата: 0 при успехе
+typedef int (*delta_write_fn)(void *ctx, const uint8_t *buf, size_t len);
+
+typedef struct {
+    delta_header_t header;
+    delta_read_fn read;
+    delta_write_fn write;
+    void *ctx;
+
+    // Распаковка LZSS
+    uint8_t window[1 << DELTA_WINDOW_BITS_MAX];
+    uint32_t window_pos;
+    uint32_t bits;
+    uint8_t bit_count;
+
+    // Разбор команд
+    uint8_t state;
+    uint8_t op;
+    uint8_t varint_shift;
+    uint32_t varint;
+    uint32_t src_pos;
+    uint32_t remaining;
+    uint32_t written;
+
+    // Буферы исходного образа и результата
+    uint8_t src_buf[DELTA_BUF_SIZE];
+    uint32_t src_buf_pos;
+    uint32_t src_buf_len;
+    uint8_t out_buf[DELTA_BUF_SIZE];
+    uint32_t out_len;
+} delta_decoder_t;
+
+/**
+ * @brief Разбор заголовка патча
+ * @param data Первые DELTA_HEADER_SIZE байт патча
+ * @param len Размер data
+ * @param header Указатель для сохранения заголовка
+ * @return DELTA_OK при успехе
+ */
+int delta_parse_header(const uint8_t *data, size_t len, delta_header_t *header);
+
+/**
+ * @brief Инициализация декодера
+ * @param decoder Декодер
+ * @param header Заголовок патча (см. delta_parse_header)
+ * @param read Функция чтения исходного образа
+ * @param write Функция записи результата
+ * @param ctx Контекст для read/write
+ * @return DELTA_OK при успехе
+ */
+int delta_init(delta_decoder_t *decoder, const delta_header_t *header,
+               delta_read_fn read, delta_write_fn write, void *ctx);
+
+/**
+ * @brief Передача очередной порции патча (после заголовка)
+ * @param decoder Декодер
+ * @param data Данные
+ * @param len Размер данных
+ * @return DELTA_OK - нужны еще данные, DELTA_DONE - образ собран, < 0 - ошибка
+ */
+int delta_feed(delta_decoder_t *decoder, const uint8_t *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
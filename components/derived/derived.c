@@ -0,0 +1,136 @@
+#include "derived.h"
+
+// Давление насыщенного пара (0.1 Па) для -40..+60 °C с шагом 1 °C:
+// 611.2 * exp(17.62 * T / (243.12 + T)) Па
+static const uint32_t saturation_table[] = {
+    190, 211, 234, 259, 286, 316, 348, 384,
+    423, 465, 512, 562, 617, 676, 741, 811,
+    887, 970, 1059, 1155, 1260, 1372, 1494, 1625,
+    1766, 1919, 2083, 2259, 2448, 2652, 2870, 3105,
+    3356, 3625, 3913, 4222, 4552, 4904, 5281, 5683,
+    6112, 6569, 7057, 7576, 8129, 8717, 9343, 10008,
+    10714, 11464, 12260, 13105, 14000, 14948, 15953, 17017,
+    18142, 19333, 20591, 21921, 23326, 24809, 26374, 28025,
+    29766, 31601, 33533, 35569, 37711, 39966, 42337, 44830,
+    47450, 50203, 53094, 56128, 59313, 62653, 66156, 69827,
+    73675, 77704, 81924, 86341, 90963, 95797, 100852, 106137,
+    111659, 117427, 123452, 129741, 136304, 143152, 150294, 157742,
+    165504, 173593, 182020, 190796, 199933,
+};
+
+#define TABLE_LAST  (DERIVED_T_MAX - DERIVED_T_MIN)
+
+static int32_t clamp(int32_t value, int32_t min, int32_t max)
+{
+    return value < min ? min : (value > max ? max : value);
+}
+
+uint32_t derived_saturation(int32_t t)
+{
+    int32_t offset = clamp(t, DERIVED_T_MIN * 100, DERIVED_T_MAX * 100) - DERIVED_T_MIN * 100;
+    int32_t index = offset / 100;
+    if (index == TABLE_LAST) return saturation_table[TABLE_LAST];
+
+    uint32_t low = saturation_table[index];
+    return low + (saturation_table[index + 1] - low) * (uint32_t)(offset % 100) / 100;
+}
+
+// Обратная функция: температура (0.01 °C), при которой пар с давлением e насыщен
+static int32_t dew_point(uint32_t e)
+{
+    if (e <= saturation_table[0]) return DERIVED_T_MIN * 100;
+    if (e >= saturation_table[TABLE_LAST]) return DERIVED_T_MAX * 100;
+
+    int low = 0, high = TABLE_LAST;
+    while (high - low > 1) {
+        int mid = (low + high) / 2;
+        if (saturation_table[mid] <= e) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    uint32_t step = saturation_table[high] - saturation_table[low];
+    return (DERIVED_T_MIN + low) * 100 + (int32_t)((e - saturation_table[low]) * 100 / step);
+}
+
+static uint32_t isqrt(uint32_t value)
+{
+    uint32_t root = 0, bit = 1u << 30;
+    while (bit > value) bit >>= 2;
+    while (bit) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+// Индекс жары NWS: формула Стедмана, а выше 80 °F - регрессия Ротфуса с поправками.
+// Температура в 0.01 °F, влажность в 0.01 %, коэффициенты регрессии умножены на 1e8.
+static int32_t heat_index_f(int32_t tf, int32_t rh)
+{
+    int32_t simple = (tf + 6100 + (tf - 6800) * 12 / 10 + rh * 94 / 1000) / 2;
+    if ((simple + tf) / 2 < 8000) return simple;
+
+    int64_t t = tf, h = rh;
+    int64_t sum = -4237900000LL * 100
+                + 204901523LL * t
+                + 1014333127LL * h
+                - 22475541LL * (t * h / 100)
+                - 683783LL * (t * t / 100)
+                - 5481717LL * (h * h / 100)
+                + 122874LL * (t * t * h / 10000)
+                + 85282LL * (t * h * h / 10000)
+                - 199LL * (t * t * h * h / 1000000);
+    int32_t hi = (int32_t)(sum / 100000000);
+
+    if (rh < 1300 && tf >= 8000 && tf <= 11200) {
+        int32_t distance = tf > 9500 ? tf - 9500 : 9500 - tf;
+        // sqrt((17 - |T - 95|) / 17), умноженный на 1e4
+        uint32_t root = isqrt((uint32_t)(1700 - distance) * 1000000u / 17u);
+        hi -= (int32_t)((uint32_t)(1300 - rh) * root / 40000u);
+    } else if (rh > 8500 && tf >= 8000 && tf <= 8700) {
+        hi += (rh - 8500) * (8700 - tf) / 5000;
+    }
+    return hi;
+}
+
+// Приведение к уровню моря: p0 = p * exp(g * h / (Rd * Tm)), Tm - средняя температура
+// столба воздуха при градиенте 0.0065 К/м. exp считается рядом в формате Q24.
+static int32_t sea_level(int32_t t, int32_t p, int32_t altitude_m)
+{
+    int32_t h = clamp(altitude_m, DERIVED_ALT_MIN, DERIVED_ALT_MAX);
+    int32_t tm = t + 27315 + h * 13 / 40;
+    // g / Rd = 0.03416356 К/м; 0.03416356 * 100 * 2^24 = 57316943
+    int64_t x = (int64_t)h * 57316943 / tm;
+
+    int64_t sum = (1 << 24) + x, term = x;
+    for (int n = 2; n <= 7; n++) {
+        term = term * x / n >> 24;
+        sum += term;
+    }
+    return (int32_t)(((int64_t)p * sum + (1 << 23)) >> 24);
+}
+
+void derived_compute(int32_t t, int32_t rh, int32_t p, int32_t altitude_m, derived_t *out)
+{
+    rh = clamp(rh, 0, 10000);
+
+    // Парциальное давление пара (0.1 Па)
+    uint32_t e = derived_saturation(t) * (uint32_t)rh / 10000u;
+    out->dew_point = dew_point(e);
+
+    // 1000 * e / (Rv * T), Rv = 461.5 Дж/(кг*К): 2167 * e[0.1 Па] / T[0.1 К] мг/м³
+    int32_t tk = (clamp(t, DERIVED_T_MIN * 100, DERIVED_T_MAX * 100) + 27315) / 10;
+    out->abs_humidity = (int32_t)(2167u * e / (uint32_t)tk);
+
+    int32_t hi = heat_index_f(t * 9 / 5 + 3200, rh);
+    out->heat_index = (hi - 3200) * 5 / 9;
+
+    out->sea_level_pressure = sea_level(t, p, altitude_m);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Производные величины по показаниям BME280: точка росы, абсолютная
+ * влажность, индекс жары и давление, приведенное к уровню моря.
+ *
+ * У ESP8266 нет FPU, поэтому расчет целочисленный: давление насыщенного
+ * пара по формуле Магнуса (над водой) берется из таблицы с шагом 1 °C и
+ * линейной интерполяцией, точка росы - обратным поиском по той же таблице,
+ * индекс жары - регрессия Ротфуса NWS в 64-битной арифметике, давление на
+ * уровне моря - гипсометрическая формула со средней температурой столба
+ * воздуха (exp раскладывается в ряд). Модуль не зависит от SDK.
+ *
+ * Таблица покрывает -40..+60 °C, за ее пределами значения ограничиваются.
+ */
+
+#define DERIVED_T_MIN       (-40)
+#define DERIVED_T_MAX       60
+#define DERIVED_ALT_MIN     (-500)
+#define DERIVED_ALT_MAX     9000
+
+typedef struct {
+    int32_t dew_point;          // Точка росы (0.01 °C)
+    int32_t abs_humidity;       // Абсолютная влажность (мг/м³)
+    int32_t heat_index;         // Индекс жары (0.01 °C)
+    int32_t sea_level_pressure; // Давление на уровне моря (Па)
+} derived_t;
+
+/**
+ * @brief Давление насыщенного пара над водой
+ * @param t Температура (0.01 °C)
+ * @return Давление (0.1 Па)
+ */
+uint32_t derived_saturation(int32_t t);
+
+/**
+ * @brief Расчет всех производных величин для одного измерения
+ * @param t Температура (0.01 °C)
+ * @param rh Относительная влажность (0.01 %)
+ * @param p Давление на станции (Па)
+ * @param altitude_m Высота станции над уровнем моря (м)
+ * @param out Результат
+ */
+void derived_compute(int32_t t, int32_t rh, int32_t p, int32_t altitude_m, derived_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,209 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "dlog.h"
+
+typedef struct {
+    uint32_t magic;
+    uint32_t image_tag;
+    uint32_t head;              // Индекс следующей записи
+    uint32_t count;
+    uint32_t total;
+    dlog_slot_t slots[DLOG_SLOTS];
+} dlog_ring_t;
+
+// Без раздела .noinit буфер обнуляется при старте, как обычная .bss
+#ifdef __NOINIT_ATTR
+static __NOINIT_ATTR dlog_ring_t s_ring;
+#else
+static dlog_ring_t s_ring;
+#endif
+
+void dlog_init(uint32_t image_tag)
+{
+    taskENTER_CRITICAL();
+    if (s_ring.magic == DLOG_MAGIC && s_ring.image_tag == image_tag &&
+        s_ring.head < DLOG_SLOTS && s_ring.count <= DLOG_SLOTS) {
+        // Записи прошлой загрузки остаются доступны и помечаются
+        for (uint32_t i = 0; i < DLOG_SLOTS; i++) {
+            s_ring.slots[i].prev_boot = 1;
+        }
+    } else {
+        memset(&s_ring, 0, sizeof(s_ring));
+        s_ring.magic = DLOG_MAGIC;
+        s_ring.image_tag = image_tag;
+    }
+    taskEXIT_CRITICAL();
+}
+
+void dlog_write(uint8_t level, const char *tag, const char *fmt, uint16_t spec, ...)
+{
+    dlog_slot_t slot;
+    int nargs = (spec >> 12) & 0x7;
+    size_t pos = 0;
+    va_list ap;
+
+    memset(&slot, 0, sizeof(slot));
+    slot.fmt = (uint32_t)(uintptr_t)fmt;
+    slot.tag = (uint32_t)(uintptr_t)tag;
+    slot.time_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    slot.level = level;
+
+    va_start(ap, spec);
+    for (int i = 0; i < nargs; i++) {
+        int type = (spec >> (i * 2)) & 0x3;
+        if (type == DLOG_ARG_STR) {
+            const char *str = va_arg(ap, const char *);
+            size_t len = str ? strnlen(str, DLOG_STR_MAX) : 0;
+            if (pos + 1 > DLOG_PAYLOAD_SIZE) break;
+            // Строка обрезается по оставшемуся месту
+            if (len > DLOG_PAYLOAD_SIZE - pos - 1) len = DLOG_PAYLOAD_SIZE - pos - 1;
+            slot.payload[pos++] = (uint8_t)len;
+            memcpy(slot.payload + pos, str, len);
+            pos += len;
+        } else {
+            if (pos + 4 > DLOG_PAYLOAD_SIZE) break;
+            if (type == DLOG_ARG_FLOAT) {
+                float value = (float)va_arg(ap, double);
+                memcpy(slot.payload + pos, &value, 4);
+            } else {
+                uint32_t value = va_arg(ap, uint32_t);
+                memcpy(slot.payload + pos, &value, 4);
+            }
+            pos += 4;
+        }
+        // Аргументы, которые не поместились, не попадают в спецификацию
+        slot.spec = (spec & 0x3FF) | (uint16_t)((i + 1) << 12);
+    }
+    va_end(ap);
+
+    taskENTER_CRITICAL();
+    s_ring.slots[s_ring.head] = slot;
+    s_ring.head = (s_ring.head + 1) % DLOG_SLOTS;
+    if (s_ring.count < DLOG_SLOTS) s_ring.count++;
+    s_ring.total++;
+    taskEXIT_CRITICAL();
+}
+
+void dlog_snapshot(dlog_slot_t *slots, dlog_dump_header_t *header)
+{
+    taskENTER_CRITICAL();
+    uint32_t first = (s_ring.head + DLOG_SLOTS - s_ring.count) % DLOG_SLOTS;
+    for (uint32_t i = 0; i < s_ring.count; i++) {
+        slots[i] = s_ring.slots[(first + i) % DLOG_SLOTS];
+    }
+    header->magic = DLOG_MAGIC;
+    header->slot_size = DLOG_SLOT_SIZE;
+    header->slots = DLOG_SLOTS;
+    header->total = s_ring.total;
+    header->count = s_ring.count;
+    taskEXIT_CRITICAL();
+}
+
+void dlog_clear(void)
+{
+    taskENTER_CRITICAL();
+    s_ring.head = 0;
+    s_ring.count = 0;
+    s_ring.total = 0;
+    taskEXIT_CRITICAL();
+}
+
+// Строка по адресу из записи: только печатные символы и не длиннее limit
+static const char *safe_str(uint32_t addr, size_t limit)
+{
+    const char *str = (const char *)(uintptr_t)addr;
+    if (str == NULL) return NULL;
+    for (size_t i = 0; i < limit; i++) {
+        unsigned char c = (unsigned char)str[i];
+        if (c == '\0') return str;
+        if (c < 0x20 && c != '\n' && c != '\t') return NULL;
+    }
+    return NULL;
+}
+
+int dlog_format(const dlog_slot_t *slot, char *buf, size_t len)
+{
+    static const char levels[] = "NEWIDV";
+    const char *fmt = safe_str(slot->fmt, 128);
+    const char *tag = safe_str(slot->tag, 32);
+    int nargs = (slot->spec >> 12) & 0x7;
+    size_t pos = 0, arg_pos = 0;
+    int arg = 0;
+
+    int n = snprintf(buf, len, "%c (%u) %s: ", slot->level < 6 ? levels[slot->level] : '?',
+                     slot->time_ms, tag ? tag : "?");
+    if (n < 0 || (size_t)n >= len) return (int)strlen(buf);
+    pos = n;
+
+    if (fmt == NULL) {
+        // Запись другого образа: формат недоступен, только адрес
+        n = snprintf(buf + pos, len - pos, "<fmt 0x%08x>", slot->fmt);
+        return (n < 0 || pos + n >= len) ? (int)strlen(buf) : (int)(pos + n);
+    }
+
+    while (*fmt && pos + 1 < len) {
+        if (*fmt != '%') {
+            buf[pos++] = *fmt++;
+            continue;
+        }
+        if (fmt[1] == '%') {
+            buf[pos++] = '%';
+            fmt += 2;
+            continue;
+        }
+
+        // Спецификатор без модификаторов длины: все целые на устройстве 32-битные
+        char spec[16];
+        size_t s = 0;
+        spec[s++] = *fmt++;
+        while (*fmt && strchr("-+ #0123456789.", *fmt) && s < sizeof(spec) - 3) {
+            spec[s++] = *fmt++;
+        }
+        while (*fmt && strchr("hlLqjzt", *fmt)) fmt++;
+        char conv = *fmt ? *fmt++ : 'd';
+        spec[s++] = conv;
+        spec[s] = '\0';
+
+        int type = (arg < nargs) ? (slot->spec >> (arg * 2)) & 0x3 : -1;
+        arg++;
+        // Запись прошлой загрузки могла повредиться: не выходить за payload
+        size_t need = (type == DLOG_ARG_STR) ? 1 : 4;
+        if (type >= 0 && arg_pos + need > DLOG_PAYLOAD_SIZE) type = -1;
+        if (type == DLOG_ARG_STR && (slot->payload[arg_pos] > DLOG_STR_MAX ||
+                                     arg_pos + 1 + slot->payload[arg_pos] > DLOG_PAYLOAD_SIZE)) {
+            type = -1;
+        }
+        if (type == DLOG_ARG_STR && strchr("s", conv)) {
+            char str[DLOG_STR_MAX + 1];
+            size_t slen = slot->payload[arg_pos++];
+            memcpy(str, slot->payload + arg_pos, slen);
+            str[slen] = '\0';
+            arg_pos += slen;
+            n = snprintf(buf + pos, len - pos, spec, str);
+        } else if (type == DLOG_ARG_FLOAT && strchr("fFeEgG", conv)) {
+            float value;
+            memcpy(&value, slot->payload + arg_pos, 4);
+            arg_pos += 4;
+            n = snprintf(buf + pos, len - pos, spec, (double)value);
+        } else if (type == DLOG_ARG_INT && strchr("diouxXc", conv)) {
+            uint32_t value;
+            memcpy(&value, slot->payload + arg_pos, 4);
+            arg_pos += 4;
+            n = snprintf(buf + pos, len - pos, spec, value);
+        } else {
+            // Тип аргумента не совпал со спецификатором или аргумента нет
+            if (type == DLOG_ARG_STR) arg_pos += 1 + slot->payload[arg_pos];
+            else if (type >= 0) arg_pos += 4;
+            n = snprintf(buf + pos, len - pos, "<?>");
+        }
+        if (n < 0) break;
+        pos = ((size_t)n >= len - pos) ? len - 1 : pos + n;
+    }
+    buf[pos] = '\0';
+    return (int)pos;
+}
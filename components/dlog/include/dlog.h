@@ -0,0 +1,146 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Отложенный журнал. Вызов DLOGx не форматирует строку: в кольцевой буфер
+ * в RAM пишутся адрес строки формата, адрес тега, время и сырые аргументы
+ * (до DLOG_MAX_ARGS целых, float или коротких строк). Текст получается
+ * позже: на устройстве при чтении /log или на хосте tools/dlog_decode.py
+ * по ELF файлу прошивки. Записи с уровнем не выше DLOG_ECHO_LEVEL
+ * дополнительно сразу выводятся через ESP_LOGx.
+ *
+ * Запись - 32 байта (DLOG_SLOT_SIZE):
+ *   0  адрес строки формата (u32)
+ *   4  адрес тега (u32)
+ *   8  время от старта (u32, мс)
+ *   12 спецификация аргументов (u16): по 2 бита на тип, число в битах 12..14
+ *   14 уровень (u8), признак предыдущей загрузки (u8)
+ *   16 аргументы: int/float по 4 байта, строка - длина (u8) и байты
+ */
+
+#define DLOG_SLOT_SIZE      32
+#define DLOG_PAYLOAD_SIZE   16
+#define DLOG_MAX_ARGS       5
+#define DLOG_STR_MAX        15
+
+#ifndef DLOG_SLOTS
+#define DLOG_SLOTS          64
+#endif
+
+#ifndef DLOG_ECHO_LEVEL
+#define DLOG_ECHO_LEVEL     ESP_LOG_ERROR
+#endif
+
+#define DLOG_MAGIC          0x31474C44      // "DLG1"
+
+// Типы аргументов
+#define DLOG_ARG_INT        0
+#define DLOG_ARG_FLOAT      1
+#define DLOG_ARG_STR        2
+
+typedef struct {
+    uint32_t fmt;
+    uint32_t tag;
+    uint32_t time_ms;
+    uint16_t spec;
+    uint8_t level;
+    uint8_t prev_boot;
+    uint8_t payload[DLOG_PAYLOAD_SIZE];
+} dlog_slot_t;
+
+// Заголовок двоичной выгрузки (за ним count записей от старых к новым)
+typedef struct {
+    uint32_t magic;
+    uint16_t slot_size;
+    uint16_t slots;
+    uint32_t total;             // Записей с момента очистки буфера
+    uint32_t count;
+} dlog_dump_header_t;
+
+#define DLOG_TYPE(x) _Generic((x), \
+    float: DLOG_ARG_FLOAT, double: DLOG_ARG_FLOAT, \
+    char *: DLOG_ARG_STR, const char *: DLOG_ARG_STR, \
+    default: DLOG_ARG_INT)
+
+#define DLOG_NARG(...) DLOG_NARG_(0, ##__VA_ARGS__, 5, 4, 3, 2, 1, 0)
+#define DLOG_NARG_(z, a, b, c, d, e, n, ...) n
+
+#define DLOG_TYPES_0() 0
+#define DLOG_TYPES_1(a) DLOG_TYPE(a)
+#define DLOG_TYPES_2(a, b) (DLOG_TYPES_1(a) | DLOG_TYPE(b) << 2)
+#define DLOG_TYPES_3(a, b, c) (DLOG_TYPES_2(a, b) | DLOG_TYPE(c) << 4)
+#define DLOG_TYPES_4(a, b, c, d) (DLOG_TYPES_3(a, b, c) | DLOG_TYPE(d) << 6)
+#define DLOG_TYPES_5(a, b, c, d, e) (DLOG_TYPES_4(a, b, c, d) | DLOG_TYPE(e) << 8)
+#define DLOG_CAT_(a, b) a##b
+#define DLOG_CAT(a, b) DLOG_CAT_(a, b)
+
+#define DLOG_SPEC(...) ((uint16_t)(DLOG_CAT(DLOG_TYPES_, DLOG_NARG(__VA_ARGS__))(__VA_ARGS__) | \
+                                   DLOG_NARG(__VA_ARGS__) << 12))
+
+#define DLOG_RECORD(level, tag, fmt, ...) \
+    dlog_write(level, tag, fmt, DLOG_SPEC(__VA_ARGS__), ##__VA_ARGS__)
+
+#define DLOGE(tag, fmt, ...) do { \
+    if (DLOG_ECHO_LEVEL >= ESP_LOG_ERROR) ESP_LOGE(tag, fmt, ##__VA_ARGS__); \
+    DLOG_RECORD(ESP_LOG_ERROR, tag, fmt, ##__VA_ARGS__); \
+} while (0)
+
+#define DLOGW(tag, fmt, ...) do { \
+    if (DLOG_ECHO_LEVEL >= ESP_LOG_WARN) ESP_LOGW(tag, fmt, ##__VA_ARGS__); \
+    DLOG_RECORD(ESP_LOG_WARN, tag, fmt, ##__VA_ARGS__); \
+} while (0)
+
+#define DLOGI(tag, fmt, ...) do { \
+    if (DLOG_ECHO_LEVEL >= ESP_LOG_INFO) ESP_LOGI(tag, fmt, ##__VA_ARGS__); \
+    DLOG_RECORD(ESP_LOG_INFO, tag, fmt, ##__VA_ARGS__); \
+} while (0)
+
+/**
+ * @brief Инициализация журнала. Вызывать при старте
+ *
+ * Если буфер пережил перезапуск (раздел .noinit) и записан этим же образом
+ * (image_tag), записи предыдущей загрузки сохраняются для разбора причины сбоя.
+ * @param image_tag Признак образа прошивки
+ */
+void dlog_init(uint32_t image_tag);
+
+/**
+ * @brief Запись события (используйте макросы DLOGx)
+ * @param level Уровень
+ * @param tag Тег (строка должна жить все время работы)
+ * @param fmt Строка формата (литерал)
+ * @param spec Типы и число аргументов (DLOG_SPEC)
+ */
+void dlog_write(uint8_t level, const char *tag, const char *fmt, uint16_t spec, ...);
+
+/**
+ * @brief Копия записей от старых к новым
+ * @param slots Буфер на DLOG_SLOTS записей
+ * @param header Заголовок выгрузки
+ */
+void dlog_snapshot(dlog_slot_t *slots, dlog_dump_header_t *header);
+
+/**
+ * @brief Форматирование записи в текст вида "I (1234) TAG: сообщение"
+ * @param slot Запись
+ * @param buf Буфер
+ * @param len Размер буфера
+ * @return Длина строки
+ */
+int dlog_format(const dlog_slot_t *slot, char *buf, size_t len);
+
+/**
+ * @brief Очистка буфера
+ */
+void dlog_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,55 @@
+#include "health.h"
+
+static void enter(health_t *health, health_state_t state)
+{
+    if (health->state != state) {
+        health->state = state;
+        health->transitions++;
+    }
+}
+
+health_state_t health_record(health_t *health, bool ok)
+{
+    if (ok) {
+        health->fail_streak = 0;
+        if (health->ok_streak < UINT16_MAX) health->ok_streak++;
+        if (health->state == HEALTH_FAILED) {
+            enter(health, HEALTH_DEGRADED);
+        } else if (health->state == HEALTH_DEGRADED && health->ok_streak >= HEALTH_RECOVER_AFTER) {
+            enter(health, HEALTH_OK);
+        }
+    } else {
+        health->ok_streak = 0;
+        if (health->fail_streak < UINT16_MAX) health->fail_streak++;
+        health->failures++;
+        enter(health, health->fail_streak >= HEALTH_FAIL_AFTER ? HEALTH_FAILED : HEALTH_DEGRADED);
+    }
+    return health->state;
+}
+
+int health_poll(health_t *health, const health_policy_t *policy, const health_ops_t *ops,
+                uint32_t cycle)
+{
+    int64_t started = ops->now_us(ops->ctx);
+    int err = ops->measure(ops->ctx);
+
+    // Отказавшее устройство не занимает шину восстановлением каждый цикл
+    bool may_recover = health->state != HEALTH_FAILED || cycle % policy->failed_every == 0;
+    for (uint32_t attempt = 1; err != 0 && may_recover && attempt < policy->attempts &&
+         ops->now_us(ops->ctx) - started < (int64_t)policy->budget_ms * 1000; attempt++) {
+        ops->recover(ops->ctx, err);
+        err = ops->measure(ops->ctx);
+    }
+
+    health_record(health, err == 0);
+    return err;
+}
+
+const char *health_name(health_state_t state)
+{
+    switch (state) {
+        case HEALTH_OK:       return "ok";
+        case HEALTH_DEGRADED: return "degraded";
+        default:              return "failed";
+    }
+}
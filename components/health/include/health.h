@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Состояние исправности устройства на шине по итогам циклов опроса:
+ *
+ *   OK --ошибка--> DEGRADED --HEALTH_FAIL_AFTER ошибок подряд--> FAILED
+ *   DEGRADED --HEALTH_RECOVER_AFTER успехов подряд--> OK
+ *   FAILED --успех--> DEGRADED
+ *
+ * Владелец устройства решает по состоянию, сколько усилий тратить на
+ * восстановление (например, в FAILED не занимать шину каждый цикл).
+ * health_poll выполняет цикл опроса по такой политике: первая попытка
+ * всегда, повтор с восстановлением - пока не исчерпаны попытки и бюджет
+ * времени цикла, в FAILED повтор только раз в failed_every циклов.
+ * Модуль не зависит от SDK.
+ */
+
+#define HEALTH_FAIL_AFTER       3
+#define HEALTH_RECOVER_AFTER    3
+
+typedef enum {
+    HEALTH_OK = 0,
+    HEALTH_DEGRADED,
+    HEALTH_FAILED,
+} health_state_t;
+
+typedef struct {
+    health_state_t state;
+    uint16_t fail_streak;       // Неудачных циклов подряд
+    uint16_t ok_streak;         // Удачных циклов подряд
+    uint32_t failures;          // Всего неудачных циклов
+    uint32_t transitions;       // Смен состояния
+} health_t;
+
+// Политика восстановления в цикле опроса
+typedef struct {
+    uint32_t attempts;          // Попыток за цикл, включая первую
+    uint32_t budget_ms;         // Повтор начинается, только пока цикл короче
+    uint32_t failed_every;      // В FAILED повтор - раз в столько циклов
+} health_policy_t;
+
+// Операции владельца устройства
+typedef struct {
+    int (*measure)(void *ctx);              // Попытка: 0 - успех, иначе код ошибки
+    void (*recover)(void *ctx, int err);    // Восстановление перед повтором
+    int64_t (*now_us)(void *ctx);           // Монотонное время (мкс)
+    void *ctx;
+} health_ops_t;
+
+/**
+ * @brief Учет итога цикла опроса
+ * @param health Состояние устройства
+ * @param ok true - цикл удачный
+ * @return Новое состояние
+ */
+health_state_t health_record(health_t *health, bool ok);
+
+/**
+ * @brief Цикл опроса с повторами по политике и учет его итога
+ * @param health Состояние устройства
+ * @param policy Политика восстановления
+ * @param ops Операции
+ * @param cycle Номер цикла (для редкого восстановления в FAILED)
+ * @return Код последней попытки (0 - успех)
+ */
+int health_poll(health_t *health, const health_policy_t *policy, const health_ops_t *ops,
+                uint32_t cycle);
+
+/**
+ * @brief Имя состояния для JSON: "ok", "degraded", "failed"
+ * @param state Состояние
+ * @return Строка
+ */
+const char *health_name(health_state_t state);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,137 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "driver/gpio.h"
+#include "rom/ets_sys.h"
+#include "dlog.h"
+#include "trace.h"
+#include "i2c_bus.h"
+
+static const char *TAG = "I2C";
+
+// Половина периода SCL при ручной выдаче импульсов (100 кГц)
+#define RECOVER_HALF_PERIOD_US      5
+#define RECOVER_PULSES              9
+
+static i2c_bus_config_t s_config;
+static SemaphoreHandle_t s_lock = NULL;
+static StaticSemaphore_t s_lock_buf;
+static i2c_bus_stats_t s_stats;
+
+static esp_err_t install(void)
+{
+    i2c_config_t conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = s_config.sda_io,
+        .sda_pullup_en = GPIO_PULLUP_ENABLE,
+        .scl_io_num = s_config.scl_io,
+        .scl_pullup_en = GPIO_PULLUP_ENABLE,
+        .clk_stretch_tick = s_config.clk_stretch_tick,
+    };
+
+    esp_err_t err = i2c_param_config(I2C_MASTER_NUM, &conf);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "I2C param config failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    err = i2c_driver_install(I2C_MASTER_NUM, conf.mode);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "I2C driver install failed: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+esp_err_t i2c_bus_init(const i2c_bus_config_t *config)
+{
+    s_config = *config;
+    if (s_lock == NULL) {
+        s_lock = xSemaphoreCreateMutexStatic(&s_lock_buf);
+    }
+    return install();
+}
+
+esp_err_t i2c_bus_cmd(uint8_t addr, i2c_cmd_handle_t cmd)
+{
+    const TickType_t timeout = pdMS_TO_TICKS(I2C_BUS_TIMEOUT_MS);
+
+    if (xSemaphoreTake(s_lock, timeout) != pdTRUE) {
+        s_stats.busy++;
+        return ESP_ERR_TIMEOUT;
+    }
+    trace_begin(TRACE_I2C, addr);
+    esp_err_t ret = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, timeout);
+    trace_end(TRACE_I2C, addr);
+    s_stats.transactions++;
+    if (ret != ESP_OK) {
+        s_stats.errors++;
+    }
+    xSemaphoreGive(s_lock);
+    return ret;
+}
+
+static void scl(uint32_t level)
+{
+    gpio_set_level(s_config.scl_io, level);
+    ets_delay_us(RECOVER_HALF_PERIOD_US);
+}
+
+static void sda(uint32_t level)
+{
+    gpio_set_level(s_config.sda_io, level);
+    ets_delay_us(RECOVER_HALF_PERIOD_US);
+}
+
+esp_err_t i2c_bus_recover(void)
+{
+    // Транзакции других задач короче таймаута, долго ждать не придется
+    if (xSemaphoreTake(s_lock, pdMS_TO_TICKS(5 * I2C_BUS_TIMEOUT_MS)) != pdTRUE) {
+        s_stats.busy++;
+        return ESP_ERR_TIMEOUT;
+    }
+    s_stats.recoveries++;
+    i2c_driver_delete(I2C_MASTER_NUM);
+
+    // Оба вывода - открытый сток с подтяжкой, как у самого драйвера
+    gpio_config_t io = {
+        .pin_bit_mask = (1UL << s_config.sda_io) | (1UL << s_config.scl_io),
+        .mode = GPIO_MODE_INPUT_OUTPUT_OD,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+    gpio_config(&io);
+    sda(1);
+    scl(1);
+
+    // Устройство, прервавшее передачу байта, отпускает SDA после своего девятого такта
+    int pulses = 0;
+    while (pulses < RECOVER_PULSES && gpio_get_level(s_config.sda_io) == 0) {
+        scl(0);
+        scl(1);
+        pulses++;
+    }
+
+    // STOP: SDA вверх при высоком SCL
+    scl(0);
+    sda(0);
+    scl(1);
+    sda(1);
+    bool released = gpio_get_level(s_config.sda_io) != 0;
+
+    esp_err_t ret = install();
+    xSemaphoreGive(s_lock);
+
+    if (!released) {
+        s_stats.stuck++;
+        DLOGE(TAG, "SDA still low after %d clocks", pulses);
+        return ESP_ERR_INVALID_STATE;
+    }
+    DLOGW(TAG, "Bus recovered after %d clocks", pulses);
+    return ret;
+}
+
+void i2c_bus_get_stats(i2c_bus_stats_t *stats)
+{
+    *stats = s_stats;
+}
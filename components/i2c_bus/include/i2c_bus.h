@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/i2c.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Общая шина I2C (BME280 и дисплеи). Все транзакции идут через
+ * i2c_bus_cmd: доступ по очереди, короткий таймаут вместо 1000 тиков и
+ * метка трассировки с адресом устройства. Если устройство на длинном
+ * кабеле зависло посреди чтения и держит SDA, i2c_bus_recover снимает
+ * драйвер, выдает до 9 импульсов SCL и STOP вручную и ставит драйвер заново.
+ */
+
+// I2C определения
+#define I2C_MASTER_NUM              I2C_NUM_0
+
+// Ожидание очереди к шине и выполнения одной транзакции
+#define I2C_BUS_TIMEOUT_MS          20
+
+typedef struct {
+    int sda_io;
+    int scl_io;
+    uint32_t clk_stretch_tick;
+} i2c_bus_config_t;
+
+typedef struct {
+    uint32_t transactions;
+    uint32_t errors;            // Транзакции с ошибкой (нет ACK, таймаут)
+    uint32_t busy;              // Шина не освободилась за I2C_BUS_TIMEOUT_MS
+    uint32_t recoveries;        // Вызовов i2c_bus_recover
+    uint32_t stuck;             // SDA осталась прижатой после восстановления
+} i2c_bus_stats_t;
+
+/**
+ * @brief Установка драйвера I2C
+ * @param config Выводы и растяжение тактов
+ * @return ESP_OK при успехе
+ */
+esp_err_t i2c_bus_init(const i2c_bus_config_t *config);
+
+/**
+ * @brief Выполнение транзакции с ограниченным ожиданием
+ * @param addr Адрес устройства (для трассировки)
+ * @param cmd Подготовленная транзакция (удаляет вызывающий)
+ * @return ESP_OK при успехе, ESP_ERR_TIMEOUT если шина занята
+ */
+esp_err_t i2c_bus_cmd(uint8_t addr, i2c_cmd_handle_t cmd);
+
+/**
+ * @brief Освобождение зависшей шины: до 9 импульсов SCL, пока устройство
+ *        не отпустит SDA, затем STOP и переустановка драйвера
+ * @return ESP_OK если SDA свободна, ESP_ERR_INVALID_STATE если осталась прижатой
+ */
+esp_err_t i2c_bus_recover(void);
+
+/**
+ * @brief Счетчики шины
+ * @param stats Копия счетчиков
+ */
+void i2c_bus_get_stats(i2c_bus_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
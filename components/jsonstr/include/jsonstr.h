@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Строковые значения JSON для документов, собираемых через snprintf.
+ * Настройки (имя устройства, ключ, SSID и пароли) могут содержать кавычки,
+ * обратную косую черту и управляющие символы - в JSON они экранируются.
+ * Модуль не зависит от SDK.
+ */
+
+/**
+ * @brief Запись строки в кавычках с экранированием " \ и символов 0x00-0x1F
+ * @param buf Буфер
+ * @param len Размер буфера
+ * @param text Строка (UTF-8, байты от 0x80 переносятся без изменений)
+ * @return Длина записанного без завершающего нуля или -1, если буфер мал
+ */
+int jsonstr_quote(char *buf, size_t len, const char *text);
+
+#ifdef __cplusplus
+}
+#endif
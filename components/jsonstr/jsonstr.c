@@ -0,0 +1,41 @@
+#include "jsonstr.h"
+
+static const char hex[] = "0123456789abcdef";
+
+int jsonstr_quote(char *buf, size_t len, const char *text)
+{
+    size_t pos = 0;
+    // Место под закрывающую кавычку и завершающий ноль
+    if (len < 3) return -1;
+    buf[pos++] = '"';
+
+    for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+        char esc = 0;
+        switch (*p) {
+        case '"':  esc = '"';  break;
+        case '\\': esc = '\\'; break;
+        case '\n': esc = 'n';  break;
+        case '\r': esc = 'r';  break;
+        case '\t': esc = 't';  break;
+        }
+        size_t need = esc ? 2 : (*p < 0x20 ? 6 : 1);
+        if (pos + need + 2 > len) return -1;
+        if (esc) {
+            buf[pos++] = '\\';
+            buf[pos++] = esc;
+        } else if (*p < 0x20) {
+            buf[pos++] = '\\';
+            buf[pos++] = 'u';
+            buf[pos++] = '0';
+            buf[pos++] = '0';
+            buf[pos++] = hex[*p >> 4];
+            buf[pos++] = hex[*p & 0x0F];
+        } else {
+            buf[pos++] = *p;
+        }
+    }
+
+    buf[pos++] = '"';
+    buf[pos] = '\0';
+    return (int)pos;
+}
@@ -1,54 +1,99 @@
 #pragma once
 
+#include <stdint.h>
+#include <stdbool.h>
 #include "esp_err.h"
-#include "driver/i2c.h"
+#include "i2c_bus.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// I2C определения
-#define I2C_MASTER_NUM              I2C_NUM_0
+/*
+ * Символьные дисплеи HD44780 через расширитель PCF8574. На одной шине может
+ * быть несколько дисплеев разного размера: каждый описывается своим lcd_t
+ * (адрес, геометрия, подсветка, копия выведенного текста). Вызывающий
+ * размещает lcd_t сам, обычно статически.
+ */
+
+// Максимальный поддерживаемый размер (буферы кадров в приложении)
+#ifndef LCD_MAX_COLS
+#define LCD_MAX_COLS                20
+#endif
+#ifndef LCD_MAX_ROWS
+#define LCD_MAX_ROWS                4
+#endif
+
+#define LCD_DEFAULT_ADDR            0x27    // PCF8574 с A0-A2 на плюсе; PCF8574A - 0x38-0x3F
+
+#define LCD_CONFIG_1602(a)          { .addr = (a), .cols = 16, .rows = 2 }
+#define LCD_CONFIG_2004(a)          { .addr = (a), .cols = 20, .rows = 4 }
+
+typedef struct {
+    uint8_t addr;               // Адрес PCF8574 на шине I2C
+    uint8_t cols;               // 1..LCD_MAX_COLS
+    uint8_t rows;               // 1..LCD_MAX_ROWS
+} lcd_config_t;
+
+typedef struct {
+    lcd_config_t config;
+    uint8_t row_offset[LCD_MAX_ROWS];           // Адрес DDRAM начала каждой строки
+    uint8_t backlight;
+    bool shown_valid[LCD_MAX_ROWS];             // false - содержимое строки неизвестно
+    char shown[LCD_MAX_ROWS][LCD_MAX_COLS + 1]; // Что сейчас на экране (с пробелами до cols)
+    uint32_t bytes_written;     // Байт (команд и символов), переданных дисплею
+} lcd_t;
 
 /**
- * @brief Инициализация LCD дисплея
- * @return ESP_OK при успехе
+ * @brief Инициализация дисплея
+ * @param lcd Описатель дисплея
+ * @param config Адрес и размер
+ * @return ESP_OK при успехе, ESP_ERR_INVALID_ARG при неподдерживаемом размере
  */
-esp_err_t lcd_init(void);
+esp_err_t lcd_init(lcd_t *lcd, const lcd_config_t *config);
 
 /**
  * @brief Очистка дисплея
+ * @param lcd Описатель дисплея
  * @return ESP_OK при успехе
  */
-esp_err_t lcd_clear(void);
+esp_err_t lcd_clear(lcd_t *lcd);
 
 /**
  * @brief Установка курсора
- * @param col Колонка (0-15)
- * @param row Строка (0-1)
+ * @param lcd Описатель дисплея
+ * @param col Колонка (0..cols-1)
+ * @param row Строка (0..rows-1)
  * @return ESP_OK при успехе
  */
-esp_err_t lcd_set_cursor(uint8_t col, uint8_t row);
+esp_err_t lcd_set_cursor(lcd_t *lcd, uint8_t col, uint8_t row);
 
 /**
- * @brief Вывод строки на дисплей
+ * @brief Вывод строки с текущей позиции курсора
+ * @param lcd Описатель дисплея
  * @param str Строка для вывода
  * @return ESP_OK при успехе
  */
-esp_err_t lcd_print(const char *str);
+esp_err_t lcd_print(lcd_t *lcd, const char *str);
 
 /**
- * @brief Включение подсветки
- * @return ESP_OK при успехе
+ * @brief Вывод строки целиком: текст дополняется пробелами до ширины дисплея,
+ *        по шине передаются только символы, отличающиеся от уже выведенных
+ * @param lcd Описатель дисплея
+ * @param row Строка (0..rows-1)
+ * @param text Текст (лишнее обрезается)
+ * @return ESP_OK при успехе (в том числе если строка не изменилась)
  */
-esp_err_t lcd_backlight_on(void);
+esp_err_t lcd_write_row(lcd_t *lcd, uint8_t row, const char *text);
 
 /**
- * @brief Выключение подсветки
+ * @brief Управление подсветкой
+ * @param lcd Описатель дисплея
+ * @param on true - включить
  * @return ESP_OK при успехе
  */
-esp_err_t lcd_backlight_off(void);
+esp_err_t lcd_set_backlight(lcd_t *lcd, bool on);
 
 #ifdef __cplusplus
 }
-#endif
\ No newline at end of file
+#endif
@@ -1,20 +1,17 @@
+#include <stdio.h>
 #include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
-#include "driver/i2c.h"
+#include "dlog.h"
 #include "lcd.h"
 
 static const char *TAG = "LCD";
 
-// Адрес I2C для LCD 1602
-#define LCD_ADDR 0x27
 #define LCD_BACKLIGHT 0x08
 #define LCD_ENABLE 0x04
 #define LCD_COMMAND 0x00
 #define LCD_DATA 0x01
-#define LCD_LINE_1 0x80
-#define LCD_LINE_2 0xC0
 
 // Команды LCD
 #define LCD_CLEAR_DISPLAY 0x01
@@ -48,122 +45,181 @@ static const char *TAG = "LCD";
 #define LCD_5x10DOTS 0x04
 #define LCD_5x8DOTS 0x00
 
-static uint8_t backlight_state = LCD_BACKLIGHT;
-
-static esp_err_t lcd_write_nibble(uint8_t data, uint8_t rs)
+static esp_err_t lcd_write_nibble(lcd_t *lcd, uint8_t data, uint8_t rs)
 {
-    uint8_t data_byte = (data & 0x0F) << 4 | backlight_state | rs;
+    uint8_t data_byte = (data & 0x0F) << 4 | lcd->backlight | rs;
     
     i2c_cmd_handle_t cmd = i2c_cmd_link_create();
     i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (LCD_ADDR << 1) | I2C_MASTER_WRITE, true);
+    i2c_master_write_byte(cmd, (lcd->config.addr << 1) | I2C_MASTER_WRITE, true);
     i2c_master_write_byte(cmd, data_byte | LCD_ENABLE, true);
     i2c_master_write_byte(cmd, data_byte & ~LCD_ENABLE, true);
     i2c_master_stop(cmd);
-    esp_err_t ret = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, pdMS_TO_TICKS(1000));
+    esp_err_t ret = i2c_bus_cmd(lcd->config.addr, cmd);
     i2c_cmd_link_delete(cmd);
     
     return ret;
 }
 
-static esp_err_t lcd_write_byte(uint8_t data, uint8_t rs)
+// Запись в расширитель без строба E: меняет только подсветку, контроллер дисплея ее не видит
+static esp_err_t lcd_write_expander(lcd_t *lcd)
+{
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (lcd->config.addr << 1) | I2C_MASTER_WRITE, true);
+    i2c_master_write_byte(cmd, lcd->backlight, true);
+    i2c_master_stop(cmd);
+    esp_err_t ret = i2c_bus_cmd(lcd->config.addr, cmd);
+    i2c_cmd_link_delete(cmd);
+
+    return ret;
+}
+
+static esp_err_t lcd_write_byte(lcd_t *lcd, uint8_t data, uint8_t rs)
 {
     esp_err_t ret;
     
-    ret = lcd_write_nibble(data >> 4, rs);
+    ret = lcd_write_nibble(lcd, data >> 4, rs);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to write high nibble: %s", esp_err_to_name(ret));
+        DLOGE(TAG, "0x%02x: failed to write high nibble: %s", lcd->config.addr, esp_err_to_name(ret));
         return ret;
     }
     
-    ret = lcd_write_nibble(data & 0x0F, rs);
+    ret = lcd_write_nibble(lcd, data & 0x0F, rs);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to write low nibble: %s", esp_err_to_name(ret));
+        DLOGE(TAG, "0x%02x: failed to write low nibble: %s", lcd->config.addr, esp_err_to_name(ret));
         return ret;
     }
     
+    lcd->bytes_written++;
     vTaskDelay(pdMS_TO_TICKS(2));
     return ESP_OK;
 }
 
-esp_err_t lcd_init(void)
+esp_err_t lcd_init(lcd_t *lcd, const lcd_config_t *config)
 {
-    ESP_LOGI(TAG, "Initializing LCD");
+    if (config->cols == 0 || config->cols > LCD_MAX_COLS ||
+        config->rows == 0 || config->rows > LCD_MAX_ROWS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ESP_LOGI(TAG, "Initializing LCD %ux%u at 0x%02x", config->cols, config->rows, config->addr);
+
+    memset(lcd, 0, sizeof(*lcd));
+    lcd->config = *config;
+    lcd->backlight = LCD_BACKLIGHT;
+    // Строки 3 и 4 контроллер хранит как продолжение строк 1 и 2:
+    // 0x00, 0x40, 0x14, 0x54 для 20x4 и 0x00, 0x40, 0x10, 0x50 для 16x4
+    lcd->row_offset[0] = 0x00;
+    if (LCD_MAX_ROWS > 1) lcd->row_offset[1] = 0x40;
+    if (LCD_MAX_ROWS > 2) lcd->row_offset[2] = config->cols;
+    if (LCD_MAX_ROWS > 3) lcd->row_offset[3] = 0x40 + config->cols;
     
     vTaskDelay(pdMS_TO_TICKS(50));
     
     // Инициализация LCD в 4-битном режиме
     esp_err_t ret;
     
-    ret = lcd_write_nibble(0x03, LCD_COMMAND);
+    ret = lcd_write_nibble(lcd, 0x03, LCD_COMMAND);
     if (ret != ESP_OK) return ret;
     vTaskDelay(pdMS_TO_TICKS(5));
     
-    ret = lcd_write_nibble(0x03, LCD_COMMAND);
+    ret = lcd_write_nibble(lcd, 0x03, LCD_COMMAND);
     if (ret != ESP_OK) return ret;
     vTaskDelay(pdMS_TO_TICKS(1));
     
-    ret = lcd_write_nibble(0x03, LCD_COMMAND);
+    ret = lcd_write_nibble(lcd, 0x03, LCD_COMMAND);
     if (ret != ESP_OK) return ret;
     vTaskDelay(pdMS_TO_TICKS(1));
     
-    ret = lcd_write_nibble(0x02, LCD_COMMAND);
+    ret = lcd_write_nibble(lcd, 0x02, LCD_COMMAND);
     if (ret != ESP_OK) return ret;
     
-    // Настройка дисплея
-    ret = lcd_write_byte(LCD_FUNCTION_SET | LCD_4BIT_MODE | LCD_2LINE | LCD_5x8DOTS, LCD_COMMAND);
+    // Настройка дисплея (четырехстрочные дисплеи тоже работают в режиме 2 строк)
+    ret = lcd_write_byte(lcd, LCD_FUNCTION_SET | LCD_4BIT_MODE | LCD_5x8DOTS |
+                         (config->rows > 1 ? LCD_2LINE : LCD_1LINE), LCD_COMMAND);
     if (ret != ESP_OK) return ret;
     
-    ret = lcd_write_byte(LCD_DISPLAY_CONTROL | LCD_DISPLAY_ON | LCD_CURSOR_OFF | LCD_BLINK_OFF, LCD_COMMAND);
+    ret = lcd_write_byte(lcd, LCD_DISPLAY_CONTROL | LCD_DISPLAY_ON | LCD_CURSOR_OFF | LCD_BLINK_OFF, LCD_COMMAND);
     if (ret != ESP_OK) return ret;
     
-    ret = lcd_write_byte(LCD_ENTRY_MODE_SET | LCD_ENTRY_LEFT, LCD_COMMAND);
+    ret = lcd_write_byte(lcd, LCD_ENTRY_MODE_SET | LCD_ENTRY_LEFT, LCD_COMMAND);
     if (ret != ESP_OK) return ret;
     
-    ret = lcd_write_byte(LCD_CLEAR_DISPLAY, LCD_COMMAND);
+    ret = lcd_clear(lcd);
     if (ret != ESP_OK) return ret;
     
-    vTaskDelay(pdMS_TO_TICKS(2));
-    
     ESP_LOGI(TAG, "LCD initialized successfully");
     return ESP_OK;
 }
 
-esp_err_t lcd_clear(void)
+esp_err_t lcd_clear(lcd_t *lcd)
 {
-    esp_err_t ret = lcd_write_byte(LCD_CLEAR_DISPLAY, LCD_COMMAND);
+    esp_err_t ret = lcd_write_byte(lcd, LCD_CLEAR_DISPLAY, LCD_COMMAND);
     if (ret == ESP_OK) {
         vTaskDelay(pdMS_TO_TICKS(2));
     }
+    // После очистки на экране только пробелы
+    for (int row = 0; row < lcd->config.rows; row++) {
+        memset(lcd->shown[row], ' ', lcd->config.cols);
+        lcd->shown[row][lcd->config.cols] = '\0';
+        lcd->shown_valid[row] = (ret == ESP_OK);
+    }
     return ret;
 }
 
-esp_err_t lcd_set_cursor(uint8_t col, uint8_t row)
+esp_err_t lcd_set_cursor(lcd_t *lcd, uint8_t col, uint8_t row)
 {
-    uint8_t address = (row == 0) ? LCD_LINE_1 : LCD_LINE_2;
-    address += col;
-    return lcd_write_byte(address, LCD_COMMAND);
+    if (col >= lcd->config.cols || row >= lcd->config.rows) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lcd_write_byte(lcd, LCD_SET_DDRAM_ADDR | (lcd->row_offset[row] + col), LCD_COMMAND);
 }
 
-esp_err_t lcd_print(const char *str)
+esp_err_t lcd_print(lcd_t *lcd, const char *str)
 {
     if (!str) return ESP_ERR_INVALID_ARG;
     
     esp_err_t ret = ESP_OK;
     while (*str && ret == ESP_OK) {
-        ret = lcd_write_byte(*str++, LCD_DATA);
+        ret = lcd_write_byte(lcd, *str++, LCD_DATA);
     }
     return ret;
 }
 
-esp_err_t lcd_backlight_on(void)
+esp_err_t lcd_write_row(lcd_t *lcd, uint8_t row, const char *text)
 {
-    backlight_state = LCD_BACKLIGHT;
-    return lcd_write_nibble(0x00, LCD_COMMAND);
+    if (!text || row >= lcd->config.rows) return ESP_ERR_INVALID_ARG;
+
+    uint8_t cols = lcd->config.cols;
+    char line[LCD_MAX_COLS + 1];
+    snprintf(line, sizeof(line), "%-*.*s", cols, cols, text);
+
+    // Передается только участок от первого до последнего отличающегося символа
+    char *shown = lcd->shown[row];
+    int first = 0;
+    int last = cols - 1;
+    if (lcd->shown_valid[row]) {
+        while (first < cols && line[first] == shown[first]) first++;
+        if (first == cols) return ESP_OK;
+        while (line[last] == shown[last]) last--;
+    }
+
+    // Пока строка не выведена целиком, ее содержимое на экране неизвестно
+    lcd->shown_valid[row] = false;
+    esp_err_t ret = lcd_set_cursor(lcd, first, row);
+    for (int col = first; col <= last && ret == ESP_OK; col++) {
+        ret = lcd_write_byte(lcd, line[col], LCD_DATA);
+    }
+    if (ret == ESP_OK) {
+        memcpy(shown, line, cols + 1);
+        lcd->shown_valid[row] = true;
+    }
+    return ret;
 }
 
-esp_err_t lcd_backlight_off(void)
+esp_err_t lcd_set_backlight(lcd_t *lcd, bool on)
 {
-    backlight_state = 0;
-    return lcd_write_nibble(0x00, LCD_COMMAND);
-}
\ No newline at end of file
+    lcd->backlight = on ? LCD_BACKLIGHT : 0;
+    return lcd_write_expander(lcd);
+}
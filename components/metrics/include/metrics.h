@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Интервалы гистограммы: [0], [1], [2..3], [4..7] ... [2^18..2^19) мкс и больше
+#define LATENCY_BUCKETS     21
+
+// Гистограмма задержек с логарифмическими интервалами (постоянная память)
+typedef struct {
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint32_t buckets[LATENCY_BUCKETS];
+} latency_hist_t;
+
+/**
+ * @brief Учет одного измерения
+ * @param hist Гистограмма
+ * @param us Задержка (мкс)
+ */
+void latency_record(latency_hist_t *hist, uint32_t us);
+
+/**
+ * @brief Оценка перцентиля сверху (граница интервала, не больше максимума)
+ * @param hist Гистограмма
+ * @param percent Перцентиль (0-100)
+ * @return Задержка (мкс), 0 если измерений нет
+ */
+uint32_t latency_percentile(const latency_hist_t *hist, uint32_t percent);
+
+/**
+ * @brief Оценка наибольшего свободного блока кучи пробными выделениями
+ *
+ * Двоичный поиск с точностью до 16 байт, около log2(limit) вызовов malloc.
+ * Используется там, где аллокатор не сообщает размер блока сам.
+ * @param limit Верхняя граница поиска (обычно текущий объем свободной кучи)
+ * @return Размер блока (байт)
+ */
+size_t metrics_largest_free_block(size_t limit);
+
+#ifdef __cplusplus
+}
+#endif
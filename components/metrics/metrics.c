@@ -0,0 +1,58 @@
+#include <stdlib.h>
+#include "metrics.h"
+
+static int bucket_index(uint32_t us)
+{
+    int index = 0;
+    while (us > 0 && index < LATENCY_BUCKETS - 1) {
+        us >>= 1;
+        index++;
+    }
+    return index;
+}
+
+void latency_record(latency_hist_t *hist, uint32_t us)
+{
+    hist->count++;
+    hist->total_us += us;
+    if (us > hist->max_us) {
+        hist->max_us = us;
+    }
+    hist->buckets[bucket_index(us)]++;
+}
+
+uint32_t latency_percentile(const latency_hist_t *hist, uint32_t percent)
+{
+    if (hist->count == 0) return 0;
+
+    // Номер измерения, которое должно попасть в перцентиль (с округлением вверх)
+    uint64_t rank = ((uint64_t)hist->count * percent + 99) / 100;
+    if (rank == 0) rank = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= rank) {
+            uint32_t upper = (i == 0) ? 0 : ((1u << i) - 1);
+            return (i == LATENCY_BUCKETS - 1 || upper > hist->max_us) ? hist->max_us : upper;
+        }
+    }
+    return hist->max_us;
+}
+
+size_t metrics_largest_free_block(size_t limit)
+{
+    size_t low = 0, high = limit;
+
+    while (high - low > 16) {
+        size_t mid = low + (high - low) / 2;
+        void *p = malloc(mid);
+        if (p) {
+            free(p);
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
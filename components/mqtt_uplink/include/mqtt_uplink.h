@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Постоянная MQTT сессия с брокером (clean session выключен, client id -
+ * серийный номер устройства). Темы устройства:
+ *
+ *   hydra-l/<serial>/readings   пакеты измерений (QoS 1)
+ *   hydra-l/<serial>/status     состояние, retained; завещание - "offline"
+ *   hydra-l/<serial>/cmd        команды в формате /control (подписка, QoS 1)
+ *   hydra-l/<serial>/cmd/ack    ответ на команду (QoS 0)
+ */
+
+#define MQTT_UPLINK_TOPIC_ROOT      "hydra-l"
+
+// Сколько сообщений QoS 1 может ждать PUBACK одновременно
+#define MQTT_UPLINK_WINDOW          4
+
+// Через сколько неподтвержденное сообщение освобождает место в окне
+#define MQTT_UPLINK_ACK_TIMEOUT_MS  30000
+
+#define MQTT_UPLINK_KEEPALIVE_S     120
+
+// Команда из темы cmd (data не завершается нулем)
+typedef void (*mqtt_uplink_command_fn)(const char *data, int len);
+
+typedef struct {
+    bool connected;
+    uint32_t connects;
+    uint32_t published;         // Отправлено сообщений QoS 1
+    uint32_t acked;             // Получено PUBACK
+    uint32_t expired;           // Не дождались PUBACK за MQTT_UPLINK_ACK_TIMEOUT_MS
+    uint32_t window_full;       // Отказов из-за заполненного окна
+    uint32_t in_flight;
+    uint32_t commands;
+} mqtt_uplink_stats_t;
+
+/**
+ * @brief Запуск клиента MQTT
+ * @param uri Адрес брокера (mqtt://host:1883)
+ * @param serial Серийный номер устройства: client id и часть имен тем
+ * @param on_command Обработчик команд (может быть NULL)
+ * @return ESP_OK при успехе
+ */
+esp_err_t mqtt_uplink_start(const char *uri, const char *serial, mqtt_uplink_command_fn on_command);
+
+/**
+ * @brief Есть ли соединение с брокером
+ */
+bool mqtt_uplink_connected(void);
+
+/**
+ * @brief Количество свободных мест в окне неподтвержденных сообщений
+ */
+uint32_t mqtt_uplink_window_free(void);
+
+/**
+ * @brief Публикация в тему устройства
+ * @param subtopic Тема относительно hydra-l/<serial>/
+ * @param data Данные
+ * @param len Размер данных
+ * @param qos 0 или 1 (QoS 1 занимает место в окне до получения PUBACK)
+ * @param retain Флаг retain
+ * @return ESP_OK при успехе, ESP_ERR_INVALID_STATE без соединения,
+ *         ESP_ERR_NO_MEM если окно заполнено
+ */
+esp_err_t mqtt_uplink_publish(const char *subtopic, const char *data, int len, int qos, bool retain);
+
+/**
+ * @brief Публикация пакета измерений с QoS 1
+ *
+ * Измерения считаются доставленными только по PUBACK: их число возвращает
+ * mqtt_uplink_take_samples().
+ * @param subtopic Тема относительно hydra-l/<serial>/
+ * @param data Данные
+ * @param len Размер данных
+ * @param samples Число измерений в пакете
+ * @return Как у mqtt_uplink_publish()
+ */
+esp_err_t mqtt_uplink_publish_samples(const char *subtopic, const char *data, int len, uint32_t samples);
+
+/**
+ * @brief Итог доставки пакетов измерений с прошлого вызова
+ *
+ * Подтверждения приходят в порядке отправки. Если пакет не дождался PUBACK
+ * за MQTT_UPLINK_ACK_TIMEOUT_MS, вместе с ним отбрасываются и все более
+ * поздние пакеты измерений: их нужно отправить заново, начиная с первого
+ * неподтвержденного измерения.
+ * @param acked Число измерений, подтвержденных PUBACK
+ * @return true, если неподтвержденные измерения нужно отправить заново
+ */
+bool mqtt_uplink_take_samples(uint32_t *acked);
+
+/**
+ * @brief Получение статистики
+ * @param stats Указатель для сохранения статистики
+ */
+void mqtt_uplink_get_stats(mqtt_uplink_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,253 @@
+#include <string.h>
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "mqtt_client.h"
+#include "mqtt_uplink.h"
+
+static const char *TAG = "MQTT_UPLINK";
+
+#define TOPIC_MAX_LEN   64
+
+// Сообщение QoS 1, ожидающее PUBACK
+typedef struct {
+    int msg_id;                 // 0 - место свободно
+    uint32_t sent_ms;
+    uint32_t samples;           // Измерений в пакете (mqtt_uplink_publish_samples)
+} inflight_t;
+
+static esp_mqtt_client_handle_t s_client = NULL;
+static mqtt_uplink_command_fn s_on_command = NULL;
+static char s_prefix[TOPIC_MAX_LEN];
+static char s_cmd_topic[TOPIC_MAX_LEN];
+static char s_lwt_topic[TOPIC_MAX_LEN];
+static inflight_t s_inflight[MQTT_UPLINK_WINDOW];
+static int s_early_ack = 0;         // PUBACK, пришедший раньше, чем publish вернул msg_id
+static uint32_t s_acked_samples = 0;    // Подтверждено измерений с прошлого mqtt_uplink_take_samples
+static bool s_lost_samples = false;     // Пакет с измерениями не дождался PUBACK
+static mqtt_uplink_stats_t s_stats = {0};
+
+static uint32_t now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static void drop_inflight(int slot)
+{
+    s_inflight[slot].msg_id = 0;
+    s_stats.in_flight--;
+    s_stats.expired++;
+}
+
+// Освобождение мест, подтверждение которых уже не придет. Вызывать в критической секции.
+// Брокер подтверждает QoS 1 в порядке получения (MQTT 3.1.1, 4.6), поэтому после
+// потери пакета с измерениями отброшены и более поздние: измерения уйдут заново по порядку
+static void expire_inflight(uint32_t now)
+{
+    bool lost = false;
+    for (int i = 0; i < MQTT_UPLINK_WINDOW; i++) {
+        if (s_inflight[i].msg_id != 0 && now - s_inflight[i].sent_ms > MQTT_UPLINK_ACK_TIMEOUT_MS) {
+            if (s_inflight[i].samples) lost = true;
+            drop_inflight(i);
+        }
+    }
+    if (!lost) return;
+    for (int i = 0; i < MQTT_UPLINK_WINDOW; i++) {
+        if (s_inflight[i].msg_id != 0 && s_inflight[i].samples) drop_inflight(i);
+    }
+    s_lost_samples = true;
+}
+
+// Учет PUBACK для занятого места. Вызывать в критической секции
+static void ack_inflight(int slot)
+{
+    s_acked_samples += s_inflight[slot].samples;
+    s_inflight[slot].msg_id = 0;
+    s_stats.in_flight--;
+    s_stats.acked++;
+}
+
+static void release_inflight(int msg_id)
+{
+    taskENTER_CRITICAL();
+    for (int i = 0; i < MQTT_UPLINK_WINDOW; i++) {
+        if (s_inflight[i].msg_id == msg_id) {
+            ack_inflight(i);
+            taskEXIT_CRITICAL();
+            return;
+        }
+    }
+    s_early_ack = msg_id;
+    taskEXIT_CRITICAL();
+}
+
+static esp_err_t mqtt_event_handler(esp_mqtt_event_handle_t event)
+{
+    switch (event->event_id) {
+        case MQTT_EVENT_CONNECTED:
+            ESP_LOGI(TAG, "Connected (session present %d)", event->session_present);
+            s_stats.connected = true;
+            s_stats.connects++;
+            // При сохраненной сессии подписка уже есть, но повтор безвреден
+            esp_mqtt_client_subscribe(s_client, s_cmd_topic, 1);
+            break;
+
+        case MQTT_EVENT_DISCONNECTED:
+            ESP_LOGW(TAG, "Disconnected");
+            s_stats.connected = false;
+            break;
+
+        case MQTT_EVENT_PUBLISHED:
+            release_inflight(event->msg_id);
+            break;
+
+        case MQTT_EVENT_DATA:
+            // Команды короткие: фрагментированные сообщения не принимаются
+            if (event->current_data_offset != 0 || event->data_len != event->total_data_len) {
+                ESP_LOGW(TAG, "Fragmented command dropped (%d bytes)", event->total_data_len);
+                break;
+            }
+            if (event->topic_len == (int)strlen(s_cmd_topic) &&
+                memcmp(event->topic, s_cmd_topic, event->topic_len) == 0) {
+                s_stats.commands++;
+                if (s_on_command) s_on_command(event->data, event->data_len);
+            }
+            break;
+
+        case MQTT_EVENT_ERROR:
+            ESP_LOGE(TAG, "MQTT error");
+            break;
+
+        default:
+            break;
+    }
+    return ESP_OK;
+}
+
+esp_err_t mqtt_uplink_start(const char *uri, const char *serial, mqtt_uplink_command_fn on_command)
+{
+    static const char lwt_msg[] = "{\"state\":\"offline\"}";
+
+    if (s_client) return ESP_ERR_INVALID_STATE;
+
+    snprintf(s_prefix, sizeof(s_prefix), MQTT_UPLINK_TOPIC_ROOT "/%s/", serial);
+    snprintf(s_cmd_topic, sizeof(s_cmd_topic), "%scmd", s_prefix);
+    snprintf(s_lwt_topic, sizeof(s_lwt_topic), "%sstatus", s_prefix);
+    s_on_command = on_command;
+
+    esp_mqtt_client_config_t config = {
+        .uri = uri,
+        .client_id = serial,
+        .disable_clean_session = true,
+        .keepalive = MQTT_UPLINK_KEEPALIVE_S,
+        .lwt_topic = s_lwt_topic,
+        .lwt_msg = lwt_msg,
+        .lwt_msg_len = sizeof(lwt_msg) - 1,
+        .lwt_qos = 1,
+        .lwt_retain = 1,
+        .event_handle = mqtt_event_handler,
+    };
+
+    s_client = esp_mqtt_client_init(&config);
+    if (s_client == NULL) return ESP_ERR_NO_MEM;
+
+    ESP_LOGI(TAG, "Broker %s, topics %s*", uri, s_prefix);
+    return esp_mqtt_client_start(s_client);
+}
+
+bool mqtt_uplink_connected(void)
+{
+    return s_stats.connected;
+}
+
+uint32_t mqtt_uplink_window_free(void)
+{
+    taskENTER_CRITICAL();
+    expire_inflight(now_ms());
+    uint32_t free_slots = MQTT_UPLINK_WINDOW - s_stats.in_flight;
+    taskEXIT_CRITICAL();
+    return free_slots;
+}
+
+static esp_err_t publish(const char *subtopic, const char *data, int len, int qos, bool retain,
+                         uint32_t samples)
+{
+    char topic[TOPIC_MAX_LEN];
+    int slot = -1;
+
+    if (!s_client || !s_stats.connected) return ESP_ERR_INVALID_STATE;
+
+    if (qos > 0) {
+        taskENTER_CRITICAL();
+        expire_inflight(now_ms());
+        for (int i = 0; i < MQTT_UPLINK_WINDOW; i++) {
+            if (s_inflight[i].msg_id == 0) {
+                slot = i;
+                // Место занято до получения msg_id, чтобы его не взял другой вызов
+                s_inflight[i].msg_id = -1;
+                s_inflight[i].sent_ms = now_ms();
+                s_inflight[i].samples = samples;
+                s_stats.in_flight++;
+                break;
+            }
+        }
+        if (slot < 0) s_stats.window_full++;
+        taskEXIT_CRITICAL();
+        if (slot < 0) return ESP_ERR_NO_MEM;
+    }
+
+    snprintf(topic, sizeof(topic), "%s%s", s_prefix, subtopic);
+    int msg_id = esp_mqtt_client_publish(s_client, topic, data, len, qos, retain);
+
+    if (slot >= 0) {
+        taskENTER_CRITICAL();
+        if (msg_id > 0) s_stats.published++;
+        if (s_inflight[slot].msg_id != -1) {
+            // Место отброшено expire_inflight, пока шла публикация: PUBACK не учитывается
+        } else if (msg_id > 0) {
+            if (s_early_ack == msg_id) {
+                s_early_ack = 0;
+                ack_inflight(slot);
+            } else {
+                s_inflight[slot].msg_id = msg_id;
+            }
+        } else {
+            s_inflight[slot].msg_id = 0;
+            s_stats.in_flight--;
+        }
+        taskEXIT_CRITICAL();
+    }
+    return msg_id < 0 ? ESP_FAIL : ESP_OK;
+}
+
+esp_err_t mqtt_uplink_publish(const char *subtopic, const char *data, int len, int qos, bool retain)
+{
+    return publish(subtopic, data, len, qos, retain, 0);
+}
+
+esp_err_t mqtt_uplink_publish_samples(const char *subtopic, const char *data, int len, uint32_t samples)
+{
+    return publish(subtopic, data, len, 1, false, samples);
+}
+
+bool mqtt_uplink_take_samples(uint32_t *acked)
+{
+    taskENTER_CRITICAL();
+    expire_inflight(now_ms());
+    *acked = s_acked_samples;
+    bool lost = s_lost_samples;
+    s_acked_samples = 0;
+    s_lost_samples = false;
+    taskEXIT_CRITICAL();
+    return lost;
+}
+
+void mqtt_uplink_get_stats(mqtt_uplink_stats_t *stats)
+{
+    taskENTER_CRITICAL();
+    expire_inflight(now_ms());
+    *stats = s_stats;
+    taskEXIT_CRITICAL();
+}
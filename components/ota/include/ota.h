@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Размер блока, которым образ пишется во flash (кратен 4 байтам)
+#define OTA_CHUNK_SIZE              1024
+
+// Как часто (в байтах) сохранять в NVS точку возобновления загрузки
+#define OTA_PERSIST_INTERVAL        (16 * 4096)
+
+// Сколько раз новый образ может загрузиться без подтверждения работоспособности
+#define OTA_MAX_BOOT_ATTEMPTS       3
+
+// Время, за которое новый образ должен подтвердить работоспособность
+#define OTA_HEALTH_TIMEOUT_MS       (5 * 60 * 1000)
+
+typedef enum {
+    OTA_STATE_IDLE = 0,
+    OTA_STATE_DOWNLOADING,
+    OTA_STATE_VERIFYING,
+    OTA_STATE_DONE,
+    OTA_STATE_FAILED,
+} ota_state_t;
+
+typedef struct {
+    ota_state_t state;
+    bool delta;                 // Образ собирается из дельта-патча
+    uint32_t image_size;        // Полный размер образа (байт)
+    uint32_t transfer_size;     // Передано по сети (байт)
+    uint32_t bytes_written;     // Записано в раздел (байт)
+    uint32_t resumed_from;      // Смещение, с которого продолжена загрузка
+    uint32_t throughput_bps;    // Средняя скорость загрузки (байт/с)
+    uint32_t elapsed_ms;        // Время загрузки и записи (мс)
+    uint32_t peak_heap_used;    // Максимальный расход кучи во время загрузки (байт)
+    esp_err_t last_error;
+} ota_status_t;
+
+/**
+ * @brief Проверка отката после обновления. Вызывать при старте, после nvs_flash_init()
+ *
+ * Если новый образ загружается слишком много раз без подтверждения
+ * или не подтверждает работоспособность за OTA_HEALTH_TIMEOUT_MS,
+ * загрузочным снова становится предыдущий раздел.
+ * @return ESP_OK при успехе
+ */
+esp_err_t ota_check_rollback(void);
+
+/**
+ * @brief Подтверждение работоспособности текущего образа (отменяет откат)
+ * @return ESP_OK при успехе
+ */
+esp_err_t ota_mark_healthy(void);
+
+/**
+ * @brief Запуск фоновой загрузки образа в неактивный раздел
+ *
+ * Образ скачивается блоками по OTA_CHUNK_SIZE прямо во flash, прерванная
+ * загрузка продолжается запросом Range. Если по адресу лежит дельта-патч
+ * (см. delta.h), он применяется к текущему образу потоково. Перед
+ * переключением раздела SHA-256 нового образа сверяется с "<url>.sha256".
+ *
+ * Это проверка целостности (обрыв, порча при передаче или записи), а не
+ * подлинности: хеш берется с того же сервера, что и образ, поэтому
+ * подмененный или взломанный сервер может отдать свой образ с подходящим
+ * хешем. Источник образа должен быть доверенным (локальная сеть, /ota
+ * доступен только из нее).
+ * @param url Адрес образа
+ * @param timeout_ms Таймаут HTTP операций
+ * @return ESP_OK если загрузка запущена, ESP_ERR_INVALID_STATE если уже идет
+ */
+esp_err_t ota_start(const char *url, int timeout_ms);
+
+/**
+ * @brief Получение состояния обновления
+ * @param status Указатель для сохранения состояния
+ */
+void ota_get_status(ota_status_t *status);
+
+#ifdef __cplusplus
+}
+#endif
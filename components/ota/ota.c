@@ -0,0 +1,612 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "esp_spi_flash.h"
+#include "esp_http_client.h"
+#include "nvs.h"
+#include "mbedtls/sha256.h"
+#include "delta.h"
+#include "ota.h"
+
+static const char *TAG = "OTA";
+
+#define OTA_NVS_NAMESPACE   "ota"
+#define OTA_URL_MAX_LEN     256
+#define OTA_DIGEST_LEN      32
+#define OTA_MAX_RETRIES     5
+#define OTA_RETRY_DELAY_MS  10000
+
+static char s_url[OTA_URL_MAX_LEN];
+static int s_timeout_ms;
+static uint8_t s_buf[OTA_CHUNK_SIZE];     // Прием из сети
+static uint8_t s_wbuf[OTA_CHUNK_SIZE];    // Выровненная запись во flash
+static delta_decoder_t s_delta;
+static ota_status_t s_status = {0};
+static TaskHandle_t s_task = NULL;
+static TimerHandle_t s_health_timer = NULL;
+static StaticTimer_t s_health_timer_buf;
+
+// Точка возобновления загрузки
+typedef struct {
+    uint8_t sha256[OTA_DIGEST_LEN];
+    char label[17];
+    char url[OTA_URL_MAX_LEN];
+    uint32_t offset;
+} ota_resume_t;
+
+// Запись образа в раздел: хеширование, буферизация и ленивое стирание секторов
+typedef struct {
+    const esp_partition_t *part;
+    const esp_partition_t *src;     // Исходный образ для дельта-патча
+    ota_resume_t *resume;           // NULL, если загрузку нельзя продолжить
+    uint32_t offset;
+    uint32_t erased_upto;
+    uint32_t persisted;
+    size_t fill;
+    mbedtls_sha256_context sha;
+} ota_writer_t;
+
+static esp_err_t ota_load_resume(ota_resume_t *resume)
+{
+    nvs_handle handle;
+    esp_err_t ret = nvs_open(OTA_NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (ret != ESP_OK) return ret;
+
+    size_t len = sizeof(resume->sha256);
+    ret = nvs_get_blob(handle, "sha", resume->sha256, &len);
+    if (ret == ESP_OK) {
+        len = sizeof(resume->label);
+        ret = nvs_get_str(handle, "label", resume->label, &len);
+    }
+    if (ret == ESP_OK) {
+        len = sizeof(resume->url);
+        ret = nvs_get_str(handle, "url", resume->url, &len);
+    }
+    if (ret == ESP_OK) {
+        ret = nvs_get_u32(handle, "offset", &resume->offset);
+    }
+    nvs_close(handle);
+    return ret;
+}
+
+static esp_err_t ota_save_resume(const ota_resume_t *resume)
+{
+    nvs_handle handle;
+    esp_err_t ret = nvs_open(OTA_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) return ret;
+
+    ret = nvs_set_blob(handle, "sha", resume->sha256, sizeof(resume->sha256));
+    if (ret == ESP_OK) ret = nvs_set_str(handle, "label", resume->label);
+    if (ret == ESP_OK) ret = nvs_set_str(handle, "url", resume->url);
+    if (ret == ESP_OK) ret = nvs_set_u32(handle, "offset", resume->offset);
+    if (ret == ESP_OK) ret = nvs_commit(handle);
+    nvs_close(handle);
+    return ret;
+}
+
+static void ota_clear_resume(void)
+{
+    nvs_handle handle;
+    if (nvs_open(OTA_NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) return;
+    nvs_erase_key(handle, "sha");
+    nvs_erase_key(handle, "label");
+    nvs_erase_key(handle, "url");
+    nvs_erase_key(handle, "offset");
+    nvs_commit(handle);
+    nvs_close(handle);
+}
+
+static int hex_nibble(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Загрузка ожидаемого SHA-256 из "<url>.sha256" (формат sha256sum). Хеш с того же
+// сервера защищает от порчи образа, но не от подмены самого сервера
+static esp_err_t ota_fetch_digest(uint8_t digest[OTA_DIGEST_LEN])
+{
+    char url[OTA_URL_MAX_LEN + 8];
+    snprintf(url, sizeof(url), "%s.sha256", s_url);
+
+    esp_http_client_config_t config = {
+        .url = url,
+        .timeout_ms = s_timeout_ms,
+    };
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (!client) return ESP_ERR_NO_MEM;
+
+    esp_err_t ret = esp_http_client_open(client, 0);
+    if (ret == ESP_OK) {
+        esp_http_client_fetch_headers(client);
+        char text[OTA_DIGEST_LEN * 2];
+        int len = 0;
+        while (len < (int)sizeof(text)) {
+            int n = esp_http_client_read(client, text + len, sizeof(text) - len);
+            if (n <= 0) break;
+            len += n;
+        }
+        if (esp_http_client_get_status_code(client) != 200 || len != (int)sizeof(text)) {
+            ESP_LOGE(TAG, "Failed to fetch image digest from %s", url);
+            ret = ESP_FAIL;
+        }
+        for (int i = 0; ret == ESP_OK && i < OTA_DIGEST_LEN; i++) {
+            int hi = hex_nibble(text[i * 2]);
+            int lo = hex_nibble(text[i * 2 + 1]);
+            if (hi < 0 || lo < 0) {
+                ESP_LOGE(TAG, "Malformed image digest");
+                ret = ESP_ERR_INVALID_RESPONSE;
+            } else {
+                digest[i] = (hi << 4) | lo;
+            }
+        }
+    }
+
+    esp_http_client_cleanup(client);
+    return ret;
+}
+
+// Хеширование начала раздела (буфер записи в этот момент пуст)
+static esp_err_t ota_hash_partition(const esp_partition_t *part, uint32_t length,
+                                    mbedtls_sha256_context *sha)
+{
+    for (uint32_t pos = 0; pos < length; pos += sizeof(s_wbuf)) {
+        size_t n = MIN(sizeof(s_wbuf), length - pos);
+        esp_err_t ret = esp_partition_read(part, pos, s_wbuf, n);
+        if (ret != ESP_OK) return ret;
+        mbedtls_sha256_update_ret(sha, s_wbuf, n);
+    }
+    return ESP_OK;
+}
+
+static void ota_track_heap(uint32_t heap_at_start)
+{
+    uint32_t free_heap = esp_get_free_heap_size();
+    if (heap_at_start > free_heap && heap_at_start - free_heap > s_status.peak_heap_used) {
+        s_status.peak_heap_used = heap_at_start - free_heap;
+    }
+}
+
+static esp_err_t ota_writer_flush(ota_writer_t *w)
+{
+    if (w->fill == 0) return ESP_OK;
+
+    // Хвост образа дополняется 0xFF до границы 4 байт
+    size_t aligned = (w->fill + 3) & ~3;
+    memset(s_wbuf + w->fill, 0xFF, aligned - w->fill);
+
+    while (w->erased_upto < w->offset + aligned) {
+        esp_err_t ret = esp_partition_erase_range(w->part, w->erased_upto, SPI_FLASH_SEC_SIZE);
+        if (ret != ESP_OK) return ret;
+        w->erased_upto += SPI_FLASH_SEC_SIZE;
+    }
+    esp_err_t ret = esp_partition_write(w->part, w->offset, s_wbuf, aligned);
+    if (ret != ESP_OK) return ret;
+
+    w->offset += w->fill;
+    w->fill = 0;
+    s_status.bytes_written = w->offset;
+
+    // Сохраняем только выровненное по сектору смещение: сектор за ним будет стерт заново
+    if (w->resume && w->offset - w->persisted >= OTA_PERSIST_INTERVAL) {
+        w->resume->offset = w->offset & ~(SPI_FLASH_SEC_SIZE - 1);
+        ota_save_resume(w->resume);
+        w->persisted = w->offset;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t ota_writer_write(ota_writer_t *w, const uint8_t *data, size_t len)
+{
+    if (w->offset + w->fill + len > w->part->size) return ESP_ERR_INVALID_SIZE;
+
+    mbedtls_sha256_update_ret(&w->sha, data, len);
+    while (len > 0) {
+        size_t n = MIN(len, sizeof(s_wbuf) - w->fill);
+        memcpy(s_wbuf + w->fill, data, n);
+        w->fill += n;
+        data += n;
+        len -= n;
+        if (w->fill == sizeof(s_wbuf)) {
+            esp_err_t ret = ota_writer_flush(w);
+            if (ret != ESP_OK) return ret;
+        }
+    }
+    return ESP_OK;
+}
+
+static int ota_delta_read(void *ctx, uint32_t offset, uint8_t *buf, size_t len)
+{
+    ota_writer_t *w = (ota_writer_t *)ctx;
+    return esp_partition_read(w->src, offset, buf, len) == ESP_OK ? 0 : -1;
+}
+
+static int ota_delta_write(void *ctx, const uint8_t *buf, size_t len)
+{
+    return ota_writer_write((ota_writer_t *)ctx, buf, len) == ESP_OK ? 0 : -1;
+}
+
+// Подготовка применения дельта-патча к текущему образу
+static esp_err_t ota_delta_begin(ota_writer_t *w, const uint8_t *data)
+{
+    delta_header_t header;
+    if (delta_parse_header(data, DELTA_HEADER_SIZE, &header) != DELTA_OK) {
+        ESP_LOGE(TAG, "Unsupported delta patch header");
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (header.dst_size > w->part->size) return ESP_ERR_INVALID_SIZE;
+
+    w->src = esp_ota_get_running_partition();
+    if (header.src_size > w->src->size) return ESP_ERR_INVALID_SIZE;
+
+    // Патч должен быть построен от образа, который сейчас работает
+    uint8_t digest[OTA_DIGEST_LEN];
+    mbedtls_sha256_context sha;
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts_ret(&sha, 0);
+    esp_err_t ret = ota_hash_partition(w->src, header.src_size, &sha);
+    mbedtls_sha256_finish_ret(&sha, digest);
+    mbedtls_sha256_free(&sha);
+    if (ret != ESP_OK) return ret;
+    if (memcmp(digest, header.src_sha256, OTA_DIGEST_LEN) != 0) {
+        ESP_LOGE(TAG, "Delta patch was built for a different base image");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    delta_init(&s_delta, &header, ota_delta_read, ota_delta_write, w);
+    s_status.delta = true;
+    s_status.image_size = header.dst_size;
+    ESP_LOGI(TAG, "Applying delta patch: %u -> %u bytes", header.src_size, header.dst_size);
+    return ESP_OK;
+}
+
+// Отметка о переключении: откат возможен, пока образ не подтвердит работоспособность
+static esp_err_t ota_switch_partition(const esp_partition_t *part)
+{
+    const esp_partition_t *running = esp_ota_get_running_partition();
+
+    nvs_handle handle;
+    esp_err_t ret = nvs_open(OTA_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) return ret;
+    ret = nvs_set_str(handle, "prev", running->label);
+    if (ret == ESP_OK) ret = nvs_set_u8(handle, "tries", 0);
+    if (ret == ESP_OK) ret = nvs_set_u8(handle, "pending", 1);
+    if (ret == ESP_OK) ret = nvs_commit(handle);
+    nvs_close(handle);
+    if (ret != ESP_OK) return ret;
+
+    // esp_ota_set_boot_partition() дополнительно проверяет заголовок и контрольную сумму образа
+    ret = esp_ota_set_boot_partition(part);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set boot partition: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    ota_clear_resume();
+    return ESP_OK;
+}
+
+static void ota_clear_pending(void)
+{
+    nvs_handle handle;
+    if (nvs_open(OTA_NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) return;
+    nvs_erase_key(handle, "pending");
+    nvs_erase_key(handle, "tries");
+    nvs_erase_key(handle, "prev");
+    nvs_commit(handle);
+    nvs_close(handle);
+}
+
+static void ota_rollback(void)
+{
+    char label[17] = {0};
+    size_t len = sizeof(label);
+    nvs_handle handle;
+    if (nvs_open(OTA_NVS_NAMESPACE, NVS_READONLY, &handle) == ESP_OK) {
+        nvs_get_str(handle, "prev", label, &len);
+        nvs_close(handle);
+    }
+    ota_clear_pending();
+
+    const esp_partition_t *prev = esp_partition_find_first(ESP_PARTITION_TYPE_APP,
+                                                           ESP_PARTITION_SUBTYPE_ANY, label);
+    if (!prev || esp_ota_set_boot_partition(prev) != ESP_OK) {
+        ESP_LOGE(TAG, "Rollback to '%s' failed", label);
+        return;
+    }
+    ESP_LOGW(TAG, "Rolling back to partition '%s'", label);
+    esp_restart();
+}
+
+static void ota_health_timeout(TimerHandle_t timer)
+{
+    ESP_LOGE(TAG, "New image did not report healthy in time");
+    ota_rollback();
+}
+
+esp_err_t ota_check_rollback(void)
+{
+    nvs_handle handle;
+    esp_err_t ret = nvs_open(OTA_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) return ret;
+
+    uint8_t pending = 0, tries = 0;
+    char prev[17] = {0};
+    size_t len = sizeof(prev);
+    nvs_get_u8(handle, "pending", &pending);
+    nvs_get_u8(handle, "tries", &tries);
+    nvs_get_str(handle, "prev", prev, &len);
+    if (!pending) {
+        nvs_close(handle);
+        return ESP_OK;
+    }
+
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    if (strcmp(running->label, prev) == 0) {
+        // Загрузчик сам вернулся на старый образ
+        nvs_close(handle);
+        ESP_LOGW(TAG, "Update was not booted, staying on '%s'", prev);
+        ota_clear_pending();
+        return ESP_OK;
+    }
+
+    tries++;
+    nvs_set_u8(handle, "tries", tries);
+    nvs_commit(handle);
+    nvs_close(handle);
+
+    if (tries > OTA_MAX_BOOT_ATTEMPTS) {
+        ESP_LOGE(TAG, "Image failed to become healthy after %d boots", OTA_MAX_BOOT_ATTEMPTS);
+        ota_rollback();
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Running updated image, boot attempt %d of %d", tries, OTA_MAX_BOOT_ATTEMPTS);
+    s_health_timer = xTimerCreateStatic("ota_health", pdMS_TO_TICKS(OTA_HEALTH_TIMEOUT_MS),
+                                        pdFALSE, NULL, ota_health_timeout, &s_health_timer_buf);
+    if (s_health_timer) {
+        xTimerStart(s_health_timer, 0);
+    }
+    return ESP_OK;
+}
+
+esp_err_t ota_mark_healthy(void)
+{
+    if (!s_health_timer) return ESP_OK;
+
+    xTimerStop(s_health_timer, 0);
+    xTimerDelete(s_health_timer, 0);
+    s_health_timer = NULL;
+    ota_clear_pending();
+    ESP_LOGI(TAG, "Updated image marked healthy");
+    return ESP_OK;
+}
+
+static esp_err_t ota_download(void)
+{
+    uint32_t heap_at_start = esp_get_free_heap_size();
+    const esp_partition_t *part = esp_ota_get_next_update_partition(NULL);
+    if (!part) {
+        ESP_LOGE(TAG, "No OTA partition available");
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    static ota_resume_t resume;
+    memset(&resume, 0, sizeof(resume));
+    s_status.delta = false;
+    esp_err_t ret = ota_fetch_digest(resume.sha256);
+    if (ret != ESP_OK) return ret;
+    strncpy(resume.label, part->label, sizeof(resume.label) - 1);
+    strcpy(resume.url, s_url);
+
+    // Продолжаем только загрузку того же образа с того же адреса в тот же раздел
+    static ota_resume_t saved;
+    memset(&saved, 0, sizeof(saved));
+    uint32_t offset = 0;
+    if (ota_load_resume(&saved) == ESP_OK &&
+        memcmp(saved.sha256, resume.sha256, OTA_DIGEST_LEN) == 0 &&
+        strcmp(saved.label, resume.label) == 0 &&
+        strcmp(saved.url, resume.url) == 0 &&
+        saved.offset < part->size) {
+        offset = saved.offset;
+    }
+
+    ota_writer_t writer = {
+        .part = part,
+        .resume = &resume,
+    };
+    mbedtls_sha256_init(&writer.sha);
+    mbedtls_sha256_starts_ret(&writer.sha, 0);
+
+    esp_http_client_config_t config = {
+        .url = s_url,
+        .timeout_ms = s_timeout_ms,
+    };
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (!client) {
+        mbedtls_sha256_free(&writer.sha);
+        return ESP_ERR_NO_MEM;
+    }
+
+    char range[32];
+    if (offset > 0) {
+        snprintf(range, sizeof(range), "bytes=%u-", offset);
+        esp_http_client_set_header(client, "Range", range);
+    }
+
+    ret = esp_http_client_open(client, 0);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open %s: %s", s_url, esp_err_to_name(ret));
+        goto cleanup;
+    }
+
+    int content_length = esp_http_client_fetch_headers(client);
+    int status = esp_http_client_get_status_code(client);
+    if (status == 200 && offset > 0) {
+        ESP_LOGW(TAG, "Server ignored Range request, restarting from 0");
+        offset = 0;
+    } else if (status != 200 && status != 206) {
+        ESP_LOGE(TAG, "Unexpected HTTP status %d", status);
+        ret = ESP_FAIL;
+        goto cleanup;
+    }
+
+    if (content_length <= 0 || offset + content_length > part->size) {
+        ESP_LOGE(TAG, "Invalid image size: %d", content_length);
+        ret = ESP_ERR_INVALID_SIZE;
+        goto cleanup;
+    }
+
+    if (offset > 0) {
+        ret = ota_hash_partition(part, offset, &writer.sha);
+        if (ret != ESP_OK) goto cleanup;
+        ESP_LOGI(TAG, "Resuming download at %u bytes", offset);
+    }
+
+    writer.offset = offset;
+    writer.erased_upto = offset;
+    writer.persisted = offset;
+    s_status.image_size = offset + content_length;
+    s_status.transfer_size = content_length;
+    s_status.resumed_from = offset;
+    s_status.bytes_written = offset;
+    s_status.state = OTA_STATE_DOWNLOADING;
+
+    int64_t started = esp_timer_get_time();
+    uint32_t received = 0;
+    int delta_ret = DELTA_OK;
+
+    while (received < (uint32_t)content_length && delta_ret == DELTA_OK) {
+        // С начала файла сначала читается заголовок, чтобы распознать дельта-патч
+        size_t want = MIN(sizeof(s_buf), content_length - received);
+        if (received == 0 && offset == 0 && want >= DELTA_HEADER_SIZE) {
+            want = DELTA_HEADER_SIZE;
+        }
+
+        size_t filled = 0;
+        while (filled < want) {
+            int n = esp_http_client_read(client, (char *)s_buf + filled, want - filled);
+            if (n <= 0) {
+                ESP_LOGE(TAG, "Connection lost at %u bytes", offset + received + filled);
+                ret = ESP_ERR_TIMEOUT;
+                goto cleanup;
+            }
+            filled += n;
+        }
+
+        if (received == 0 && offset == 0 && filled == DELTA_HEADER_SIZE &&
+            memcmp(s_buf, DELTA_MAGIC, 4) == 0) {
+            // Дельта-патч собирается целиком заново, точка возобновления не нужна
+            ota_clear_resume();
+            writer.resume = NULL;
+            ret = ota_delta_begin(&writer, s_buf);
+        } else if (s_status.delta) {
+            delta_ret = delta_feed(&s_delta, s_buf, filled);
+            ret = (delta_ret < 0) ? ESP_ERR_INVALID_RESPONSE : ESP_OK;
+        } else {
+            ret = ota_writer_write(&writer, s_buf, filled);
+        }
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to write image: %s", esp_err_to_name(ret));
+            goto cleanup;
+        }
+
+        received += filled;
+        ota_track_heap(heap_at_start);
+    }
+
+    if (s_status.delta && delta_ret != DELTA_DONE) {
+        ESP_LOGE(TAG, "Delta patch is truncated or corrupt");
+        ret = ESP_ERR_INVALID_RESPONSE;
+        goto cleanup;
+    }
+
+    ret = ota_writer_flush(&writer);
+    if (ret != ESP_OK) goto cleanup;
+
+    uint32_t elapsed_ms = (uint32_t)((esp_timer_get_time() - started) / 1000);
+    s_status.elapsed_ms = elapsed_ms;
+    if (elapsed_ms > 0) {
+        s_status.throughput_bps = (uint32_t)((uint64_t)received * 1000 / elapsed_ms);
+    }
+
+    s_status.state = OTA_STATE_VERIFYING;
+    uint8_t digest[OTA_DIGEST_LEN];
+    mbedtls_sha256_finish_ret(&writer.sha, digest);
+    if (memcmp(digest, resume.sha256, OTA_DIGEST_LEN) != 0) {
+        ESP_LOGE(TAG, "Image SHA-256 mismatch");
+        ota_clear_resume();
+        ret = ESP_ERR_INVALID_CRC;
+        goto cleanup;
+    }
+
+    ret = ota_switch_partition(part);
+
+cleanup:
+    esp_http_client_cleanup(client);
+    mbedtls_sha256_free(&writer.sha);
+    return ret;
+}
+
+static void ota_task(void *pvParameters)
+{
+    esp_err_t ret = ESP_FAIL;
+    for (int attempt = 1; attempt <= OTA_MAX_RETRIES; attempt++) {
+        ret = ota_download();
+        // Повторяем только сетевые ошибки: загрузка продолжится с точки возобновления
+        if (ret != ESP_ERR_TIMEOUT && ret != ESP_ERR_HTTP_CONNECT) break;
+        ESP_LOGW(TAG, "Download attempt %d failed, retrying", attempt);
+        vTaskDelay(pdMS_TO_TICKS(OTA_RETRY_DELAY_MS));
+    }
+
+    s_status.last_error = ret;
+    if (ret == ESP_OK) {
+        s_status.state = OTA_STATE_DONE;
+        ESP_LOGI(TAG, "Update complete: %u byte image, %u bytes transferred%s in %u ms",
+                 s_status.image_size, s_status.transfer_size,
+                 s_status.delta ? " as delta" : "", s_status.elapsed_ms);
+        ESP_LOGI(TAG, "Throughput %u B/s, peak heap %u bytes",
+                 s_status.throughput_bps, s_status.peak_heap_used);
+        ESP_LOGI(TAG, "Restarting into new image");
+        vTaskDelay(pdMS_TO_TICKS(1000));
+        esp_restart();
+    }
+
+    s_status.state = OTA_STATE_FAILED;
+    ESP_LOGE(TAG, "Update failed: %s", esp_err_to_name(ret));
+    s_task = NULL;
+    vTaskDelete(NULL);
+}
+
+esp_err_t ota_start(const char *url, int timeout_ms)
+{
+    if (!url || strlen(url) >= sizeof(s_url)) return ESP_ERR_INVALID_ARG;
+    if (s_task) return ESP_ERR_INVALID_STATE;
+
+    strcpy(s_url, url);
+    s_timeout_ms = timeout_ms;
+    memset(&s_status, 0, sizeof(s_status));
+    s_status.state = OTA_STATE_DOWNLOADING;
+
+    if (xTaskCreate(ota_task, "ota_task", 4096, NULL, 3, &s_task) != pdPASS) {
+        s_task = NULL;
+        s_status.state = OTA_STATE_IDLE;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void ota_get_status(ota_status_t *status)
+{
+    *status = s_status;
+}
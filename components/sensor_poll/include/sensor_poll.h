@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Измерение BME280 и восстановление после сбоя для health_poll: функции
+ * sensor_poll_measure и sensor_poll_recover подставляются в health_ops_t
+ * с указателем на sensor_poll_t в ctx. Источник времени (now_us) задает
+ * вызывающий. Тот же код собирается в test/host/test_health с моделью шины.
+ */
+
+// Сколько раз дождаться конца измерения после расчетного времени, по одному тику
+#define SENSOR_POLL_COLLECT_RETRIES 5
+
+typedef struct {
+    TickType_t conversion;      // Расчетное время измерения, тиков (с округлением вверх)
+    bool ready;                 // Датчик инициализирован
+    uint32_t reinits;           // Повторных инициализаций при восстановлении
+    float temp, hum, press;     // Результат последней удачной попытки
+} sensor_poll_t;
+
+/**
+ * @brief Первая инициализация датчика и расчет времени измерения
+ * @param poll Состояние опроса
+ * @return Результат bme280_init (при ошибке датчик восстанавливается опросом)
+ */
+esp_err_t sensor_poll_init(sensor_poll_t *poll);
+
+/**
+ * @brief Одно измерение: запуск, ожидание преобразования, чтение результата
+ * @param ctx sensor_poll_t
+ * @return ESP_OK при успехе, ESP_ERR_INVALID_STATE если датчик не инициализирован
+ */
+int sensor_poll_measure(void *ctx);
+
+/**
+ * @brief Восстановление после сбоя: датчик без настроек (провал питания)
+ *        инициализируется заново, при ошибке шины сначала освобождается шина
+ * @param ctx sensor_poll_t
+ * @param err Ошибка неудачной попытки
+ */
+void sensor_poll_recover(void *ctx, int err);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,40 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "bme280.h"
+#include "i2c_bus.h"
+#include "sensor_poll.h"
+
+esp_err_t sensor_poll_init(sensor_poll_t *poll)
+{
+    poll->conversion = pdMS_TO_TICKS((bme280_measure_time_us() + 999) / 1000) + 1;
+    esp_err_t ret = bme280_init();
+    poll->ready = (ret == ESP_OK);
+    return ret;
+}
+
+int sensor_poll_measure(void *ctx)
+{
+    sensor_poll_t *poll = ctx;
+    if (!poll->ready) return ESP_ERR_INVALID_STATE;
+
+    esp_err_t ret = bme280_trigger();
+    if (ret == ESP_OK) {
+        vTaskDelay(poll->conversion);
+        ret = bme280_collect(&poll->temp, &poll->hum, &poll->press);
+        for (int i = 0; i < SENSOR_POLL_COLLECT_RETRIES && ret == ESP_ERR_INVALID_STATE; i++) {
+            vTaskDelay(1);
+            ret = bme280_collect(&poll->temp, &poll->hum, &poll->press);
+        }
+    }
+    return ret;
+}
+
+void sensor_poll_recover(void *ctx, int err)
+{
+    sensor_poll_t *poll = ctx;
+    if (err != ESP_ERR_INVALID_RESPONSE) {
+        i2c_bus_recover();
+    }
+    poll->ready = (bme280_init() == ESP_OK);
+    poll->reinits++;
+}
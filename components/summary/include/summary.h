@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Потоковая сводка ряда измерений в постоянной памяти: число, среднее и
+ * дисперсия (алгоритм Уэлфорда), минимум, максимум и приближенные квантили
+ * p5/p50/p95 алгоритмом P² (Jain, Chlamtac, 1985) - пять маркеров на квантиль,
+ * сами измерения не хранятся. Для стационарного ряда ошибка квантиля -
+ * сотые доли процента размаха; при суточном ходе, когда измерения приходят
+ * почти упорядоченными, - до 2-3% размаха (0.3-0.4 °C для суточного окна).
+ *
+ * Окно сводки (summary_window_t) копит измерения за период и по его
+ * окончании сохраняет итог. Окна выровнены на кратные периоду моменты от
+ * старта устройства. Модуль не зависит от SDK.
+ */
+
+#define SUMMARY_QUANTILES   3
+
+// Индексы квантилей в summary_result_t.quantile
+#define SUMMARY_P5          0
+#define SUMMARY_P50         1
+#define SUMMARY_P95         2
+
+// Оценка одного квантиля: высоты и позиции (с 1) пяти маркеров
+typedef struct {
+    float height[5];
+    int32_t pos[5];
+} summary_p2_t;
+
+typedef struct {
+    uint32_t count;
+    float min;
+    float max;
+    double mean;
+    double m2;                  // Сумма квадратов отклонений от среднего
+    summary_p2_t p2[SUMMARY_QUANTILES];
+} summary_t;
+
+typedef struct {
+    uint32_t count;             // 0 - измерений не было, остальные поля не заполнены
+    float mean;
+    float stddev;               // Выборочное стандартное отклонение
+    float min;
+    float max;
+    float quantile[SUMMARY_QUANTILES];
+} summary_result_t;
+
+typedef struct {
+    uint32_t period_s;
+    uint32_t start_s;           // Начало текущего окна (с от старта)
+    summary_t current;
+    uint32_t closed;            // Завершенных окон
+    uint32_t last_start_s;      // Начало последнего завершенного окна
+    summary_result_t last;      // Итог последнего завершенного окна
+} summary_window_t;
+
+/**
+ * @brief Очистка сводки
+ * @param summary Сводка
+ */
+void summary_reset(summary_t *summary);
+
+/**
+ * @brief Учет измерения
+ * @param summary Сводка
+ * @param value Значение
+ */
+void summary_add(summary_t *summary, float value);
+
+/**
+ * @brief Итог сводки на текущий момент
+ * @param summary Сводка
+ * @param result Итог (count 0, если измерений нет)
+ */
+void summary_get(const summary_t *summary, summary_result_t *result);
+
+/**
+ * @brief Инициализация окна
+ * @param window Окно
+ * @param period_s Длительность окна (с, больше 0)
+ * @param now_s Текущее время (с от старта)
+ */
+void summary_window_init(summary_window_t *window, uint32_t period_s, uint32_t now_s);
+
+/**
+ * @brief Учет измерения в окне; если окно истекло, оно сначала закрывается
+ * @param window Окно
+ * @param now_s Время измерения (с от старта)
+ * @param value Значение
+ * @return true, если перед учетом было закрыто окно (итог в window->last)
+ */
+bool summary_window_add(summary_window_t *window, uint32_t now_s, float value);
+
+#ifdef __cplusplus
+}
+#endif
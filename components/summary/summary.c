@@ -0,0 +1,135 @@
+#include <string.h>
+#include <math.h>
+#include "summary.h"
+
+static const float quantiles[SUMMARY_QUANTILES] = { 0.05f, 0.50f, 0.95f };
+
+void summary_reset(summary_t *summary)
+{
+    memset(summary, 0, sizeof(*summary));
+}
+
+// Пока измерений меньше пяти, маркеры - сами измерения по возрастанию
+static void p2_insert(summary_p2_t *p2, uint32_t count, float value)
+{
+    uint32_t i = count;
+    while (i > 0 && p2->height[i - 1] > value) {
+        p2->height[i] = p2->height[i - 1];
+        i--;
+    }
+    p2->height[i] = value;
+    if (count == 4) {
+        for (int k = 0; k < 5; k++) p2->pos[k] = k + 1;
+    }
+}
+
+// Параболическая (P²) поправка высоты маркера i при сдвиге на d
+static float p2_parabolic(const summary_p2_t *p2, int i, int d)
+{
+    const float *q = p2->height;
+    const int32_t *n = p2->pos;
+    return q[i] + (float)d / (n[i + 1] - n[i - 1]) *
+           ((n[i] - n[i - 1] + d) * (q[i + 1] - q[i]) / (n[i + 1] - n[i]) +
+            (n[i + 1] - n[i] - d) * (q[i] - q[i - 1]) / (n[i] - n[i - 1]));
+}
+
+// count - число измерений с учетом нового
+static void p2_update(summary_p2_t *p2, float p, uint32_t count, float value)
+{
+    float *q = p2->height;
+    int32_t *n = p2->pos;
+    int k;
+
+    if (value < q[0]) {
+        q[0] = value;
+        k = 0;
+    } else if (value >= q[4]) {
+        q[4] = value;
+        k = 3;
+    } else {
+        k = 0;
+        while (value >= q[k + 1]) k++;
+    }
+    for (int i = k + 1; i < 5; i++) n[i]++;
+
+    // Желаемые позиции средних маркеров: 1 + (count - 1) * {p/2, p, (1+p)/2}
+    const float step[3] = { p / 2, p, (1 + p) / 2 };
+    for (int i = 1; i <= 3; i++) {
+        float delta = 1.0f + (count - 1) * step[i - 1] - n[i];
+        if ((delta >= 1.0f && n[i + 1] - n[i] > 1) || (delta <= -1.0f && n[i - 1] - n[i] < -1)) {
+            int d = delta > 0 ? 1 : -1;
+            float h = p2_parabolic(p2, i, d);
+            if (q[i - 1] < h && h < q[i + 1]) {
+                q[i] = h;
+            } else {
+                // Парабола вышла за соседей - линейная поправка
+                q[i] += d * (q[i + d] - q[i]) / (n[i + d] - n[i]);
+            }
+            n[i] += d;
+        }
+    }
+}
+
+void summary_add(summary_t *summary, float value)
+{
+    if (summary->count == 0 || value < summary->min) summary->min = value;
+    if (summary->count == 0 || value > summary->max) summary->max = value;
+
+    for (int i = 0; i < SUMMARY_QUANTILES; i++) {
+        if (summary->count < 5) {
+            p2_insert(&summary->p2[i], summary->count, value);
+        } else {
+            p2_update(&summary->p2[i], quantiles[i], summary->count + 1, value);
+        }
+    }
+
+    summary->count++;
+    double delta = value - summary->mean;
+    summary->mean += delta / summary->count;
+    summary->m2 += delta * (value - summary->mean);
+}
+
+void summary_get(const summary_t *summary, summary_result_t *result)
+{
+    memset(result, 0, sizeof(*result));
+    result->count = summary->count;
+    if (summary->count == 0) return;
+
+    result->mean = summary->mean;
+    result->stddev = summary->count > 1 ? sqrt(summary->m2 / (summary->count - 1)) : 0;
+    result->min = summary->min;
+    result->max = summary->max;
+    for (int i = 0; i < SUMMARY_QUANTILES; i++) {
+        if (summary->count <= 5) {
+            // Маркеры еще равны самим измерениям: точный квантиль (ближайший ранг)
+            uint32_t rank = (uint32_t)(quantiles[i] * (summary->count - 1) + 0.5f);
+            result->quantile[i] = summary->p2[i].height[rank];
+        } else {
+            result->quantile[i] = summary->p2[i].height[2];
+        }
+    }
+}
+
+void summary_window_init(summary_window_t *window, uint32_t period_s, uint32_t now_s)
+{
+    memset(window, 0, sizeof(*window));
+    window->period_s = period_s;
+    window->start_s = now_s - now_s % period_s;
+}
+
+bool summary_window_add(summary_window_t *window, uint32_t now_s, float value)
+{
+    bool closed = false;
+
+    if (now_s - window->start_s >= window->period_s) {
+        summary_get(&window->current, &window->last);
+        window->last_start_s = window->start_s;
+        window->closed++;
+        // Окна без измерений (датчик не отвечал) пропускаются
+        window->start_s = now_s - now_s % window->period_s;
+        summary_reset(&window->current);
+        closed = true;
+    }
+    summary_add(&window->current, value);
+    return closed;
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "derived.h"
+#include "summary.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Формирование полезной нагрузки телеметрии. Модуль не зависит от SDK и
+ * cJSON, чтобы тот же код можно было собрать на хосте (эмулятор парка
+ * устройств и нагрузочные тесты сервера).
+ */
+
+#define TELEMETRY_VERSION       "2024-03-20"
+
+// Сколько измерений хранится до отправки (самые старые вытесняются)
+#define TELEMETRY_BATCH_MAX     32
+
+typedef struct {
+    uint32_t uptime_s;          // Время измерения от старта устройства (с)
+    float temperature;
+    float humidity;
+    float pressure;
+    derived_t derived;          // Производные величины (точка росы и т.д.)
+    uint8_t health;             // Исправность датчика: 0 - исправен, 1 - сбои, 2 - отказ
+} telemetry_sample_t;
+
+typedef struct {
+    const char *serial;
+    const char *akey;
+    int rssi;
+    const char *mac;
+    const char *ip;
+    const char *sensor_health;  // "ok", "degraded", "failed"
+} telemetry_device_t;
+
+// Кольцевой буфер измерений, ожидающих отправки
+typedef struct {
+    telemetry_sample_t samples[TELEMETRY_BATCH_MAX];
+    uint32_t head;              // Индекс самого старого измерения
+    uint32_t count;
+    uint32_t dropped;           // Вытеснено без отправки
+    uint32_t sent;              // Из начала буфера: отправлены, ждут подтверждения
+    uint32_t sent_evicted;      // Вытеснены, не дождавшись подтверждения
+} telemetry_batch_t;
+
+/**
+ * @brief Добавление измерения (при переполнении вытесняется самое старое)
+ * @param batch Буфер
+ * @param sample Измерение
+ */
+void telemetry_batch_push(telemetry_batch_t *batch, const telemetry_sample_t *sample);
+
+/**
+ * @brief Удаление отправленных измерений из начала буфера
+ * @param batch Буфер
+ * @param count Количество
+ */
+void telemetry_batch_consume(telemetry_batch_t *batch, uint32_t count);
+
+/**
+ * @brief Отметка измерений, ушедших пакетом без подтверждения доставки
+ *
+ * Отмеченные измерения остаются в буфере до telemetry_batch_ack() и
+ * пропускаются telemetry_encode_batch().
+ * @param batch Буфер
+ * @param count Количество (следующие за уже отмеченными)
+ */
+void telemetry_batch_mark_sent(telemetry_batch_t *batch, uint32_t count);
+
+/**
+ * @brief Подтверждение доставки отмеченных измерений в порядке отправки
+ *
+ * Подтверждения вытесненных до доставки измерений засчитываются первыми,
+ * чтобы не удалить еще не отправленные.
+ * @param batch Буфер
+ * @param count Количество подтвержденных измерений
+ */
+void telemetry_batch_ack(telemetry_batch_t *batch, uint32_t count);
+
+/**
+ * @brief Снятие отметок: неподтвержденные измерения будут отправлены заново
+ * @param batch Буфер
+ */
+void telemetry_batch_resend(telemetry_batch_t *batch);
+
+/**
+ * @brief Документ для jsonadd.php (одно измерение, формат HTTP POST)
+ *
+ * Объекты system, BME280 и derived. Сводок по окнам в документе нет: они
+ * уходят только через MQTT (telemetry_encode_summary) и видны в /getData.
+ * @param device Сведения об устройстве
+ * @param sample Измерение
+ * @param buf Буфер
+ * @param len Размер буфера
+ * @return Длина документа или -1, если буфер мал
+ */
+int telemetry_encode_post(const telemetry_device_t *device, const telemetry_sample_t *sample,
+                          char *buf, size_t len);
+
+/**
+ * @brief Пакет измерений: {"serial":..,"samples":[[uptime_s,t,h,p,td,ah,hi,p0],...]}
+ *
+ * В пакет попадает столько измерений, следующих за ждущими подтверждения
+ * (batch->sent), сколько помещается в buf, но не больше max_samples.
+ * Буфер не изменяется.
+ * td - точка росы (°C), ah - абсолютная влажность (г/м³), hi - индекс жары (°C),
+ * p0 - давление на уровне моря (гПа).
+ * @param device Сведения об устройстве
+ * @param batch Буфер измерений
+ * @param max_samples Ограничение числа измерений
+ * @param buf Буфер
+ * @param len Размер буфера
+ * @param encoded Число измерений в пакете
+ * @return Длина документа или -1, если не поместилось ни одного измерения
+ */
+int telemetry_encode_batch(const telemetry_device_t *device, const telemetry_batch_t *batch,
+                           uint32_t max_samples, char *buf, size_t len, uint32_t *encoded);
+
+/**
+ * @brief Состояние устройства: версия, адреса, RSSI, время работы, исправность датчика
+ * @param device Сведения об устройстве
+ * @param uptime_s Время работы (с)
+ * @param buf Буфер
+ * @param len Размер буфера
+ * @return Длина документа или -1, если буфер мал
+ */
+int telemetry_encode_status(const telemetry_device_t *device, uint32_t uptime_s,
+                            char *buf, size_t len);
+
+// Каналы сводок (components/summary) в порядке полей telemetry_sample_t
+#define TELEMETRY_CHANNELS      3
+
+extern const char *const telemetry_channels[TELEMETRY_CHANNELS];
+
+/**
+ * @brief Сводка одного канала:
+ *        {"n":..,"mean":..,"sd":..,"min":..,"max":..,"p5":..,"p50":..,"p95":..}
+ *        (при n = 0 остальных полей нет)
+ * @param result Итог сводки
+ * @param buf Буфер
+ * @param len Размер буфера
+ * @return Длина документа или -1, если буфер мал
+ */
+int telemetry_encode_stats(const summary_result_t *result, char *buf, size_t len);
+
+/**
+ * @brief Итог окна сводок:
+ *        {"serial":..,"period_s":..,"start_s":..,"temperature":{..},"humidity":{..},"pressure":{..}}
+ * @param device Сведения об устройстве
+ * @param period_s Длительность окна (с)
+ * @param start_s Начало окна (с от старта устройства)
+ * @param results Итоги каналов, TELEMETRY_CHANNELS штук
+ * @param buf Буфер
+ * @param len Размер буфера
+ * @return Длина документа или -1, если буфер мал
+ */
+int telemetry_encode_summary(const telemetry_device_t *device, uint32_t period_s, uint32_t start_s,
+                             const summary_result_t *results, char *buf, size_t len);
+
+/*
+ * Кадр UDP маяка (little endian, TELEMETRY_FRAME_SIZE байт + подпись):
+ *
+ *   0  "HY", версия 1, флаги (биты 0-1 - исправность датчика, как health)
+ *   4  seq (u32)           номер кадра с момента старта
+ *   8  uptime_s (u32)
+ *   12 MAC (6 байт)
+ *   18 температура (i16, 0.01 °C)
+ *   20 влажность (u16, 0.01 %)
+ *   22 давление (u32, Па)
+ *   26 RSSI (i8), резерв (u8)
+ *   28 период отправки (u16, с), резерв (u16)
+ *   32 подпись: первые 8 байт HMAC-SHA256(ключ, байты 0..31)
+ */
+#define TELEMETRY_FRAME_MAGIC       "HY"
+#define TELEMETRY_FRAME_VERSION     1
+#define TELEMETRY_FRAME_SIZE        32
+#define TELEMETRY_FRAME_TAG_SIZE    8
+
+/**
+ * @brief Неподписанная часть кадра UDP маяка
+ * @param mac MAC адрес устройства
+ * @param rssi Уровень сигнала (dBm)
+ * @param seq Номер кадра
+ * @param interval_s Период отправки (с)
+ * @param sample Измерение
+ * @param buf Буфер не меньше TELEMETRY_FRAME_SIZE
+ * @return TELEMETRY_FRAME_SIZE
+ */
+int telemetry_encode_frame(const uint8_t mac[6], int rssi, uint32_t seq, uint16_t interval_s,
+                           const telemetry_sample_t *sample, uint8_t *buf);
+
+#ifdef __cplusplus
+}
+#endif
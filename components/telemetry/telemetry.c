@@ -0,0 +1,205 @@
+#include <stdio.h>
+#include <string.h>
+#include "telemetry.h"
+#include "jsonstr.h"
+
+void telemetry_batch_push(telemetry_batch_t *batch, const telemetry_sample_t *sample)
+{
+    if (batch->count == TELEMETRY_BATCH_MAX) {
+        batch->head = (batch->head + 1) % TELEMETRY_BATCH_MAX;
+        batch->count--;
+        batch->dropped++;
+        if (batch->sent > 0) {
+            batch->sent--;
+            batch->sent_evicted++;
+        }
+    }
+    batch->samples[(batch->head + batch->count) % TELEMETRY_BATCH_MAX] = *sample;
+    batch->count++;
+}
+
+void telemetry_batch_consume(telemetry_batch_t *batch, uint32_t count)
+{
+    if (count > batch->count) count = batch->count;
+    batch->head = (batch->head + count) % TELEMETRY_BATCH_MAX;
+    batch->count -= count;
+}
+
+void telemetry_batch_mark_sent(telemetry_batch_t *batch, uint32_t count)
+{
+    batch->sent += count;
+    if (batch->sent > batch->count) batch->sent = batch->count;
+}
+
+void telemetry_batch_ack(telemetry_batch_t *batch, uint32_t count)
+{
+    uint32_t evicted = count < batch->sent_evicted ? count : batch->sent_evicted;
+    batch->sent_evicted -= evicted;
+    count -= evicted;
+    if (count > batch->sent) count = batch->sent;
+    batch->sent -= count;
+    telemetry_batch_consume(batch, count);
+}
+
+void telemetry_batch_resend(telemetry_batch_t *batch)
+{
+    batch->sent = 0;
+    batch->sent_evicted = 0;
+}
+
+// snprintf с проверкой переполнения: смещение после записи или -1
+static int append(size_t len, int pos, int n)
+{
+    if (pos < 0 || n < 0 || (size_t)(pos + n) >= len) return -1;
+    return pos + n;
+}
+
+// Строка JSON в кавычках с экранированием: смещение после записи или -1
+static int append_str(char *buf, size_t len, int pos, const char *text)
+{
+    if (pos < 0) return -1;
+    return append(len, pos, jsonstr_quote(buf + pos, len - pos, text));
+}
+
+int telemetry_encode_post(const telemetry_device_t *device, const telemetry_sample_t *sample,
+                          char *buf, size_t len)
+{
+    int pos = append(len, 0, snprintf(buf, len, "{\"system\":{\"Akey\":"));
+    pos = append_str(buf, len, pos, device->akey);
+    if (pos >= 0) pos = append(len, pos, snprintf(buf + pos, len - pos, ",\"Serial\":"));
+    pos = append_str(buf, len, pos, device->serial);
+    if (pos < 0) return -1;
+    int n = snprintf(buf + pos, len - pos,
+                     ",\"Version\":\"%s\",\"RSSI\":%d,\"MAC\":\"%s\",\"IP\":\"%s\"},"
+                     "\"BME280\":{\"temp\":%.2f,\"humidity\":%.2f,\"pressure\":%.2f},"
+                     "\"derived\":{\"dew_point\":%.2f,\"abs_humidity\":%.2f,\"heat_index\":%.2f,"
+                     "\"sea_level_pressure\":%.2f}}",
+                     TELEMETRY_VERSION, device->rssi, device->mac, device->ip,
+                     sample->temperature, sample->humidity, sample->pressure,
+                     sample->derived.dew_point / 100.0f, sample->derived.abs_humidity / 1000.0f,
+                     sample->derived.heat_index / 100.0f,
+                     sample->derived.sea_level_pressure / 100.0f);
+    return append(len, pos, n);
+}
+
+int telemetry_encode_batch(const telemetry_device_t *device, const telemetry_batch_t *batch,
+                           uint32_t max_samples, char *buf, size_t len, uint32_t *encoded)
+{
+    int pos = append(len, 0, snprintf(buf, len, "{\"serial\":"));
+    pos = append_str(buf, len, pos, device->serial);
+    if (pos >= 0) pos = append(len, pos, snprintf(buf + pos, len - pos, ",\"samples\":["));
+    uint32_t count = 0;
+
+    while (pos >= 0 && batch->sent + count < batch->count && count < max_samples) {
+        const telemetry_sample_t *s =
+            &batch->samples[(batch->head + batch->sent + count) % TELEMETRY_BATCH_MAX];
+        int next = append(len, pos,
+                          snprintf(buf + pos, len - pos,
+                                   "%s[%u,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f]",
+                                   count ? "," : "", s->uptime_s,
+                                   s->temperature, s->humidity, s->pressure,
+                                   s->derived.dew_point / 100.0f,
+                                   s->derived.abs_humidity / 1000.0f,
+                                   s->derived.heat_index / 100.0f,
+                                   s->derived.sea_level_pressure / 100.0f));
+        // Место для закрывающих скобок
+        if (next < 0 || (size_t)next + 2 >= len) break;
+        pos = next;
+        count++;
+    }
+
+    *encoded = count;
+    if (pos < 0 || count == 0) return -1;
+    buf[pos++] = ']';
+    buf[pos++] = '}';
+    buf[pos] = '\0';
+    return pos;
+}
+
+int telemetry_encode_status(const telemetry_device_t *device, uint32_t uptime_s,
+                            char *buf, size_t len)
+{
+    int n = snprintf(buf, len,
+                     "{\"state\":\"online\",\"version\":\"%s\",\"rssi\":%d,\"mac\":\"%s\","
+                     "\"ip\":\"%s\",\"uptime_s\":%u,\"sensor\":\"%s\"}",
+                     TELEMETRY_VERSION, device->rssi, device->mac, device->ip, uptime_s,
+                     device->sensor_health);
+    return append(len, 0, n);
+}
+
+const char *const telemetry_channels[TELEMETRY_CHANNELS] = {
+    "temperature", "humidity", "pressure",
+};
+
+int telemetry_encode_stats(const summary_result_t *result, char *buf, size_t len)
+{
+    if (result->count == 0) {
+        return append(len, 0, snprintf(buf, len, "{\"n\":0}"));
+    }
+    int n = snprintf(buf, len,
+                     "{\"n\":%u,\"mean\":%.2f,\"sd\":%.2f,\"min\":%.2f,\"max\":%.2f,"
+                     "\"p5\":%.2f,\"p50\":%.2f,\"p95\":%.2f}",
+                     result->count, result->mean, result->stddev, result->min, result->max,
+                     result->quantile[SUMMARY_P5], result->quantile[SUMMARY_P50],
+                     result->quantile[SUMMARY_P95]);
+    return append(len, 0, n);
+}
+
+int telemetry_encode_summary(const telemetry_device_t *device, uint32_t period_s, uint32_t start_s,
+                             const summary_result_t *results, char *buf, size_t len)
+{
+    int pos = append(len, 0, snprintf(buf, len, "{\"serial\":"));
+    pos = append_str(buf, len, pos, device->serial);
+    if (pos >= 0) {
+        pos = append(len, pos, snprintf(buf + pos, len - pos, ",\"period_s\":%u,\"start_s\":%u",
+                                        period_s, start_s));
+    }
+
+    for (int i = 0; i < TELEMETRY_CHANNELS && pos >= 0; i++) {
+        pos = append(len, pos, snprintf(buf + pos, len - pos, ",\"%s\":", telemetry_channels[i]));
+        if (pos < 0) break;
+        pos = append(len, pos, telemetry_encode_stats(&results[i], buf + pos, len - pos));
+    }
+    if (pos < 0) return -1;
+    return append(len, pos, snprintf(buf + pos, len - pos, "}"));
+}
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, v & 0xFFFF);
+    put_u16(p + 2, v >> 16);
+}
+
+// Округление с ограничением диапазона поля
+static int32_t scale(float value, float factor, int32_t min, int32_t max)
+{
+    float scaled = value * factor;
+    scaled += (scaled < 0) ? -0.5f : 0.5f;
+    if (scaled < (float)min) return min;
+    if (scaled > (float)max) return max;
+    return (int32_t)scaled;
+}
+
+int telemetry_encode_frame(const uint8_t mac[6], int rssi, uint32_t seq, uint16_t interval_s,
+                           const telemetry_sample_t *sample, uint8_t *buf)
+{
+    memset(buf, 0, TELEMETRY_FRAME_SIZE);
+    memcpy(buf, TELEMETRY_FRAME_MAGIC, 2);
+    buf[2] = TELEMETRY_FRAME_VERSION;
+    buf[3] = sample->health & 0x03;
+    put_u32(buf + 4, seq);
+    put_u32(buf + 8, sample->uptime_s);
+    memcpy(buf + 12, mac, 6);
+    put_u16(buf + 18, (uint16_t)scale(sample->temperature, 100.0f, -32768, 32767));
+    put_u16(buf + 20, (uint16_t)scale(sample->humidity, 100.0f, 0, 65535));
+    put_u32(buf + 22, (uint32_t)scale(sample->pressure, 100.0f, 0, 0x7FFFFFFF));
+    buf[26] = (uint8_t)(int8_t)rssi;
+    put_u16(buf + 28, interval_s);
+    return TELEMETRY_FRAME_SIZE;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "metrics.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Отправка телеметрии HTTPS POST поверх mbedTLS без esp_http_client:
+ * соединение держится открытым между отправками (HTTP/1.1 keep-alive), а
+ * если сервер его закрыл, новое подключение возобновляет сохраненную сессию
+ * TLS (session ticket или session ID) - без обмена ключами, который на
+ * ESP8266 стоит секунд CPU и десятков КБ кучи.
+ *
+ * Сертификат сервера проверяется по CA из файла (PEM). Без часов реального
+ * времени срок действия сертификата не проверяется, пока время не
+ * установлено. Имя сервера сверяется с сертификатом, если адрес задан
+ * именем, а не IP (для IP достаточно собственного CA сервера).
+ */
+
+#define TLS_UPLINK_TIMEOUT_MS       10000
+#define TLS_UPLINK_HOST_LEN         64
+#define TLS_UPLINK_PATH_LEN         96
+
+typedef struct {
+    bool connected;
+    uint32_t requests;
+    uint32_t reused;            // Запросов по уже открытому соединению
+    uint32_t connects;          // Подключений (рукопожатий TLS)
+    uint32_t offered;           // Подключений с сохраненной сессией
+    uint32_t resumed;           // Из них сервер принял сессию
+    uint32_t failures;          // Ошибок подключения и обмена
+    uint32_t heap_last;         // Расход кучи при последнем подключении (байт)
+    uint32_t heap_peak;         // Наибольший расход кучи при подключении (байт)
+    latency_hist_t full_ms;     // Полное рукопожатие (мс)
+    latency_hist_t resumed_ms;  // Возобновление сессии (мс)
+} tls_uplink_stats_t;
+
+/**
+ * @brief Настройка адреса сервера и загрузка CA
+ * @param url Адрес https://host[:port]/path
+ * @param ca_path Файл с сертификатом CA сервера (PEM)
+ * @return ESP_OK при успехе, ESP_ERR_INVALID_ARG при неверном адресе,
+ *         ESP_ERR_NOT_FOUND если нет файла CA
+ */
+esp_err_t tls_uplink_init(const char *url, const char *ca_path);
+
+/**
+ * @brief POST application/json; при необходимости подключается. Если сервер
+ *        закрыл открытое соединение до отправки запроса или до первого байта
+ *        ответа, запрос один раз повторяется по новому. Оборванный ответ и
+ *        таймаут ответа не повторяются: сервер мог принять запрос
+ * @param body Тело запроса
+ * @param len Длина тела
+ * @param status Код ответа HTTP
+ * @return ESP_OK если получен ответ (код в status), ESP_ERR_TIMEOUT если ответ
+ *         не пришел за TLS_UPLINK_TIMEOUT_MS
+ */
+esp_err_t tls_uplink_post(const char *body, int len, int *status);
+
+/**
+ * @brief Закрытие соединения (сохраненная сессия остается)
+ */
+void tls_uplink_close(void);
+
+/**
+ * @brief Получение статистики
+ * @param stats Указатель для сохранения статистики
+ */
+void tls_uplink_get_stats(tls_uplink_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
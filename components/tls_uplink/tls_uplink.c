@@ -0,0 +1,485 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/x509_crt.h"
+#include "dlog.h"
+#include "tls_uplink.h"
+
+static const char *TAG = "TLS_UPLINK";
+
+#define CA_MAX_LEN      4096
+#define TX_BUF_LEN      1024        // Заголовки и тело запроса - одна запись TLS
+#define RX_BUF_LEN      512
+#define HEADER_LINE_LEN 128
+
+// Раньше этой даты часы не установлены (SNTP не отработал)
+#define TIME_VALID_AFTER 1577836800 // 2020-01-01
+
+static char s_host[TLS_UPLINK_HOST_LEN];
+static char s_port[6];
+static char s_path[TLS_UPLINK_PATH_LEN];
+static bool s_verify_name;
+static bool s_ready = false;
+
+static mbedtls_entropy_context s_entropy;
+static mbedtls_ctr_drbg_context s_drbg;
+static mbedtls_x509_crt s_ca;
+static mbedtls_ssl_config s_conf;
+static mbedtls_ssl_context s_ssl;
+static mbedtls_net_context s_net;
+static mbedtls_ssl_session s_session;
+static bool s_session_valid = false;
+
+static char s_tx[TX_BUF_LEN];
+
+// Буферы записей урезаны в sdkconfig.defaults. Параметр, которого нет в Kconfig
+// SDK, при сборке молча пропускается, и mbedTLS остается с буферами по 16 КБ
+#if !defined(MBEDTLS_SSL_IN_CONTENT_LEN) || !defined(MBEDTLS_SSL_OUT_CONTENT_LEN) || \
+    (MBEDTLS_SSL_IN_CONTENT_LEN >= 16384 && MBEDTLS_SSL_OUT_CONTENT_LEN >= 16384)
+#error "mbedTLS record buffers are not reduced: check CONFIG_MBEDTLS_*_CONTENT_LEN"
+#endif
+
+// Запрос не дошел до сервера: соединение закрылось до отправки или сервер закрыл
+// его (EOF, close_notify, RST) до первого байта ответа. Только такой обмен
+// безопасно повторить по новому соединению
+#define ERR_NOT_DELIVERED   ESP_ERR_INVALID_STATE
+
+// Буферизованное чтение ответа поверх записей TLS
+static struct {
+    unsigned char data[RX_BUF_LEN];
+    int pos;
+    int len;
+    uint32_t received;          // Байт, отданных разбору ответа
+    int error;                  // Код mbedtls_ssl_read последнего сбоя (0 - EOF)
+} s_rx;
+
+static tls_uplink_stats_t s_stats = {0};
+
+static uint32_t now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static esp_err_t parse_url(const char *url)
+{
+    if (strncmp(url, "https://", 8) != 0) return ESP_ERR_INVALID_ARG;
+    const char *host = url + 8;
+    const char *slash = strchr(host, '/');
+    const char *path = slash ? slash : "/";
+    size_t host_len = slash ? (size_t)(slash - host) : strlen(host);
+    const char *colon = memchr(host, ':', host_len);
+    size_t name_len = colon ? (size_t)(colon - host) : host_len;
+
+    if (name_len == 0 || name_len >= sizeof(s_host) || strlen(path) >= sizeof(s_path)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(s_host, host, name_len);
+    s_host[name_len] = '\0';
+    if (colon) {
+        size_t port_len = host_len - name_len - 1;
+        if (port_len == 0 || port_len >= sizeof(s_port)) return ESP_ERR_INVALID_ARG;
+        memcpy(s_port, colon + 1, port_len);
+        s_port[port_len] = '\0';
+    } else {
+        strcpy(s_port, "443");
+    }
+    strcpy(s_path, path);
+
+    // Сертификат, выданный на IP, встречается редко: для адреса сверяется только CA
+    struct in_addr addr;
+    s_verify_name = inet_aton(s_host, &addr) == 0;
+    return ESP_OK;
+}
+
+static esp_err_t load_ca(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL) return ESP_ERR_NOT_FOUND;
+
+    // PEM разбирается только с завершающим нулем; буфер нужен лишь на время разбора
+    unsigned char *pem = malloc(CA_MAX_LEN + 1);
+    if (pem == NULL) {
+        fclose(f);
+        return ESP_ERR_NO_MEM;
+    }
+    size_t len = fread(pem, 1, CA_MAX_LEN, f);
+    fclose(f);
+    pem[len] = '\0';
+
+    int ret = mbedtls_x509_crt_parse(&s_ca, pem, len + 1);
+    free(pem);
+    if (ret < 0) {
+        ESP_LOGE(TAG, "CA %s: parse error -0x%04x", path, -ret);
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+// Запрос уменьшенного фрагмента (RFC 6066), если входной буфер меньше 16 КБ
+static void conf_fragment_len(void)
+{
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH) && defined(MBEDTLS_SSL_IN_CONTENT_LEN)
+#if MBEDTLS_SSL_IN_CONTENT_LEN >= 16384
+    return;
+#elif MBEDTLS_SSL_IN_CONTENT_LEN >= 4096
+    mbedtls_ssl_conf_max_frag_len(&s_conf, MBEDTLS_SSL_MAX_FRAG_LEN_4096);
+#elif MBEDTLS_SSL_IN_CONTENT_LEN >= 2048
+    mbedtls_ssl_conf_max_frag_len(&s_conf, MBEDTLS_SSL_MAX_FRAG_LEN_2048);
+#else
+    mbedtls_ssl_conf_max_frag_len(&s_conf, MBEDTLS_SSL_MAX_FRAG_LEN_1024);
+#endif
+#endif
+}
+
+esp_err_t tls_uplink_init(const char *url, const char *ca_path)
+{
+    if (s_ready) return ESP_ERR_INVALID_STATE;
+
+    esp_err_t err = parse_url(url);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Bad URL %s", url);
+        return err;
+    }
+
+    mbedtls_entropy_init(&s_entropy);
+    mbedtls_ctr_drbg_init(&s_drbg);
+    mbedtls_x509_crt_init(&s_ca);
+    mbedtls_ssl_config_init(&s_conf);
+    mbedtls_ssl_init(&s_ssl);
+    mbedtls_net_init(&s_net);
+    mbedtls_ssl_session_init(&s_session);
+
+    // Без CA соединение не устанавливается: отправить Akey неизвестному серверу хуже, чем не отправить
+    err = load_ca(ca_path);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "No CA certificate (%s): %s", ca_path, esp_err_to_name(err));
+        return err;
+    }
+
+    int ret = mbedtls_ctr_drbg_seed(&s_drbg, mbedtls_entropy_func, &s_entropy,
+                                    (const unsigned char *)TAG, strlen(TAG));
+    if (ret == 0) {
+        ret = mbedtls_ssl_config_defaults(&s_conf, MBEDTLS_SSL_IS_CLIENT,
+                                          MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+    }
+    if (ret != 0) {
+        ESP_LOGE(TAG, "mbedTLS setup failed: -0x%04x", -ret);
+        return ESP_FAIL;
+    }
+
+    // Результат проверки разбирается после рукопожатия (см. check_peer)
+    mbedtls_ssl_conf_authmode(&s_conf, MBEDTLS_SSL_VERIFY_OPTIONAL);
+    mbedtls_ssl_conf_ca_chain(&s_conf, &s_ca, NULL);
+    mbedtls_ssl_conf_rng(&s_conf, mbedtls_ctr_drbg_random, &s_drbg);
+    mbedtls_ssl_conf_read_timeout(&s_conf, TLS_UPLINK_TIMEOUT_MS);
+#ifdef MBEDTLS_SSL_SESSION_TICKETS
+    mbedtls_ssl_conf_session_tickets(&s_conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+    conf_fragment_len();
+
+    // Буферы записей выделяются здесь один раз и живут вместе с модулем
+    ret = mbedtls_ssl_setup(&s_ssl, &s_conf);
+    if (ret == 0 && s_verify_name) {
+        ret = mbedtls_ssl_set_hostname(&s_ssl, s_host);
+    }
+    if (ret != 0) {
+        ESP_LOGE(TAG, "SSL setup failed: -0x%04x", -ret);
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_ready = true;
+    ESP_LOGI(TAG, "Server %s:%s%s, free heap %u", s_host, s_port, s_path, esp_get_free_heap_size());
+    return ESP_OK;
+}
+
+void tls_uplink_close(void)
+{
+    if (!s_stats.connected) return;
+    mbedtls_ssl_close_notify(&s_ssl);
+    mbedtls_net_free(&s_net);
+    s_stats.connected = false;
+}
+
+static void drop(void)
+{
+    // Без close_notify: соединение уже неисправно
+    mbedtls_net_free(&s_net);
+    s_stats.connected = false;
+}
+
+static bool check_peer(void)
+{
+    uint32_t flags = mbedtls_ssl_get_verify_result(&s_ssl);
+    if (time(NULL) < TIME_VALID_AFTER) {
+        flags &= ~(MBEDTLS_X509_BADCERT_EXPIRED | MBEDTLS_X509_BADCERT_FUTURE);
+    }
+    if (!s_verify_name) {
+        flags &= ~MBEDTLS_X509_BADCERT_CN_MISMATCH;
+    }
+    if (flags != 0) {
+        char info[96];
+        mbedtls_x509_crt_verify_info(info, sizeof(info), "", flags);
+        info[strcspn(info, "\n")] = '\0';
+        ESP_LOGE(TAG, "Server certificate rejected: %s", info);
+        DLOGE(TAG, "Server certificate rejected: flags 0x%x", flags);
+        return false;
+    }
+    return true;
+}
+
+static esp_err_t open_connection(void)
+{
+    uint32_t started = now_ms();
+    uint32_t heap_before = esp_get_free_heap_size();
+    uint32_t heap_min = heap_before;
+
+    int ret = mbedtls_net_connect(&s_net, s_host, s_port, MBEDTLS_NET_PROTO_TCP);
+    if (ret != 0) {
+        DLOGE(TAG, "Connect %s:%s failed: -0x%04x", s_host, s_port, -ret);
+        return ESP_ERR_TIMEOUT;
+    }
+    struct timeval tv = {
+        .tv_sec = TLS_UPLINK_TIMEOUT_MS / 1000,
+        .tv_usec = (TLS_UPLINK_TIMEOUT_MS % 1000) * 1000,
+    };
+    setsockopt(s_net.fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    mbedtls_ssl_session_reset(&s_ssl);
+    mbedtls_ssl_set_bio(&s_ssl, &s_net, mbedtls_net_send, NULL, mbedtls_net_recv_timeout);
+    bool offered = s_session_valid && mbedtls_ssl_set_session(&s_ssl, &s_session) == 0;
+
+    // По шагам, чтобы отследить пик расхода кучи. При возобновлении сервер сразу
+    // после ServerHello переходит к ChangeCipherSpec, минуя сертификат и обмен ключами
+    bool full = false;
+    while (s_ssl.state != MBEDTLS_SSL_HANDSHAKE_OVER) {
+        if (s_ssl.state == MBEDTLS_SSL_SERVER_CERTIFICATE) full = true;
+        ret = mbedtls_ssl_handshake_step(&s_ssl);
+        uint32_t heap = esp_get_free_heap_size();
+        if (heap < heap_min) heap_min = heap;
+        if (ret != 0 && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) break;
+        ret = 0;
+    }
+
+    s_stats.connects++;
+    s_stats.heap_last = heap_before - heap_min;
+    if (s_stats.heap_last > s_stats.heap_peak) s_stats.heap_peak = s_stats.heap_last;
+    if (offered) s_stats.offered++;
+
+    if (ret != 0) {
+        DLOGE(TAG, "Handshake failed: -0x%04x", -ret);
+        drop();
+        // Сессию, которую сервер не принимает, больше не предлагать
+        s_session_valid = false;
+        return ESP_FAIL;
+    }
+    if (!check_peer()) {
+        drop();
+        s_session_valid = false;
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    uint32_t elapsed = now_ms() - started;
+    if (full) {
+        latency_record(&s_stats.full_ms, elapsed);
+    } else {
+        s_stats.resumed++;
+        latency_record(&s_stats.resumed_ms, elapsed);
+    }
+    s_stats.connected = true;
+    s_rx.pos = s_rx.len = 0;
+
+    // Сохраняется и возобновленная сессия: сервер мог выдать новый билет
+    mbedtls_ssl_session_free(&s_session);
+    mbedtls_ssl_session_init(&s_session);
+    s_session_valid = mbedtls_ssl_get_session(&s_ssl, &s_session) == 0;
+
+    ESP_LOGI(TAG, "Cipher suite %s", mbedtls_ssl_get_ciphersuite(&s_ssl));
+    DLOGI(TAG, "%s handshake %u ms, heap -%u", full ? "Full" : "Resumed", elapsed, s_stats.heap_last);
+    return ESP_OK;
+}
+
+// Сервер закрыл простаивающее соединение: в сокете EOF или close_notify
+static bool stale(void)
+{
+    return mbedtls_ssl_get_bytes_avail(&s_ssl) > 0 ||
+           mbedtls_net_poll(&s_net, MBEDTLS_NET_POLL_READ, 0) > 0;
+}
+
+static int write_all(const unsigned char *data, size_t len)
+{
+    while (len > 0) {
+        int ret = mbedtls_ssl_write(&s_ssl, data, len);
+        if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) continue;
+        if (ret <= 0) return ret ? ret : -1;
+        data += ret;
+        len -= ret;
+    }
+    return 0;
+}
+
+static int rx_byte(void)
+{
+    if (s_rx.pos == s_rx.len) {
+        int ret;
+        do {
+            ret = mbedtls_ssl_read(&s_ssl, s_rx.data, sizeof(s_rx.data));
+        } while (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+        if (ret <= 0) {
+            s_rx.error = ret;
+            return -1;
+        }
+        s_rx.pos = 0;
+        s_rx.len = ret;
+    }
+    s_rx.received++;
+    return s_rx.data[s_rx.pos++];
+}
+
+// Строка без CRLF; длинные строки обрезаются. Возвращает длину или -1
+static int rx_line(char *line, int size)
+{
+    int n = 0;
+    for (;;) {
+        int c = rx_byte();
+        if (c < 0) return -1;
+        if (c == '\n') break;
+        if (c != '\r' && n < size - 1) line[n++] = (char)c;
+    }
+    line[n] = '\0';
+    return n;
+}
+
+static int rx_skip(uint32_t len)
+{
+    while (len-- > 0) {
+        if (rx_byte() < 0) return -1;
+    }
+    return 0;
+}
+
+// Ответ читается целиком, чтобы следующий запрос пошел по тому же соединению
+static esp_err_t read_response(int *status, bool *keep_alive)
+{
+    char line[HEADER_LINE_LEN];
+    uint32_t content_len = 0;
+    bool chunked = false;
+
+    if (rx_line(line, sizeof(line)) < 0) return ESP_FAIL;
+    int minor = 0;
+    if (sscanf(line, "HTTP/1.%d %d", &minor, status) != 2) return ESP_ERR_INVALID_RESPONSE;
+    *keep_alive = minor >= 1;
+
+    int n;
+    while ((n = rx_line(line, sizeof(line))) > 0) {
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            content_len = strtoul(line + 15, NULL, 10);
+        } else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0) {
+            chunked = strstr(line + 18, "chunked") != NULL;
+        } else if (strncasecmp(line, "Connection:", 11) == 0) {
+            *keep_alive = strstr(line + 11, "close") == NULL && strstr(line + 11, "Close") == NULL;
+        }
+    }
+    if (n < 0) return ESP_FAIL;
+
+    if (!chunked) {
+        return rx_skip(content_len) == 0 ? ESP_OK : ESP_FAIL;
+    }
+    for (;;) {
+        if (rx_line(line, sizeof(line)) < 0) return ESP_FAIL;
+        uint32_t size = strtoul(line, NULL, 16);
+        if (size == 0) break;
+        if (rx_skip(size + 2) != 0) return ESP_FAIL;
+    }
+    // Трейлеры до пустой строки
+    while ((n = rx_line(line, sizeof(line))) > 0) {
+    }
+    return n == 0 ? ESP_OK : ESP_FAIL;
+}
+
+// Соединение закрыто сервером, а не оборвано ожиданием
+static bool peer_closed(int error)
+{
+    return error == 0 || error == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY ||
+           error == MBEDTLS_ERR_NET_CONN_RESET;
+}
+
+// ERR_NOT_DELIVERED, если запрос можно повторить; другая ошибка - сервер мог его
+// обработать (ответ оборван или не пришел за TLS_UPLINK_TIMEOUT_MS), и повтор
+// записал бы данные дважды
+static esp_err_t exchange(int len, int *status)
+{
+    bool keep_alive = false;
+
+    // Неполный запрос сервер не обработает: Content-Length не набран
+    int ret = write_all((const unsigned char *)s_tx, len);
+    if (ret != 0) {
+        DLOGW(TAG, "Write failed: -0x%04x", -ret);
+        return ERR_NOT_DELIVERED;
+    }
+    uint32_t received = s_rx.received;
+    s_rx.error = 0;
+    esp_err_t err = read_response(status, &keep_alive);
+    if (err != ESP_OK) {
+        uint32_t got = s_rx.received - received;
+        // Ни байта ответа и соединение закрыто: сервер закрыл простаивающее
+        // соединение раньше, чем запрос до него дошел
+        if (got == 0 && peer_closed(s_rx.error)) return ERR_NOT_DELIVERED;
+        DLOGW(TAG, "Response failed after %u bytes: -0x%04x", got, -s_rx.error);
+        return s_rx.error == MBEDTLS_ERR_SSL_TIMEOUT ? ESP_ERR_TIMEOUT : err;
+    }
+    if (!keep_alive) tls_uplink_close();
+    return ESP_OK;
+}
+
+esp_err_t tls_uplink_post(const char *body, int len, int *status)
+{
+    if (!s_ready) return ESP_ERR_INVALID_STATE;
+
+    int header = snprintf(s_tx, sizeof(s_tx),
+                          "POST %s HTTP/1.1\r\nHost: %s\r\nContent-Type: application/json\r\n"
+                          "Content-Length: %d\r\n\r\n", s_path, s_host, len);
+    if (header < 0 || header + len > (int)sizeof(s_tx)) return ESP_ERR_INVALID_SIZE;
+    memcpy(s_tx + header, body, len);
+
+    s_stats.requests++;
+    if (s_stats.connected && stale()) {
+        drop();
+    }
+
+    // По открытому соединению - одна повторная попытка по новому, если сервер
+    // закрыл его между проверкой и запросом и запрос до него не дошел
+    bool reused = s_stats.connected;
+    esp_err_t err = ESP_FAIL;
+    for (int attempt = 0; attempt < (reused ? 2 : 1); attempt++) {
+        if (!s_stats.connected) {
+            esp_err_t err = open_connection();
+            if (err != ESP_OK) {
+                s_stats.failures++;
+                return err;
+            }
+        } else {
+            s_stats.reused++;
+        }
+        err = exchange(header + len, status);
+        if (err == ESP_OK) return ESP_OK;
+        drop();
+        if (err != ERR_NOT_DELIVERED) break;
+    }
+    s_stats.failures++;
+    return err == ESP_ERR_TIMEOUT ? ESP_ERR_TIMEOUT : ESP_FAIL;
+}
+
+void tls_uplink_get_stats(tls_uplink_stats_t *stats)
+{
+    *stats = s_stats;
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Трассировка исполнения: переключения задач FreeRTOS (хук
+ * traceTASK_SWITCHED_IN из trace_hooks.h) и метки начала/конца участков
+ * кода пишутся в кольцевой буфер с отметкой счетчика тактов CCOUNT.
+ * Заодно по переключениям копится время CPU каждой задачи.
+ * Буфер выгружается через /trace и переводится в формат Chrome trace
+ * (открывается в chrome://tracing и Perfetto) tools/trace_export.py.
+ *
+ * Формат выгрузки (little endian):
+ *   trace_dump_header_t
+ *   tasks x trace_task_t       индекс в таблице - номер задачи в событиях
+ *   count x trace_event_t      от старых к новым
+ */
+
+#ifndef TRACE_EVENTS
+#define TRACE_EVENTS        512
+#endif
+#define TRACE_TASKS         16          // Последняя запись - "(other)" для остальных задач
+#define TRACE_NAME_LEN      16
+#define TRACE_MAGIC         0x31435254  // "TRC1"
+
+#ifdef CONFIG_ESP8266_DEFAULT_CPU_FREQ_160
+#define TRACE_CPU_HZ        160000000
+#else
+#define TRACE_CPU_HZ        80000000
+#endif
+
+// Типы событий
+#define TRACE_EV_SWITCH     0           // task - задача, получившая CPU
+#define TRACE_EV_BEGIN      1           // task - текущая задача, marker/detail в arg
+#define TRACE_EV_END        2
+
+// Участки кода (младший байт arg), старший байт - уточнение
+#define TRACE_I2C           0           // Транзакция I2C, уточнение - адрес устройства
+#define TRACE_HTTPD         1           // Обработчик веб-сервера, уточнение - номер маршрута
+#define TRACE_UPLINK        2           // Отправка телеметрии, уточнение - TRACE_UPLINK_x
+
+#define TRACE_UPLINK_HTTP   0
+#define TRACE_UPLINK_MQTT   1
+#define TRACE_UPLINK_BEACON 2
+
+typedef struct {
+    uint32_t cycles;
+    uint8_t type;
+    uint8_t task;
+    uint16_t arg;
+} trace_event_t;
+
+typedef struct {
+    char name[TRACE_NAME_LEN];
+    uint64_t cycles;            // Время CPU с момента очистки (такты)
+    uint32_t switches;
+    uint32_t reserved;
+} trace_task_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t cpu_hz;
+    uint32_t total;             // Событий с момента очистки
+    uint32_t count;
+    uint8_t tasks;
+    uint8_t event_size;
+    uint8_t task_size;
+    uint8_t reserved;
+} trace_dump_header_t;
+
+// Счетчик тактов CPU (переполняется каждые 2^32 такта, 53 с при 80 МГц)
+static inline uint32_t trace_cycles(void)
+{
+    uint32_t ccount;
+    __asm__ __volatile__("rsr %0, ccount" : "=a"(ccount));
+    return ccount;
+}
+
+/**
+ * @brief Хук переключения задачи (вызывается планировщиком, см. trace_hooks.h)
+ * @param tcb Описатель задачи
+ * @param name Имя задачи
+ */
+void trace_task_switched_in(void *tcb, const char *name);
+
+/**
+ * @brief Начало участка кода
+ * @param marker Участок (TRACE_I2C, ...)
+ * @param detail Уточнение
+ */
+void trace_begin(uint8_t marker, uint8_t detail);
+
+/**
+ * @brief Конец участка кода
+ * @param marker Участок
+ * @param detail Уточнение (то же, что в trace_begin)
+ */
+void trace_end(uint8_t marker, uint8_t detail);
+
+/**
+ * @brief Приостановка записи (на время выгрузки буфера)
+ * @param enabled false - события не записываются
+ */
+void trace_set_enabled(bool enabled);
+
+/**
+ * @brief Заголовок выгрузки для текущего состояния буфера
+ * @param header Заголовок
+ */
+void trace_get_header(trace_dump_header_t *header);
+
+/**
+ * @brief Копия таблицы задач со временем CPU
+ * @param tasks Буфер на TRACE_TASKS записей
+ * @return Число задач
+ */
+int trace_get_tasks(trace_task_t *tasks);
+
+/**
+ * @brief Непрерывный участок буфера событий
+ * @param index Номер события от самого старого, 0..count-1 (см. trace_get_header)
+ * @param run Сколько событий подряд лежит по возвращенному адресу
+ * @return Указатель в буфер (действителен, пока запись приостановлена)
+ */
+const trace_event_t *trace_events(uint32_t index, uint32_t *run);
+
+/**
+ * @brief Очистка буфера и счетчиков времени CPU (имена задач сохраняются)
+ */
+void trace_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
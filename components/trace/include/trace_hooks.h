@@ -0,0 +1,14 @@
+#pragma once
+
+/*
+ * Хуки трассировки FreeRTOS. Подключается ко всем C файлам сборки ключом
+ * -include (см. CMakeLists.txt проекта), чтобы макрос был определен до
+ * FreeRTOS.h. Раскрывается только в tasks.c, где виден pxCurrentTCB.
+ */
+#ifndef __ASSEMBLER__
+
+void trace_task_switched_in(void *tcb, const char *name);
+
+#define traceTASK_SWITCHED_IN() trace_task_switched_in(pxCurrentTCB, pxCurrentTCB->pcTaskName)
+
+#endif
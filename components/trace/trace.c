@@ -0,0 +1,140 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "trace.h"
+
+typedef struct {
+    void *tcb;
+    char name[TRACE_NAME_LEN];
+} trace_task_id_t;
+
+static trace_event_t s_events[TRACE_EVENTS];
+static uint32_t s_total = 0;
+static volatile bool s_enabled = true;
+
+// Таблица задач: заполняется по мере первого переключения на задачу
+static trace_task_id_t s_task_ids[TRACE_TASKS];
+static uint64_t s_task_cycles[TRACE_TASKS];
+static uint32_t s_task_switches[TRACE_TASKS];
+static int s_task_count = 0;
+static uint8_t s_current = TRACE_TASKS - 1;
+static uint32_t s_switched_at = 0;
+
+static IRAM_ATTR void record(uint8_t type, uint8_t task, uint16_t arg, uint32_t cycles)
+{
+    trace_event_t *event = &s_events[s_total % TRACE_EVENTS];
+    event->cycles = cycles;
+    event->type = type;
+    event->task = task;
+    event->arg = arg;
+    s_total++;
+}
+
+static IRAM_ATTR uint8_t task_index(void *tcb, const char *name)
+{
+    for (int i = 0; i < s_task_count; i++) {
+        if (s_task_ids[i].tcb == tcb) return i;
+    }
+    if (s_task_count == TRACE_TASKS - 1) return TRACE_TASKS - 1;
+
+    trace_task_id_t *id = &s_task_ids[s_task_count];
+    id->tcb = tcb;
+    for (int i = 0; i < TRACE_NAME_LEN - 1 && name[i]; i++) {
+        id->name[i] = name[i];
+    }
+    return s_task_count++;
+}
+
+// Вызывается из vTaskSwitchContext с запрещенными прерываниями
+void IRAM_ATTR trace_task_switched_in(void *tcb, const char *name)
+{
+    uint32_t now = trace_cycles();
+    uint8_t task = task_index(tcb, name);
+    if (task == s_current) return;
+
+    s_task_cycles[s_current] += now - s_switched_at;
+    s_task_switches[task]++;
+    s_switched_at = now;
+    s_current = task;
+    if (s_enabled) {
+        record(TRACE_EV_SWITCH, task, 0, now);
+    }
+}
+
+static void mark(uint8_t type, uint8_t marker, uint8_t detail)
+{
+    if (!s_enabled) return;
+    taskENTER_CRITICAL();
+    record(type, s_current, marker | (uint16_t)detail << 8, trace_cycles());
+    taskEXIT_CRITICAL();
+}
+
+void trace_begin(uint8_t marker, uint8_t detail)
+{
+    mark(TRACE_EV_BEGIN, marker, detail);
+}
+
+void trace_end(uint8_t marker, uint8_t detail)
+{
+    mark(TRACE_EV_END, marker, detail);
+}
+
+void trace_set_enabled(bool enabled)
+{
+    s_enabled = enabled;
+}
+
+void trace_get_header(trace_dump_header_t *header)
+{
+    taskENTER_CRITICAL();
+    header->magic = TRACE_MAGIC;
+    header->cpu_hz = TRACE_CPU_HZ;
+    header->total = s_total;
+    header->count = s_total < TRACE_EVENTS ? s_total : TRACE_EVENTS;
+    header->tasks = s_task_count == TRACE_TASKS - 1 ? TRACE_TASKS : s_task_count;
+    header->event_size = sizeof(trace_event_t);
+    header->task_size = sizeof(trace_task_t);
+    header->reserved = 0;
+    taskEXIT_CRITICAL();
+}
+
+int trace_get_tasks(trace_task_t *tasks)
+{
+    int count;
+    memset(tasks, 0, TRACE_TASKS * sizeof(trace_task_t));
+
+    taskENTER_CRITICAL();
+    count = s_task_count == TRACE_TASKS - 1 ? TRACE_TASKS : s_task_count;
+    for (int i = 0; i < count; i++) {
+        memcpy(tasks[i].name, s_task_ids[i].name, TRACE_NAME_LEN);
+        tasks[i].cycles = s_task_cycles[i];
+        tasks[i].switches = s_task_switches[i];
+    }
+    // Текущая задача еще не отдала CPU: учесть ее время до этого момента
+    tasks[s_current].cycles += trace_cycles() - s_switched_at;
+    taskEXIT_CRITICAL();
+
+    if (count == TRACE_TASKS) strcpy(tasks[TRACE_TASKS - 1].name, "(other)");
+    return count;
+}
+
+const trace_event_t *trace_events(uint32_t index, uint32_t *run)
+{
+    uint32_t count = s_total < TRACE_EVENTS ? s_total : TRACE_EVENTS;
+    uint32_t pos = (s_total - count + index) % TRACE_EVENTS;
+
+    *run = (index < count) ? count - index : 0;
+    if (pos + *run > TRACE_EVENTS) *run = TRACE_EVENTS - pos;
+    return &s_events[pos];
+}
+
+void trace_clear(void)
+{
+    taskENTER_CRITICAL();
+    s_total = 0;
+    memset(s_task_cycles, 0, sizeof(s_task_cycles));
+    memset(s_task_switches, 0, sizeof(s_task_switches));
+    s_switched_at = trace_cycles();
+    taskEXIT_CRITICAL();
+}
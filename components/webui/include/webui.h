@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Статическая панель управления из SPIFFS. Файлы заранее сжаты
+ * tools/mkwebfs.py и лежат как /spiffs/www/<имя>.gz; ресурсы с хешем
+ * содержимого в имени (app.1a2b3c4d.js) кэшируются браузером навсегда,
+ * index.html перепроверяется при каждом открытии. Файл отдается
+ * частями через буфер WEBUI_CHUNK_SIZE.
+ */
+
+#define WEBUI_ROOT          "/spiffs/www"
+#define WEBUI_INDEX         "/index.html"
+#define WEBUI_CHUNK_SIZE    1024
+
+typedef struct {
+    uint32_t requests;
+    uint32_t gzip;              // Отдано сжатыми
+    uint32_t not_found;
+    uint32_t bytes;             // Отправлено байт тела (после сжатия)
+} webui_stats_t;
+
+/**
+ * @brief Обработчик GET для путей, не занятых API (регистрируется последним, по шаблону)
+ * @param req Запрос
+ * @return ESP_OK при успехе
+ */
+esp_err_t webui_handler(httpd_req_t *req);
+
+/**
+ * @brief Счетчики запросов к панели
+ * @param stats Счетчики
+ */
+void webui_get_stats(webui_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include "esp_log.h"
+#include "webui.h"
+
+static const char *TAG = "WEBUI";
+
+static webui_stats_t s_stats;
+
+static const struct {
+    const char *ext;
+    const char *type;
+} content_types[] = {
+    { ".html", "text/html; charset=utf-8" },
+    { ".js",   "application/javascript" },
+    { ".css",  "text/css" },
+    { ".svg",  "image/svg+xml" },
+    { ".json", "application/json" },
+    { ".png",  "image/png" },
+    { ".ico",  "image/x-icon" },
+};
+
+static const char *content_type(const char *path, size_t len)
+{
+    for (size_t i = 0; i < sizeof(content_types) / sizeof(content_types[0]); i++) {
+        size_t ext = strlen(content_types[i].ext);
+        if (len >= ext && strncmp(path + len - ext, content_types[i].ext, ext) == 0) {
+            return content_types[i].type;
+        }
+    }
+    return "application/octet-stream";
+}
+
+// Имя вида name.<8 hex>.ext: содержимое по этому адресу никогда не меняется
+static bool is_hashed(const char *path, size_t len)
+{
+    size_t ext = len;
+    while (ext > 0 && path[ext - 1] != '.' && path[ext - 1] != '/') ext--;
+    if (ext < 10 || path[ext - 1] != '.' || path[ext - 10] != '.') return false;
+    for (size_t i = ext - 9; i < ext - 1; i++) {
+        if (!isxdigit((unsigned char)path[i])) return false;
+    }
+    return true;
+}
+
+static bool accepts_gzip(httpd_req_t *req)
+{
+    char value[64];
+    esp_err_t ret = httpd_req_get_hdr_value_str(req, "Accept-Encoding", value, sizeof(value));
+    // Длинный заголовок обрезается, но начало в буфере остается
+    return (ret == ESP_OK || ret == ESP_ERR_HTTPD_RESULT_TRUNC) && strstr(value, "gzip") != NULL;
+}
+
+esp_err_t webui_handler(httpd_req_t *req)
+{
+    static char chunk[WEBUI_CHUNK_SIZE];
+    char path[64];
+    const char *uri = req->uri;
+    size_t len = strcspn(uri, "?#");
+
+    s_stats.requests++;
+    if (len == 1) {
+        uri = WEBUI_INDEX;
+        len = strlen(WEBUI_INDEX);
+    }
+    int base = snprintf(path, sizeof(path), "%s%.*s", WEBUI_ROOT, (int)len, uri);
+    if ((size_t)base + 3 >= sizeof(path) || strstr(path, "..") != NULL) {
+        s_stats.not_found++;
+        return httpd_resp_send_404(req);
+    }
+
+    // Сначала сжатая копия, без нее - исходный файл
+    bool gzip = accepts_gzip(req);
+    FILE *f = NULL;
+    if (gzip) {
+        strcpy(path + base, ".gz");
+        f = fopen(path, "r");
+        path[base] = '\0';
+    }
+    if (f == NULL) {
+        gzip = false;
+        f = fopen(path, "r");
+    }
+    if (f == NULL) {
+        s_stats.not_found++;
+        return httpd_resp_send_404(req);
+    }
+
+    httpd_resp_set_type(req, content_type(uri, len));
+    if (gzip) {
+        httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+        httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+        s_stats.gzip++;
+    }
+    httpd_resp_set_hdr(req, "Cache-Control", is_hashed(uri, len)
+                       ? "public, max-age=31536000, immutable" : "no-cache");
+
+    esp_err_t ret = ESP_OK;
+    size_t n;
+    while (ret == ESP_OK && (n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        ret = httpd_resp_send_chunk(req, chunk, n);
+        s_stats.bytes += n;
+    }
+    fclose(f);
+
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Sending %s aborted: %s", path, esp_err_to_name(ret));
+        return ret;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+void webui_get_stats(webui_stats_t *stats)
+{
+    *stats = s_stats;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "wifi_sm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    wifi_sm_state_t state;
+    bool cache_valid;           // Есть BSSID/канал для быстрого подключения
+    uint8_t channel;            // Канал последней точки доступа
+    uint8_t last_reason;        // Причина последнего отключения (wifi_err_reason_t)
+    uint32_t attempt;           // Неудачных попыток в текущем обрыве
+    uint32_t down_ms;           // Длительность текущего обрыва (0 если подключено)
+    uint32_t boot_connect_ms;
+    uint32_t reconnects;
+    uint32_t fast_connects;
+    uint32_t failed_attempts;
+    uint32_t last_reconnect_ms;
+    uint32_t max_reconnect_ms;
+    uint32_t avg_reconnect_ms;
+} wifi_link_stats_t;
+
+/**
+ * @brief Подключение режима STA к автомату переподключения (см. wifi_sm.h)
+ *
+ * Вызывать после esp_wifi_set_config() для STA и до esp_wifi_start():
+ * модуль сам вызывает esp_wifi_connect() и повторяет попытки без ограничения
+ * числа. BSSID и канал последней точки доступа хранятся в NVS, поэтому
+ * после перезагрузки подключение идет без сканирования каналов.
+ * @return ESP_OK при успехе
+ */
+esp_err_t wifi_link_init(void);
+
+/**
+ * @brief Получение статистики подключения
+ * @param stats Указатель для сохранения статистики
+ */
+void wifi_link_get_stats(wifi_link_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
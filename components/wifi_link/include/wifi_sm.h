@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Автомат переподключения к точке доступа. Не зависит от SDK: на вход
+ * подаются события и текущее время, на выходе - действие и задержка до
+ * следующей попытки. Поэтому его можно прогнать на хосте, имитируя обрывы.
+ *
+ *   IDLE -> CONNECTING -> CONNECTED -> WAITING -> CONNECTING -> ...
+ *
+ * Первая попытка после обрыва идет сразу и по сохраненным BSSID/каналу
+ * (без сканирования). Если она не удалась, кэш считается устаревшим до
+ * следующего успешного подключения, а задержка растет экспоненциально
+ * от WIFI_SM_BACKOFF_MIN_MS до WIFI_SM_BACKOFF_MAX_MS со случайным
+ * разбросом в пределах половины интервала. Попытки не прекращаются никогда.
+ */
+
+#define WIFI_SM_BACKOFF_MIN_MS      500
+#define WIFI_SM_BACKOFF_MAX_MS      60000
+
+// Сколько ждать IP после esp_wifi_connect(), прежде чем прервать попытку
+#define WIFI_SM_ATTEMPT_TIMEOUT_MS  15000
+
+typedef enum {
+    WIFI_SM_IDLE = 0,
+    WIFI_SM_CONNECTING,
+    WIFI_SM_CONNECTED,
+    WIFI_SM_WAITING,
+} wifi_sm_state_t;
+
+typedef enum {
+    WIFI_SM_NONE = 0,
+    WIFI_SM_CONNECT_FAST,       // Подключение по сохраненным BSSID и каналу
+    WIFI_SM_CONNECT_SCAN,       // Подключение со сканированием каналов
+    WIFI_SM_ABORT,              // Попытка зависла: разорвать и считать неудачной
+} wifi_sm_action_t;
+
+typedef struct {
+    wifi_sm_state_t state;
+    bool cache_valid;           // Есть BSSID/канал последнего подключения
+    bool fast_attempt;          // Текущая попытка идет по кэшу
+    bool was_connected;         // Подключение уже было (следующее - переподключение)
+    uint32_t attempt;           // Неудачных попыток с начала текущего обрыва
+    uint32_t delay_ms;          // Задержка перед следующей попыткой
+    uint32_t down_since_ms;     // Начало текущего обрыва
+    uint32_t rng;
+
+    // Статистика
+    uint32_t boot_connect_ms;   // Время первого подключения после старта
+    uint32_t reconnects;
+    uint32_t fast_connects;     // Подключений без сканирования
+    uint32_t failed_attempts;
+    uint32_t last_reconnect_ms;
+    uint32_t max_reconnect_ms;
+    uint64_t total_reconnect_ms;
+} wifi_sm_t;
+
+/**
+ * @brief Инициализация автомата
+ * @param sm Автомат
+ * @param cache_valid Есть сохраненные BSSID и канал
+ * @param seed Начальное значение генератора разброса задержек (не 0)
+ */
+void wifi_sm_init(wifi_sm_t *sm, bool cache_valid, uint32_t seed);
+
+/**
+ * @brief Первая попытка подключения (событие STA_START)
+ * @param sm Автомат
+ * @param now_ms Текущее время (мс)
+ * @return Действие для драйвера Wi-Fi
+ */
+wifi_sm_action_t wifi_sm_start(wifi_sm_t *sm, uint32_t now_ms);
+
+/**
+ * @brief Получен IP адрес: подключение состоялось
+ * @param sm Автомат
+ * @param now_ms Текущее время (мс)
+ */
+void wifi_sm_connected(wifi_sm_t *sm, uint32_t now_ms);
+
+/**
+ * @brief Связь потеряна или попытка не удалась (событие STA_DISCONNECTED)
+ * @param sm Автомат
+ * @param now_ms Текущее время (мс)
+ * @param delay_ms Задержка до следующей попытки (мс)
+ * @return true, если нужно запустить таймер на delay_ms
+ */
+bool wifi_sm_disconnected(wifi_sm_t *sm, uint32_t now_ms, uint32_t *delay_ms);
+
+/**
+ * @brief Срабатывание таймера: задержка истекла или попытка длится слишком долго
+ * @param sm Автомат
+ * @param now_ms Текущее время (мс)
+ * @return Действие для драйвера Wi-Fi
+ */
+wifi_sm_action_t wifi_sm_timeout(wifi_sm_t *sm, uint32_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
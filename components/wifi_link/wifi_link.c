@@ -0,0 +1,205 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "esp_event.h"
+#include "tcpip_adapter.h"
+#include "nvs.h"
+#include "wifi_link.h"
+
+static const char *TAG = "WIFI_LINK";
+
+#define WIFI_NVS_NAMESPACE  "wifi"
+#define WIFI_NVS_KEY        "ap"
+
+// Точка доступа последнего успешного подключения
+typedef struct {
+    char ssid[33];
+    uint8_t bssid[6];
+    uint8_t channel;
+} wifi_cache_t;
+
+static wifi_sm_t s_sm;
+static wifi_cache_t s_cache;
+static uint8_t s_last_reason;
+static TimerHandle_t s_timer = NULL;
+static StaticTimer_t s_timer_buf;
+
+static uint32_t now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static void load_cache(const char *ssid)
+{
+    nvs_handle handle;
+    size_t len = sizeof(s_cache);
+
+    memset(&s_cache, 0, sizeof(s_cache));
+    if (nvs_open(WIFI_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) return;
+    if (nvs_get_blob(handle, WIFI_NVS_KEY, &s_cache, &len) != ESP_OK || len != sizeof(s_cache) ||
+        strncmp(s_cache.ssid, ssid, sizeof(s_cache.ssid)) != 0) {
+        // Другая сеть или старый формат записи
+        memset(&s_cache, 0, sizeof(s_cache));
+    }
+    nvs_close(handle);
+}
+
+// Сохранение только при смене точки доступа, чтобы не изнашивать flash
+static void save_cache(const char *ssid, const uint8_t *bssid, uint8_t channel)
+{
+    if (s_cache.channel == channel && memcmp(s_cache.bssid, bssid, 6) == 0 &&
+        strncmp(s_cache.ssid, ssid, sizeof(s_cache.ssid)) == 0) {
+        return;
+    }
+
+    memset(&s_cache, 0, sizeof(s_cache));
+    strncpy(s_cache.ssid, ssid, sizeof(s_cache.ssid) - 1);
+    memcpy(s_cache.bssid, bssid, 6);
+    s_cache.channel = channel;
+
+    nvs_handle handle;
+    if (nvs_open(WIFI_NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) return;
+    if (nvs_set_blob(handle, WIFI_NVS_KEY, &s_cache, sizeof(s_cache)) == ESP_OK) {
+        nvs_commit(handle);
+    }
+    nvs_close(handle);
+}
+
+// wait = 0 для вызова из задачи таймеров: она не может ждать собственную очередь
+static void arm_timer(uint32_t delay_ms, TickType_t wait)
+{
+    // Таймер FreeRTOS не принимает нулевой период
+    TickType_t ticks = pdMS_TO_TICKS(delay_ms);
+    if (xTimerChangePeriod(s_timer, ticks > 0 ? ticks : 1, wait) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to arm reconnect timer");
+    }
+}
+
+static void handle_disconnect(TickType_t wait)
+{
+    uint32_t delay_ms = 0;
+
+    taskENTER_CRITICAL();
+    bool rearm = wifi_sm_disconnected(&s_sm, now_ms(), &delay_ms);
+    uint32_t attempt = s_sm.attempt;
+    taskEXIT_CRITICAL();
+
+    if (rearm) {
+        ESP_LOGI(TAG, "Disconnected (reason %u), attempt %u in %u ms",
+                 s_last_reason, attempt, delay_ms);
+        arm_timer(delay_ms, wait);
+    }
+}
+
+static void run_action(wifi_sm_action_t action, TickType_t wait)
+{
+    if (action == WIFI_SM_CONNECT_FAST || action == WIFI_SM_CONNECT_SCAN) {
+        wifi_config_t config;
+        if (esp_wifi_get_config(ESP_IF_WIFI_STA, &config) == ESP_OK) {
+            bool fast = (action == WIFI_SM_CONNECT_FAST);
+            config.sta.bssid_set = fast;
+            config.sta.channel = fast ? s_cache.channel : 0;
+            if (fast) memcpy(config.sta.bssid, s_cache.bssid, 6);
+            esp_wifi_set_config(ESP_IF_WIFI_STA, &config);
+        }
+        esp_wifi_connect();
+        // Сторож попытки: если IP не получен, таймер прервет ее
+        arm_timer(WIFI_SM_ATTEMPT_TIMEOUT_MS, wait);
+    } else if (action == WIFI_SM_ABORT) {
+        ESP_LOGW(TAG, "Connection attempt timed out");
+        esp_wifi_disconnect();
+        handle_disconnect(wait);
+    }
+}
+
+static void timer_callback(TimerHandle_t timer)
+{
+    taskENTER_CRITICAL();
+    wifi_sm_action_t action = wifi_sm_timeout(&s_sm, now_ms());
+    taskEXIT_CRITICAL();
+
+    run_action(action, 0);
+}
+
+static void event_handler(void *arg, esp_event_base_t event_base,
+                          int32_t event_id, void *event_data)
+{
+    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
+        taskENTER_CRITICAL();
+        wifi_sm_action_t action = wifi_sm_start(&s_sm, now_ms());
+        taskEXIT_CRITICAL();
+        run_action(action, portMAX_DELAY);
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
+        wifi_event_sta_disconnected_t *event = (wifi_event_sta_disconnected_t *)event_data;
+        s_last_reason = event->reason;
+        handle_disconnect(portMAX_DELAY);
+    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+        xTimerStop(s_timer, portMAX_DELAY);
+
+        taskENTER_CRITICAL();
+        wifi_sm_connected(&s_sm, now_ms());
+        taskEXIT_CRITICAL();
+
+        wifi_ap_record_t ap_info;
+        if (esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK) {
+            save_cache((const char *)ap_info.ssid, ap_info.bssid, ap_info.primary);
+        }
+        ESP_LOGI(TAG, "Connected: boot %u ms, last reconnect %u ms, fast %u",
+                 s_sm.boot_connect_ms, s_sm.last_reconnect_ms, s_sm.fast_connects);
+    }
+}
+
+esp_err_t wifi_link_init(void)
+{
+    wifi_config_t config;
+    esp_err_t ret = esp_wifi_get_config(ESP_IF_WIFI_STA, &config);
+    if (ret != ESP_OK) return ret;
+
+    load_cache((const char *)config.sta.ssid);
+    wifi_sm_init(&s_sm, s_cache.channel != 0, esp_random());
+
+    s_timer = xTimerCreateStatic("wifi_link", 1, pdFALSE, NULL, timer_callback, &s_timer_buf);
+    if (s_timer == NULL) return ESP_ERR_NO_MEM;
+
+    ret = esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_STA_START, &event_handler, NULL);
+    if (ret == ESP_OK) {
+        ret = esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &event_handler, NULL);
+    }
+    if (ret == ESP_OK) {
+        ret = esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &event_handler, NULL);
+    }
+
+    if (s_cache.channel != 0) {
+        ESP_LOGI(TAG, "Cached AP %02x:%02x:%02x:%02x:%02x:%02x on channel %u",
+                 s_cache.bssid[0], s_cache.bssid[1], s_cache.bssid[2],
+                 s_cache.bssid[3], s_cache.bssid[4], s_cache.bssid[5], s_cache.channel);
+    }
+    return ret;
+}
+
+void wifi_link_get_stats(wifi_link_stats_t *stats)
+{
+    uint32_t now = now_ms();
+
+    taskENTER_CRITICAL();
+    stats->state = s_sm.state;
+    stats->cache_valid = s_sm.cache_valid;
+    stats->attempt = s_sm.attempt;
+    stats->down_ms = (s_sm.state == WIFI_SM_CONNECTED) ? 0 : now - s_sm.down_since_ms;
+    stats->boot_connect_ms = s_sm.boot_connect_ms;
+    stats->reconnects = s_sm.reconnects;
+    stats->fast_connects = s_sm.fast_connects;
+    stats->failed_attempts = s_sm.failed_attempts;
+    stats->last_reconnect_ms = s_sm.last_reconnect_ms;
+    stats->max_reconnect_ms = s_sm.max_reconnect_ms;
+    stats->avg_reconnect_ms = s_sm.reconnects ? (uint32_t)(s_sm.total_reconnect_ms / s_sm.reconnects) : 0;
+    taskEXIT_CRITICAL();
+
+    stats->channel = s_cache.channel;
+    stats->last_reason = s_last_reason;
+}
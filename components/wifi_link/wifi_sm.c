@@ -0,0 +1,111 @@
+#include <string.h>
+#include "wifi_sm.h"
+
+static uint32_t next_random(wifi_sm_t *sm)
+{
+    // xorshift32
+    uint32_t x = sm->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    sm->rng = x;
+    return x;
+}
+
+// Задержка перед попыткой номер attempt: 0, затем MIN*2^n в пределах MAX, разброс [d/2, d]
+static uint32_t backoff_delay(wifi_sm_t *sm, uint32_t attempt)
+{
+    if (attempt == 0) return 0;
+
+    uint32_t delay = WIFI_SM_BACKOFF_MIN_MS;
+    while (--attempt > 0 && delay < WIFI_SM_BACKOFF_MAX_MS) {
+        delay <<= 1;
+    }
+    if (delay > WIFI_SM_BACKOFF_MAX_MS) delay = WIFI_SM_BACKOFF_MAX_MS;
+
+    uint32_t half = delay / 2;
+    return half + next_random(sm) % (delay - half + 1);
+}
+
+static wifi_sm_action_t begin_attempt(wifi_sm_t *sm)
+{
+    sm->state = WIFI_SM_CONNECTING;
+    sm->fast_attempt = sm->cache_valid;
+    return sm->fast_attempt ? WIFI_SM_CONNECT_FAST : WIFI_SM_CONNECT_SCAN;
+}
+
+void wifi_sm_init(wifi_sm_t *sm, bool cache_valid, uint32_t seed)
+{
+    memset(sm, 0, sizeof(*sm));
+    sm->state = WIFI_SM_IDLE;
+    sm->cache_valid = cache_valid;
+    sm->rng = seed ? seed : 0x2545F491;
+}
+
+wifi_sm_action_t wifi_sm_start(wifi_sm_t *sm, uint32_t now_ms)
+{
+    sm->attempt = 0;
+    sm->delay_ms = 0;
+    sm->down_since_ms = now_ms;
+    return begin_attempt(sm);
+}
+
+void wifi_sm_connected(wifi_sm_t *sm, uint32_t now_ms)
+{
+    if (sm->state == WIFI_SM_CONNECTED) return;
+
+    uint32_t elapsed = now_ms - sm->down_since_ms;
+    if (sm->was_connected) {
+        sm->reconnects++;
+        sm->last_reconnect_ms = elapsed;
+        sm->total_reconnect_ms += elapsed;
+        if (elapsed > sm->max_reconnect_ms) sm->max_reconnect_ms = elapsed;
+    } else {
+        sm->boot_connect_ms = elapsed;
+    }
+    if (sm->state == WIFI_SM_CONNECTING && sm->fast_attempt) {
+        sm->fast_connects++;
+    }
+
+    sm->state = WIFI_SM_CONNECTED;
+    sm->was_connected = true;
+    sm->cache_valid = true;
+    sm->attempt = 0;
+    sm->delay_ms = 0;
+}
+
+bool wifi_sm_disconnected(wifi_sm_t *sm, uint32_t now_ms, uint32_t *delay_ms)
+{
+    switch (sm->state) {
+        case WIFI_SM_CONNECTED:
+            // Обрыв связи: сразу пробуем вернуться к той же точке
+            sm->down_since_ms = now_ms;
+            sm->attempt = 0;
+            break;
+
+        case WIFI_SM_CONNECTING:
+            // Неудачная попытка; кэш не помог - дальше только со сканированием
+            sm->failed_attempts++;
+            if (sm->fast_attempt) sm->cache_valid = false;
+            sm->attempt++;
+            break;
+
+        default:
+            // Повторное событие во время ожидания - таймер уже запущен
+            return false;
+    }
+
+    sm->state = WIFI_SM_WAITING;
+    sm->delay_ms = backoff_delay(sm, sm->attempt);
+    *delay_ms = sm->delay_ms;
+    return true;
+}
+
+wifi_sm_action_t wifi_sm_timeout(wifi_sm_t *sm, uint32_t now_ms)
+{
+    (void)now_ms;
+
+    if (sm->state == WIFI_SM_WAITING) return begin_attempt(sm);
+    if (sm->state == WIFI_SM_CONNECTING) return WIFI_SM_ABORT;
+    return WIFI_SM_NONE;
+}
@@ -1,17 +1,37 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "esp_system.h"
 #include "esp_wifi.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "nvs_flash.h"
 #include "esp_http_server.h"
 #include "driver/i2c.h"
 #include "driver/gpio.h"
 #include "bme280.h"
 #include "lcd.h"
+#include "ota.h"
+#include "metrics.h"
+#include "wifi_link.h"
+#include "telemetry.h"
+#include "derived.h"
+#include "summary.h"
+#include "health.h"
+#include "sensor_poll.h"
+#include "i2c_bus.h"
+#include "mqtt_uplink.h"
+#include "beacon.h"
+#include "dlog.h"
+#include "trace.h"
+#include "webui.h"
+#include "tls_uplink.h"
+#include "config_store.h"
 #include "tcpip_adapter.h"
 #include "esp_spiffs.h"
 #include "esp_http_client.h"
@@ -20,27 +40,49 @@
 #include "sdkconfig.h"
 #include <sys/param.h>
 
+// Значения настроек по умолчанию (см. app_config_defaults). Действующие
+// значения хранятся в NVS и меняются через /config без пересборки
+
 // Определения для I2C (WeMos D1 Mini)
 #define I2C_MASTER_SCL_IO           2
 #define I2C_MASTER_SDA_IO           14
-#define I2C_MASTER_NUM              I2C_NUM_0
-#define I2C_MASTER_TX_BUF_DISABLE   0
-#define I2C_MASTER_RX_BUF_DISABLE   0
-#define I2C_MASTER_FREQ_HZ          100000
-#define I2C_MASTER_TIMEOUT_MS       1000
 
 // Определения для WiFi
 #define WIFI_SSID      "your_ssid"
 #define WIFI_PASS      "your_password"
-#define MAXIMUM_RETRY  5
 #define AP_SSID        "Hydra-L"
 #define AP_PASS        "12345678"
 #define AP_MAX_CONN    4
 
+// Определения для телеметрии. Пустой адрес брокера - отправка HTTP POST на jsonadd.php
+#define SERVER_URL           "http://188.35.161.31/core/jsonadd.php"
+#define SERVER_CA_PATH       "/spiffs/ca.pem"      // CA сервера для https://
+#define MQTT_BROKER_URI      ""
+// Многоадресный UDP маяк и mDNS (_hydra._tcp) по адресу udp://группа:порт
+#define BEACON_URI           ""
+#define TELEMETRY_SAMPLE_MS  10000
+#define TELEMETRY_PUBLISH_MS 60000
+#define MQTT_BATCH_SAMPLES   12
+// Высота станции для приведения давления к уровню моря
+#define STATION_ALTITUDE_M   0
+// Окна сводок p5/p50/p95 (с)
+#define SUMMARY_WINDOWS      2
+#define SUMMARY_SHORT_S      3600
+#define SUMMARY_LONG_S       86400
+
 // Определения для OTA
 #define OTA_URL        "http://188.35.161.31/firmware/hydra-l.bin"
 #define OTA_TIMEOUT_MS 30000
 
+// Период измерений BME280 (кратен тику FreeRTOS) и окно скользящего среднего
+#define SENSOR_PERIOD_MS     5000
+#define SENSOR_AVG_COUNT     5
+// Восстановление после сбоя: попыток измерения за цикл и бюджет времени цикла.
+// В состоянии отказа восстановление - раз в SENSOR_FAILED_RETRY_SLOTS циклов (1 мин)
+#define SENSOR_ATTEMPTS      2
+#define SENSOR_BUDGET_MS     500
+#define SENSOR_FAILED_RETRY_SLOTS 12
+
 // Определения для кнопок
 #define BUTTON_1_GPIO     12
 #define BUTTON_2_GPIO     13
@@ -49,37 +91,153 @@
 // Глобальные переменные
 static const char *TAG = "ESP8266_RTOS";
 static EventGroupHandle_t s_wifi_event_group;
+static StaticEventGroup_t s_wifi_event_group_buf;
 #define WIFI_CONNECTED_BIT BIT0
-#define WIFI_FAIL_BIT      BIT1
 
-static int s_retry_num = 0;
+static const app_config_t app_config_defaults = {
+    .device_name = "Hydra-L-001",
+    .akey = "default_key",
+    .wifi_ssid = WIFI_SSID,
+    .wifi_pass = WIFI_PASS,
+    .ap_ssid = AP_SSID,
+    .ap_pass = AP_PASS,
+    .server_url = SERVER_URL,
+    .mqtt_uri = MQTT_BROKER_URI,
+    .beacon_uri = BEACON_URI,
+    .sample_ms = TELEMETRY_SAMPLE_MS,
+    .publish_ms = TELEMETRY_PUBLISH_MS,
+    .sensor_ms = SENSOR_PERIOD_MS,
+    .avg_count = SENSOR_AVG_COUNT,
+    .altitude = STATION_ALTITUDE_M,
+    .stats_short_s = SUMMARY_SHORT_S,
+    .stats_long_s = SUMMARY_LONG_S,
+    .sda_io = I2C_MASTER_SDA_IO,
+    .scl_io = I2C_MASTER_SCL_IO,
+    .button1_io = BUTTON_1_GPIO,
+    .button2_io = BUTTON_2_GPIO,
+};
+
+// Действующие настройки. Строки и выводы задаются при старте; числа без
+// CONFIG_RESTART меняет /config на ходу (запись 32-битного слова атомарна),
+// задачи перечитывают их каждый цикл
+static app_config_t app_config;
 
 // Структуры для хранения данных
 typedef struct {
     float temperature;
     float humidity;
     float pressure;
+    derived_t derived;
+    int64_t acquired_us;        // Запуск последнего измерения (мкс от старта)
+    uint32_t latency_us;        // От запуска измерения до получения результата
 } sensor_data_t;
 
 static sensor_data_t sensor_data = {0};
 
 // Глобальные переменные
-static char lcd_string1[17] = {0};
-static char lcd_string2[17] = {0};
+static char lcd_text[LCD_MAX_ROWS][LCD_MAX_COLS + 1] = {{0}};
 static char lcd_mode = '0';
 static bool lcd_backlight = true;
-static char device_name[32] = {0};
-static char akey[32] = {0};
+static bool server_tls = false;
+static telemetry_batch_t telemetry_batch = {0};
 
 // Глобальные переменные для сетевой информации
 static char current_ip[16] = "0.0.0.0";
 static char current_mac[18] = "00:00:00:00:00:00";
 static int current_rssi = 0;
 
-// Структура для усреднения показаний
-#define SENSOR_AVG_COUNT 5
+// Кадр дисплея: строка на каждую строку самого большого поддерживаемого дисплея
+typedef char lcd_frame_t[LCD_MAX_ROWS][LCD_MAX_COLS + 1];
+
+// Дисплеи на шине I2C (PCF8574: 0x20-0x27, PCF8574A: 0x38-0x3F). Основной
+// показывает текущий режим; если есть дисплей тревог, сценарии идут на него,
+// иначе - на основной.
+typedef enum {
+    DISPLAY_MAIN,
+    DISPLAY_ALARM,
+} display_role_t;
+
+typedef struct {
+    lcd_config_t config;
+    display_role_t role;
+    lcd_t lcd;
+    bool ready;
+    bool backlight_shown;
+} display_t;
+
+static display_t displays[] = {
+    { .config = LCD_CONFIG_1602(LCD_DEFAULT_ADDR), .role = DISPLAY_MAIN },
+    // Второй дисплей на той же шине, например 20x4 с перемычкой A0:
+    // { .config = LCD_CONFIG_2004(0x26), .role = DISPLAY_ALARM },
+};
+
+#define DISPLAY_COUNT (sizeof(displays) / sizeof(displays[0]))
+
+static display_role_t script_role = DISPLAY_MAIN;
+
+// Пакет команд управления: применяется атомарно, одним обновлением LCD.
+// Обработчики только ставят пакет в очередь lcd_task и сразу отвечают.
+#define CONTROL_MAX_BODY    1536
+#define CONTROL_QUEUE_LEN   8
+#define CONTROL_RESULTS     8
+#define SCRIPT_MAX_STEPS    16
+#define SCRIPT_MIN_HOLD_MS  100
+#define SCRIPT_MAX_HOLD_MS  60000
+
+// Шаг сценария (тревога, бегущая строка), который lcd_task проигрывает локально
+typedef struct {
+    lcd_frame_t line;
+    int8_t backlight;       // -1 - не менять
+    uint16_t hold_ms;
+} script_step_t;
+
 typedef struct {
-    float values[SENSOR_AVG_COUNT];
+    uint32_t id;
+    bool has_mode;
+    char mode;
+    bool next_mode;
+    bool has_line[LCD_MAX_ROWS];
+    lcd_frame_t line;
+    bool has_backlight;
+    bool backlight;
+    bool toggle_backlight;
+    bool has_script;        // Заменить сценарий (script_len == 0 - остановить)
+    script_step_t *script;  // В куче, после постановки в очередь принадлежит lcd_task
+    int script_len;
+    int script_repeat;      // 0 - повторять до отмены
+} control_batch_t;
+
+// Результат применения пакета (запрашивается через /result?id=N)
+typedef struct {
+    uint32_t id;
+    esp_err_t err;
+} control_result_t;
+
+static QueueHandle_t control_queue = NULL;
+static StaticQueue_t control_queue_buf;
+static uint8_t control_queue_storage[CONTROL_QUEUE_LEN * sizeof(control_batch_t)];
+// Выдача номера и постановка в очередь под одной блокировкой: номера в очереди
+// идут подряд и по возрастанию, поэтому control_applied_id не убывает
+static SemaphoreHandle_t control_lock = NULL;
+static StaticSemaphore_t control_lock_buf;
+static control_result_t control_results[CONTROL_RESULTS];
+static uint32_t control_next_id = 0;
+static uint32_t control_applied_id = 0;
+static uint32_t control_dropped = 0;
+
+// Состояние сценария (принадлежит lcd_task)
+static script_step_t *script_steps = NULL;
+static int script_len = 0;
+static int script_repeat = 0;
+static uint32_t script_generation = 0;
+
+// Буфер /config (все настройки в JSON и тело PATCH): httpd обслуживает запросы в одной задаче
+#define CONFIG_JSON_LEN     1024
+static char config_buf[CONFIG_JSON_LEN];
+
+// Структура для усреднения показаний (окно - app_config.avg_count)
+typedef struct {
+    float values[CONFIG_AVG_MAX];
     int index;
     int count;
 } sensor_avg_t;
@@ -88,6 +246,24 @@ static sensor_avg_t temp_avg = {0};
 static sensor_avg_t hum_avg = {0};
 static sensor_avg_t press_avg = {0};
 
+// Сводки по окнам: каналы в порядке telemetry_channels, пишет только sensor_task
+static summary_window_t summary_windows[SUMMARY_WINDOWS][TELEMETRY_CHANNELS];
+static uint32_t summary_published[SUMMARY_WINDOWS];     // Отправлено завершенных окон
+
+// Расписание измерений: задержка результата и отклонение запуска от расписания
+static latency_hist_t sensor_latency = {0};
+static latency_hist_t sensor_jitter = {0};
+static uint32_t sensor_errors = 0;
+static uint32_t sensor_skipped = 0;
+static sensor_poll_t sensor_poll;
+static health_t sensor_health;
+
+// Стоимость расчета производных величин в тактах CPU
+static uint32_t derived_count = 0;
+static uint32_t derived_cycles_last = 0;
+static uint32_t derived_cycles_max = 0;
+static uint64_t derived_cycles_total = 0;
+
 // Структура для хранения состояния кнопок
 typedef struct {
     uint32_t last_press_time;
@@ -98,10 +274,10 @@ static button_state_t button1_state = {0};
 static button_state_t button2_state = {0};
 
 // Функция для обновления скользящего среднего
-static float update_average(sensor_avg_t *avg, float new_value) {
+static float update_average(sensor_avg_t *avg, float new_value, int window) {
     avg->values[avg->index] = new_value;
-    avg->index = (avg->index + 1) % SENSOR_AVG_COUNT;
-    if (avg->count < SENSOR_AVG_COUNT) avg->count++;
+    avg->index = (avg->index + 1) % window;
+    if (avg->count < window) avg->count++;
     
     float sum = 0;
     for (int i = 0; i < avg->count; i++) {
@@ -110,52 +286,22 @@ static float update_average(sensor_avg_t *avg, float new_value) {
     return sum / avg->count;
 }
 
-// Инициализация I2C
-static esp_err_t i2c_master_init()
-{
-    int i2c_master_port = I2C_MASTER_NUM;
-    i2c_config_t conf;
-    conf.mode = I2C_MODE_MASTER;
-    conf.sda_io_num = I2C_MASTER_SDA_IO;
-    conf.sda_pullup_en = GPIO_PULLUP_ENABLE;
-    conf.scl_io_num = I2C_MASTER_SCL_IO;
-    conf.scl_pullup_en = GPIO_PULLUP_ENABLE;
-    conf.clk_stretch_tick = 300; // 300 ticks, Clock stretch is about 210us
-    
-    esp_err_t err = i2c_param_config(i2c_master_port, &conf);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "I2C param config failed: %s", esp_err_to_name(err));
-        return err;
-    }
-    
-    err = i2c_driver_install(i2c_master_port, conf.mode);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "I2C driver install failed: %s", esp_err_to_name(err));
-        return err;
-    }
-    
-    return ESP_OK;
-}
+// Шина I2C: BME280 и дисплеи (выводы - из app_config при старте)
+static i2c_bus_config_t i2c_bus_config = {
+    .clk_stretch_tick = 300, // 300 ticks, Clock stretch is about 210us
+};
 
 // Обработчик событий WiFi
 static void event_handler(void* arg, esp_event_base_t event_base,
                                 int32_t event_id, void* event_data)
 {
-    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
-        esp_wifi_connect();
-    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
-        if (s_retry_num < MAXIMUM_RETRY) {
-            esp_wifi_connect();
-            s_retry_num++;
-            ESP_LOGI(TAG, "retry to connect to the AP");
-        } else {
-            xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_BIT);
-        }
+    // Повторные подключения выполняет wifi_link
+    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
+        xEventGroupClearBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
         ESP_LOGI(TAG,"connect to the AP fail");
     } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
         ESP_LOGI(TAG, "got ip:" IPSTR, IP2STR(&event->ip_info.ip));
-        s_retry_num = 0;
         xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
         
         // Получаем сетевую информацию
@@ -179,91 +325,480 @@ static void event_handler(void* arg, esp_event_base_t event_base,
 // Обработчик для получения данных
 static esp_err_t data_handler(httpd_req_t *req)
 {
-    char buf[256];
+    char buf[384];
+    const derived_t *derived = &sensor_data.derived;
     snprintf(buf, sizeof(buf),
-             "{\"temperature\":%.1f,\"humidity\":%.1f,\"pressure\":%.1f,\"rssi\":%d,\"mac\":\"%s\",\"ip\":\"%s\"}",
+             "{\"temperature\":%.1f,\"humidity\":%.1f,\"pressure\":%.1f,"
+             "\"dew_point\":%.1f,\"abs_humidity\":%.2f,\"heat_index\":%.1f,"
+             "\"sea_level_pressure\":%.1f,\"acquired_ms\":%u,\"latency_us\":%u,"
+             "\"sensor_health\":\"%s\",\"rssi\":%d,\"mac\":\"%s\",\"ip\":\"%s\",\"summary\":[",
              sensor_data.temperature, sensor_data.humidity, sensor_data.pressure,
-             current_rssi, current_mac, current_ip);
-    
+             derived->dew_point / 100.0f, derived->abs_humidity / 1000.0f,
+             derived->heat_index / 100.0f, derived->sea_level_pressure / 100.0f,
+             (uint32_t)(sensor_data.acquired_us / 1000), sensor_data.latency_us,
+             health_name(sensor_health.state), current_rssi, current_mac, current_ip);
     httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, buf, strlen(buf));
-    return ESP_OK;
+    httpd_resp_send_chunk(req, buf, strlen(buf));
+
+    // Сводки: текущее (незавершенное) окно и итог последнего завершенного
+    for (int w = 0; w < SUMMARY_WINDOWS; w++) {
+        const summary_window_t *window = summary_windows[w];
+        snprintf(buf, sizeof(buf), "%s{\"period_s\":%u,\"start_s\":%u,\"last_start_s\":%u,",
+                 w ? "," : "", window[0].period_s, window[0].start_s, window[0].last_start_s);
+        httpd_resp_send_chunk(req, buf, strlen(buf));
+        for (int part = 0; part < 2; part++) {
+            httpd_resp_send_chunk(req, part ? ",\"last\":{" : "\"current\":{", part ? 9 : 11);
+            for (int c = 0; c < TELEMETRY_CHANNELS; c++) {
+                summary_result_t result;
+                if (part) {
+                    result = window[c].last;
+                } else {
+                    summary_get(&window[c].current, &result);
+                }
+                int n = snprintf(buf, sizeof(buf), "%s\"%s\":", c ? "," : "", telemetry_channels[c]);
+                if (telemetry_encode_stats(&result, buf + n, sizeof(buf) - n) > 0) {
+                    httpd_resp_send_chunk(req, buf, strlen(buf));
+                }
+            }
+            httpd_resp_send_chunk(req, "}", 1);
+        }
+        httpd_resp_send_chunk(req, "}", 1);
+    }
+
+    httpd_resp_send_chunk(req, "]}", 2);
+    return httpd_resp_send_chunk(req, NULL, 0);
 }
 
-// Функция отправки данных на сервер
-static void send_data_to_server(void)
+// Сведения об устройстве для документов телеметрии
+static void telemetry_device(telemetry_device_t *device)
+{
+    device->serial = app_config.device_name;
+    device->akey = app_config.akey;
+    device->rssi = current_rssi;
+    device->mac = current_mac;
+    device->ip = current_ip;
+    device->sensor_health = health_name(sensor_health.state);
+}
+
+// POST через esp_http_client: новое соединение на каждую отправку
+static esp_err_t post_plain(const char *body, int len, int *status)
 {
-    cJSON *root = cJSON_CreateObject();
-    cJSON *system = cJSON_CreateObject();
-    cJSON *bme280 = cJSON_CreateObject();
-    
-    cJSON_AddStringToObject(system, "Akey", akey);
-    cJSON_AddStringToObject(system, "Serial", device_name);
-    cJSON_AddStringToObject(system, "Version", "2024-03-20");
-    cJSON_AddNumberToObject(system, "RSSI", current_rssi);
-    cJSON_AddStringToObject(system, "MAC", current_mac);
-    cJSON_AddStringToObject(system, "IP", current_ip);
-    
-    cJSON_AddNumberToObject(bme280, "temp", sensor_data.temperature);
-    cJSON_AddNumberToObject(bme280, "humidity", sensor_data.humidity);
-    cJSON_AddNumberToObject(bme280, "pressure", sensor_data.pressure);
-    
-    cJSON_AddItemToObject(root, "system", system);
-    cJSON_AddItemToObject(root, "BME280", bme280);
-    
-    char *json_str = cJSON_Print(root);
-    cJSON_Delete(root);
-    
     esp_http_client_config_t config = {
-        .url = "http://188.35.161.31/core/jsonadd.php",
+        .url = app_config.server_url,
         .method = HTTP_METHOD_POST,
         .timeout_ms = 10000,
     };
-    
+
     esp_http_client_handle_t client = esp_http_client_init(&config);
-    if (client) {
-        esp_http_client_set_post_field(client, json_str, strlen(json_str));
-        esp_http_client_set_header(client, "Content-Type", "application/json");
-        
-        esp_err_t err = esp_http_client_perform(client);
-        if (err == ESP_OK) {
-            ESP_LOGI(TAG, "Data sent successfully");
-        } else {
-            ESP_LOGE(TAG, "HTTP POST request failed: %s", esp_err_to_name(err));
+    if (client == NULL) return ESP_ERR_NO_MEM;
+    esp_http_client_set_post_field(client, body, len);
+    esp_http_client_set_header(client, "Content-Type", "application/json");
+
+    esp_err_t err = esp_http_client_perform(client);
+    if (err == ESP_OK) {
+        *status = esp_http_client_get_status_code(client);
+    }
+    esp_http_client_cleanup(client);
+    return err;
+}
+
+// HTTP POST последнего измерения на jsonadd.php
+static void send_data_to_server(void)
+{
+    char json_str[512];
+    telemetry_device_t device;
+    telemetry_device(&device);
+
+    if (telemetry_batch.count == 0) return;
+    const telemetry_sample_t *latest = &telemetry_batch.samples[
+        (telemetry_batch.head + telemetry_batch.count - 1) % TELEMETRY_BATCH_MAX];
+    int len = telemetry_encode_post(&device, latest, json_str, sizeof(json_str));
+    if (len < 0) {
+        DLOGE(TAG, "Telemetry payload too large");
+        return;
+    }
+
+    // https:// - соединение и сессия TLS переиспользуются между отправками
+    int status = 0;
+    esp_err_t err = server_tls ? tls_uplink_post(json_str, len, &status)
+                               : post_plain(json_str, len, &status);
+    if (err == ESP_OK) {
+        DLOGI(TAG, "Data sent successfully, status %d", status);
+        telemetry_batch_consume(&telemetry_batch, telemetry_batch.count);
+    } else {
+        DLOGE(TAG, "HTTP POST request failed: %s", esp_err_to_name(err));
+    }
+}
+
+// Публикация накопленных измерений пакетами через MQTT, пока есть место в окне QoS 1.
+// Измерения остаются в буфере до PUBACK; не дождавшиеся его уходят повторно
+static void publish_telemetry(void)
+{
+    char buf[512];
+    telemetry_device_t device;
+    telemetry_device(&device);
+
+    uint32_t acked;
+    bool lost = mqtt_uplink_take_samples(&acked);
+    telemetry_batch_ack(&telemetry_batch, acked);
+    if (lost) telemetry_batch_resend(&telemetry_batch);
+
+    while (telemetry_batch.count > telemetry_batch.sent && mqtt_uplink_window_free() > 0) {
+        uint32_t encoded = 0;
+        int len = telemetry_encode_batch(&device, &telemetry_batch, MQTT_BATCH_SAMPLES,
+                                         buf, sizeof(buf), &encoded);
+        if (len < 0 || mqtt_uplink_publish_samples("readings", buf, len, encoded) != ESP_OK) {
+            break;
         }
-        
-        esp_http_client_cleanup(client);
+        telemetry_batch_mark_sent(&telemetry_batch, encoded);
     }
-    
-    free(json_str);
+
+    // Итог каждого завершенного окна - в summary/<период> (retained: последний итог
+    // доступен подписчику сразу). Пропущенные при обрыве связи окна не досылаются
+    for (int w = 0; w < SUMMARY_WINDOWS; w++) {
+        const summary_window_t *window = summary_windows[w];
+        uint32_t closed = window[0].closed;
+        if (closed == summary_published[w] || mqtt_uplink_window_free() == 0) continue;
+
+        summary_result_t results[TELEMETRY_CHANNELS];
+        for (int c = 0; c < TELEMETRY_CHANNELS; c++) {
+            results[c] = window[c].last;
+        }
+        char topic[24];
+        snprintf(topic, sizeof(topic), "summary/%u", window[0].period_s);
+        int len = telemetry_encode_summary(&device, window[0].period_s, window[0].last_start_s,
+                                           results, buf, sizeof(buf));
+        if (len > 0 && mqtt_uplink_publish(topic, buf, len, 1, true) == ESP_OK) {
+            summary_published[w] = closed;
+        }
+    }
+
+    int len = telemetry_encode_status(&device, (uint32_t)(esp_timer_get_time() / 1000000),
+                                      buf, sizeof(buf));
+    if (len > 0) {
+        mqtt_uplink_publish("status", buf, len, 0, true);
+    }
+}
+
+// Постановка пакета в очередь lcd_task без ожидания.
+// Возвращает идентификатор для /result или 0, если очередь переполнена.
+static uint32_t control_submit(control_batch_t *batch)
+{
+    xSemaphoreTake(control_lock, portMAX_DELAY);
+    batch->id = control_next_id + 1;
+    bool queued = xQueueSend(control_queue, batch, 0) == pdTRUE;
+    if (queued) {
+        control_next_id = batch->id;
+    } else {
+        control_dropped++;
+    }
+    xSemaphoreGive(control_lock);
+
+    if (!queued) {
+        free(batch->script);
+        return 0;
+    }
+    return batch->id;
 }
 
-// Загрузка конфигурации
-static esp_err_t load_config(void)
+// Применение пакета команд (выполняется в lcd_task - владельце дисплея)
+static void control_apply(control_batch_t *batch)
 {
-    FILE *f = fopen("/spiffs/config.txt", "r");
-    if (f == NULL) {
-        ESP_LOGW(TAG, "Config file not found, using defaults");
-        strcpy(device_name, "Hydra-L-001");
-        strcpy(akey, "default_key");
+    if (batch->has_mode) {
+        lcd_mode = batch->mode;
+    }
+    if (batch->next_mode) {
+        lcd_mode = (lcd_mode == '3') ? '0' : (lcd_mode + 1);
+    }
+    for (int row = 0; row < LCD_MAX_ROWS; row++) {
+        if (batch->has_line[row]) {
+            strcpy(lcd_text[row], batch->line[row]);
+        }
+    }
+    if (batch->has_backlight) {
+        lcd_backlight = batch->backlight;
+    }
+    if (batch->toggle_backlight) {
+        lcd_backlight = !lcd_backlight;
+    }
+    if (batch->has_script) {
+        free(script_steps);
+        script_steps = batch->script;
+        script_len = batch->script_len;
+        script_repeat = batch->script_repeat;
+        script_generation++;
+    }
+
+    control_results[batch->id % CONTROL_RESULTS].id = batch->id;
+    control_results[batch->id % CONTROL_RESULTS].err = ESP_OK;
+}
+
+static void copy_lcd_line(char *dst, const char *src)
+{
+    strncpy(dst, src, LCD_MAX_COLS);
+    dst[LCD_MAX_COLS] = '\0';
+}
+
+// Разбор строк дисплея: массив до LCD_MAX_ROWS элементов, null - строку не менять.
+// Строки длиннее дисплея обрезаются при выводе
+static const char *control_parse_lines(const cJSON *lcd, lcd_frame_t line, bool has_line[LCD_MAX_ROWS])
+{
+    if (!cJSON_IsArray(lcd) || cJSON_GetArraySize(lcd) > LCD_MAX_ROWS) {
+        return "lcd must be an array of up to 4 lines";
+    }
+    for (int i = 0; i < cJSON_GetArraySize(lcd); i++) {
+        const cJSON *item = cJSON_GetArrayItem(lcd, i);
+        if (cJSON_IsNull(item)) {
+            continue;
+        }
+        if (!cJSON_IsString(item)) {
+            return "lcd lines must be strings";
+        }
+        copy_lcd_line(line[i], item->valuestring);
+        has_line[i] = true;
+    }
+    return NULL;
+}
+
+static const char *control_parse_led(const cJSON *led, bool *backlight)
+{
+    if (cJSON_IsBool(led)) {
+        *backlight = cJSON_IsTrue(led);
+    } else if (cJSON_IsNumber(led)) {
+        *backlight = led->valueint != 0;
+    } else {
+        return "led must be 0 or 1";
+    }
+    return NULL;
+}
+
+// Разбор сценария; шаги размещаются в куче и передаются lcd_task вместе с пакетом.
+// Блок всегда на SCRIPT_MAX_STEPS шагов: одинаковые блоки не дробят кучу
+static const char *control_parse_script(const cJSON *root, const cJSON *script,
+                                        control_batch_t *batch)
+{
+    int count = cJSON_GetArraySize(script);
+    script_step_t *steps = NULL;
+    if (count > 0) {
+        steps = calloc(SCRIPT_MAX_STEPS, sizeof(script_step_t));
+        if (!steps) return "out of memory";
+    }
+    batch->has_script = true;
+    batch->script = steps;
+    batch->script_len = count;
+    batch->script_repeat = 1;
+
+    for (int i = 0; i < count; i++) {
+        const cJSON *item = cJSON_GetArrayItem(script, i);
+        script_step_t *step = &steps[i];
+        bool has_line[LCD_MAX_ROWS] = {false};
+        step->backlight = -1;
+        step->hold_ms = 1000;
+
+        if (!cJSON_IsObject(item)) {
+            return "script steps must be objects";
+        }
+        const cJSON *field = cJSON_GetObjectItem(item, "lcd");
+        if (field) {
+            const char *err = control_parse_lines(field, step->line, has_line);
+            if (err) return err;
+        }
+        field = cJSON_GetObjectItem(item, "led");
+        if (field) {
+            bool on;
+            const char *err = control_parse_led(field, &on);
+            if (err) return err;
+            step->backlight = on ? 1 : 0;
+        }
+        field = cJSON_GetObjectItem(item, "hold");
+        if (field) {
+            if (!cJSON_IsNumber(field)) return "hold must be a number";
+            step->hold_ms = MIN(MAX(field->valueint, SCRIPT_MIN_HOLD_MS), SCRIPT_MAX_HOLD_MS);
+        }
+    }
+
+    const cJSON *repeat = cJSON_GetObjectItem(root, "repeat");
+    if (repeat) {
+        if (!cJSON_IsNumber(repeat) || repeat->valueint < 0) {
+            return "repeat must be a non-negative number";
+        }
+        batch->script_repeat = repeat->valueint;
+    }
+    return NULL;
+}
+
+/*
+ * Разбор документа управления:
+ *   {"mode":"1", "lcd":["line 1","line 2"], "led":1,
+ *    "script":[{"lcd":["ALARM",""],"led":1,"hold":500}, ...], "repeat":10}
+ * Все поля необязательны; "script":[] останавливает текущий сценарий.
+ */
+static const char *control_parse(const cJSON *root, control_batch_t *batch)
+{
+    memset(batch, 0, sizeof(*batch));
+    if (!cJSON_IsObject(root)) {
+        return "document must be a JSON object";
+    }
+
+    const cJSON *mode = cJSON_GetObjectItem(root, "mode");
+    if (mode) {
+        if (!cJSON_IsString(mode) || strlen(mode->valuestring) != 1) {
+            return "mode must be a one-character string";
+        }
+        batch->has_mode = true;
+        batch->mode = mode->valuestring[0];
+    }
+
+    const cJSON *lcd = cJSON_GetObjectItem(root, "lcd");
+    if (lcd) {
+        const char *err = control_parse_lines(lcd, batch->line, batch->has_line);
+        if (err) return err;
+    }
+
+    const cJSON *led = cJSON_GetObjectItem(root, "led");
+    if (led) {
+        const char *err = control_parse_led(led, &batch->backlight);
+        if (err) return err;
+        batch->has_backlight = true;
+    }
+
+    const cJSON *script = cJSON_GetObjectItem(root, "script");
+    if (script) {
+        if (!cJSON_IsArray(script) || cJSON_GetArraySize(script) > SCRIPT_MAX_STEPS) {
+            return "script must be an array of up to 16 steps";
+        }
+        return control_parse_script(root, script, batch);
+    }
+    return NULL;
+}
+
+// Обработчики HTTP
+static esp_err_t control_handler(httpd_req_t *req)
+{
+    if (req->content_len == 0 || req->content_len > CONTROL_MAX_BODY) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Body must be 1..1536 bytes");
+        return ESP_FAIL;
+    }
+
+    // httpd обслуживает запросы в одной задаче, поэтому буфер тела общий
+    static char body[CONTROL_MAX_BODY + 1];
+    size_t received = 0;
+    while (received < req->content_len) {
+        int ret = httpd_req_recv(req, body + received, req->content_len - received);
+        if (ret <= 0) {
+            return ESP_FAIL;
+        }
+        received += ret;
+    }
+    body[received] = '\0';
+
+    cJSON *root = cJSON_Parse(body);
+    if (!root) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        return ESP_FAIL;
+    }
+
+    control_batch_t batch;
+    const char *err = control_parse(root, &batch);
+    cJSON_Delete(root);
+    if (err) {
+        free(batch.script);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, err);
+        return ESP_FAIL;
+    }
+
+    uint32_t id = control_submit(&batch);
+    if (id == 0) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_send(req, "Control queue full", 18);
         return ESP_OK;
     }
-    
-    char line[64];
-    if (fgets(line, sizeof(line), f)) {
-        line[strcspn(line, "\n")] = 0;
-        strncpy(device_name, line, sizeof(device_name) - 1);
+
+    char buf[32];
+    snprintf(buf, sizeof(buf), "{\"id\":%u}", id);
+    httpd_resp_set_status(req, "202 Accepted");
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, buf, strlen(buf));
+    return ESP_OK;
+}
+
+// Команда из темы MQTT hydra-l/<serial>/cmd (тот же формат, что у /control)
+static void mqtt_command_handler(const char *data, int len)
+{
+    // Вызывается только из задачи MQTT клиента
+    static char body[CONTROL_MAX_BODY + 1];
+    char ack[96];
+    cJSON *root = NULL;
+    const char *err = NULL;
+    control_batch_t batch = {0};
+
+    if (len <= 0 || len > CONTROL_MAX_BODY) {
+        err = "Body must be 1..1536 bytes";
+    } else {
+        memcpy(body, data, len);
+        body[len] = '\0';
+        root = cJSON_Parse(body);
+        err = root ? control_parse(root, &batch) : "Invalid JSON";
+        cJSON_Delete(root);
     }
-    if (fgets(line, sizeof(line), f)) {
-        line[strcspn(line, "\n")] = 0;
-        strncpy(akey, line, sizeof(akey) - 1);
+
+    uint32_t id = 0;
+    if (!err && (id = control_submit(&batch)) == 0) {
+        err = "Control queue full";
     }
-    
-    fclose(f);
+    if (err) {
+        free(batch.script);
+        snprintf(ack, sizeof(ack), "{\"error\":\"%s\"}", err);
+    } else {
+        snprintf(ack, sizeof(ack), "{\"id\":%u}", id);
+    }
+    mqtt_uplink_publish("cmd/ack", ack, strlen(ack), 0, false);
+}
+
+// Ответ старых обработчиков: "OK" сразу после постановки в очередь
+static esp_err_t control_submit_legacy(httpd_req_t *req, control_batch_t *batch)
+{
+    if (control_submit(batch) == 0) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_send(req, "Control queue full", 18);
+        return ESP_OK;
+    }
+    httpd_resp_send(req, "OK", 2);
+    return ESP_OK;
+}
+
+// Состояние ранее поставленного пакета: pending, done или failed
+static esp_err_t result_handler(httpd_req_t *req)
+{
+    char query[32];
+    char value[12];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "id", value, sizeof(value)) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing id");
+        return ESP_FAIL;
+    }
+
+    uint32_t id = strtoul(value, NULL, 10);
+    const control_result_t *result = &control_results[id % CONTROL_RESULTS];
+    const char *state = "expired";
+    esp_err_t err = ESP_OK;
+    if (id == 0 || id > control_next_id) {
+        state = "unknown";
+    } else if (id > control_applied_id) {
+        state = "pending";
+    } else if (result->id == id) {
+        err = result->err;
+        state = (err == ESP_OK) ? "done" : "failed";
+    }
+
+    char buf[96];
+    snprintf(buf, sizeof(buf), "{\"id\":%u,\"state\":\"%s\",\"error\":\"%s\"}",
+             id, state, esp_err_to_name(err));
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, buf, strlen(buf));
     return ESP_OK;
 }
 
-// Обработчики HTTP
 static esp_err_t set_mode_handler(httpd_req_t *req)
 {
     char buf[10];
@@ -273,10 +808,11 @@ static esp_err_t set_mode_handler(httpd_req_t *req)
     }
     buf[ret] = '\0';
     
-    lcd_mode = buf[0];
-    
-    httpd_resp_send(req, "OK", 2);
-    return ESP_OK;
+    control_batch_t batch = {
+        .has_mode = true,
+        .mode = buf[0],
+    };
+    return control_submit_legacy(req, &batch);
 }
 
 static esp_err_t set_lcd_handler(httpd_req_t *req)
@@ -292,13 +828,13 @@ static esp_err_t set_lcd_handler(httpd_req_t *req)
     char *str = strtok(NULL, "=");
     
     if (num && str) {
-        if (strcmp(num, "1") == 0) {
-            strncpy(lcd_string1, str, 16);
-            lcd_string1[16] = '\0';
-        } else if (strcmp(num, "2") == 0) {
-            strncpy(lcd_string2, str, 16);
-            lcd_string2[16] = '\0';
+        control_batch_t batch = {0};
+        int row = atoi(num) - 1;
+        if (row >= 0 && row < LCD_MAX_ROWS) {
+            batch.has_line[row] = true;
+            copy_lcd_line(batch.line[row], str);
         }
+        return control_submit_legacy(req, &batch);
     }
     
     httpd_resp_send(req, "OK", 2);
@@ -314,58 +850,464 @@ static esp_err_t set_led_handler(httpd_req_t *req)
     }
     buf[ret] = '\0';
     
-    if (strcmp(buf, "1") == 0) {
-        lcd_backlight = true;
-        lcd_backlight_on();
+    control_batch_t batch = {
+        .has_backlight = true,
+        .backlight = strcmp(buf, "1") == 0,
+    };
+    return control_submit_legacy(req, &batch);
+}
+
+// Запросы, меняющие прошивку или настройки, подписываются ключом устройства
+// в заголовке X-Akey. Сравнение без раннего выхода по первому несовпадению
+static bool request_authorized(httpd_req_t *req)
+{
+    char key[sizeof(app_config.akey) + 1];
+    uint8_t diff = 0;
+    if (httpd_req_get_hdr_value_str(req, "X-Akey", key, sizeof(key)) != ESP_OK ||
+        strlen(key) != strlen(app_config.akey)) {
+        diff = 1;
     } else {
-        lcd_backlight = false;
-        lcd_backlight_off();
+        for (size_t i = 0; key[i]; i++) diff |= key[i] ^ app_config.akey[i];
     }
-    
+    if (diff) {
+        DLOGW(TAG, "Unauthorized %s", req->uri);
+        httpd_resp_set_status(req, "401 Unauthorized");
+        httpd_resp_send(req, "X-Akey required", 15);
+        return false;
+    }
+    return true;
+}
+
+// Запуск OTA обновления (тело запроса - необязательный URL образа)
+static esp_err_t ota_start_handler(httpd_req_t *req)
+{
+    if (!request_authorized(req)) return ESP_OK;
+
+    char url[256] = OTA_URL;
+    if (req->content_len > 0) {
+        if (req->content_len >= sizeof(url)) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "URL too long");
+            return ESP_FAIL;
+        }
+        size_t received = 0;
+        while (received < req->content_len) {
+            int ret = httpd_req_recv(req, url + received, req->content_len - received);
+            if (ret <= 0) {
+                return ESP_FAIL;
+            }
+            received += ret;
+        }
+        url[received] = '\0';
+    }
+
+    esp_err_t err = ota_start(url, OTA_TIMEOUT_MS);
+    if (err != ESP_OK) {
+        httpd_resp_set_status(req, "409 Conflict");
+        httpd_resp_send(req, esp_err_to_name(err), strlen(esp_err_to_name(err)));
+        return ESP_OK;
+    }
+
     httpd_resp_send(req, "OK", 2);
     return ESP_OK;
 }
 
+// Состояние OTA обновления
+static esp_err_t ota_status_handler(httpd_req_t *req)
+{
+    static const char *states[] = {"idle", "downloading", "verifying", "done", "failed"};
+    ota_status_t status;
+    ota_get_status(&status);
+
+    char buf[320];
+    snprintf(buf, sizeof(buf),
+             "{\"state\":\"%s\",\"delta\":%s,\"size\":%u,\"transfer\":%u,\"written\":%u,"
+             "\"resumed_from\":%u,\"throughput_bps\":%u,\"elapsed_ms\":%u,\"peak_heap\":%u,"
+             "\"error\":\"%s\"}",
+             states[status.state], status.delta ? "true" : "false", status.image_size,
+             status.transfer_size, status.bytes_written, status.resumed_from,
+             status.throughput_bps, status.elapsed_ms, status.peak_heap_used,
+             esp_err_to_name(status.last_error));
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, buf, strlen(buf));
+    return ESP_OK;
+}
+
+// Применение изменившихся настроек без CONFIG_RESTART к работающим задачам
+static void config_apply(uint32_t changed)
+{
+    const app_config_t *saved = config_store_get();
+    if (changed & CONFIG_BIT(CONFIG_SAMPLE_MS))  app_config.sample_ms = saved->sample_ms;
+    if (changed & CONFIG_BIT(CONFIG_PUBLISH_MS)) app_config.publish_ms = saved->publish_ms;
+    if (changed & CONFIG_BIT(CONFIG_SENSOR_MS))  app_config.sensor_ms = saved->sensor_ms;
+    if (changed & CONFIG_BIT(CONFIG_AVG_COUNT))  app_config.avg_count = saved->avg_count;
+    if (changed & CONFIG_BIT(CONFIG_ALTITUDE))   app_config.altitude = saved->altitude;
+}
+
+// Список имен полей маски в JSON массиве
+static int config_fields_json(char *buf, size_t len, const char *name, uint32_t mask)
+{
+    int pos = snprintf(buf, len, "\"%s\":[", name);
+    int listed = 0;
+    for (int i = 0; i < CONFIG_FIELD_COUNT && (size_t)pos < len; i++) {
+        if (mask & CONFIG_BIT(i)) {
+            pos += snprintf(buf + pos, len - pos, "%s\"%s\"", listed++ ? "," : "",
+                            config_store_field_name(i));
+        }
+    }
+    if ((size_t)pos < len) pos += snprintf(buf + pos, len - pos, "]");
+    return pos;
+}
+
+// Настройки: значения, версия схемы и поля, ждущие перезагрузки
+static esp_err_t config_get_handler(httpd_req_t *req)
+{
+    int len = config_store_json(config_buf, sizeof(config_buf));
+    if (len < 0) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, config_buf, len);
+}
+
+// Изменение части настроек: проверяется и сохраняется целиком или отклоняется
+static esp_err_t config_patch_handler(httpd_req_t *req)
+{
+    if (!request_authorized(req)) return ESP_OK;
+
+    if (req->content_len == 0 || req->content_len >= sizeof(config_buf)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Body must be 1..1023 bytes");
+        return ESP_FAIL;
+    }
+    size_t received = 0;
+    while (received < req->content_len) {
+        int ret = httpd_req_recv(req, config_buf + received, req->content_len - received);
+        if (ret <= 0) {
+            return ESP_FAIL;
+        }
+        received += ret;
+    }
+    config_buf[received] = '\0';
+
+    uint32_t changed;
+    const char *err = config_store_patch(config_buf, &changed);
+    if (err) {
+        DLOGW(TAG, "Config rejected");
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, err);
+        return ESP_FAIL;
+    }
+    config_apply(changed);
+
+    uint32_t restart = 0;
+    for (int i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        if (config_store_field_flags(i) & CONFIG_RESTART) restart |= CONFIG_BIT(i);
+    }
+    DLOGI(TAG, "Config changed 0x%x", changed);
+
+    // Ответ: что уже действует и что ждет перезагрузки
+    int pos = snprintf(config_buf, sizeof(config_buf), "{");
+    pos += config_fields_json(config_buf + pos, sizeof(config_buf) - pos, "applied", changed & ~restart);
+    pos += snprintf(config_buf + pos, sizeof(config_buf) - pos, ",");
+    pos += config_fields_json(config_buf + pos, sizeof(config_buf) - pos, "restart", changed & restart);
+    pos += snprintf(config_buf + pos, sizeof(config_buf) - pos, "}");
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, config_buf, strlen(config_buf));
+}
+
+// Журнал событий: текст, ?format=bin - двоичная выгрузка для tools/dlog_decode.py,
+// ?clear=1 - очистка после чтения
+static esp_err_t log_handler(httpd_req_t *req)
+{
+    static dlog_slot_t slots[DLOG_SLOTS];
+    dlog_dump_header_t header;
+    char query[32];
+    char value[8];
+    bool binary = false, clear = false;
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        binary = httpd_query_key_value(query, "format", value, sizeof(value)) == ESP_OK &&
+                 strcmp(value, "bin") == 0;
+        clear = httpd_query_key_value(query, "clear", value, sizeof(value)) == ESP_OK &&
+                strcmp(value, "1") == 0;
+    }
+
+    // Буфер снимка общий, а обработчики веб-сервера выполняются в одной задаче
+    dlog_snapshot(slots, &header);
+    if (clear) dlog_clear();
+
+    if (binary) {
+        httpd_resp_set_type(req, "application/octet-stream");
+        httpd_resp_send_chunk(req, (const char *)&header, sizeof(header));
+        httpd_resp_send_chunk(req, (const char *)slots, header.count * sizeof(dlog_slot_t));
+        return httpd_resp_send_chunk(req, NULL, 0);
+    }
+
+    char line[128];
+    httpd_resp_set_type(req, "text/plain");
+    for (uint32_t i = 0; i < header.count; i++) {
+        if (i == 0 || slots[i].prev_boot != slots[i - 1].prev_boot) {
+            const char *marker = slots[i].prev_boot ? "# --- previous boot ---\n"
+                                                    : "# --- current boot ---\n";
+            httpd_resp_send_chunk(req, marker, strlen(marker));
+        }
+        int n = dlog_format(&slots[i], line, sizeof(line) - 1);
+        line[n++] = '\n';
+        httpd_resp_send_chunk(req, line, n);
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+// Копия таблицы задач трассировки (обработчики веб-сервера выполняются в одной задаче)
+static trace_task_t trace_tasks[TRACE_TASKS];
+
+// Трасса исполнения для tools/trace_export.py (?clear=1 - начать запись заново)
+static esp_err_t trace_handler(httpd_req_t *req)
+{
+    trace_dump_header_t header;
+    char query[32];
+    char value[8];
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "clear", value, sizeof(value)) == ESP_OK &&
+        strcmp(value, "1") == 0) {
+        trace_clear();
+        httpd_resp_send(req, "OK", 2);
+        return ESP_OK;
+    }
+
+    // Во время выгрузки буфер не меняется: события не пишутся, время задач копится
+    trace_set_enabled(false);
+    trace_get_header(&header);
+    trace_get_tasks(trace_tasks);
+
+    httpd_resp_set_type(req, "application/octet-stream");
+    esp_err_t ret = httpd_resp_send_chunk(req, (const char *)&header, sizeof(header));
+    if (ret == ESP_OK) {
+        ret = httpd_resp_send_chunk(req, (const char *)trace_tasks,
+                                    header.tasks * sizeof(trace_task_t));
+    }
+    for (uint32_t index = 0; ret == ESP_OK && index < header.count; ) {
+        uint32_t run;
+        const trace_event_t *events = trace_events(index, &run);
+        run = MIN(run, 128);
+        ret = httpd_resp_send_chunk(req, (const char *)events, run * sizeof(trace_event_t));
+        index += run;
+    }
+    trace_set_enabled(true);
+
+    if (ret != ESP_OK) return ret;
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+// Маршрут веб-сервера со статистикой задержки обработчика
+typedef struct {
+    const char *uri;
+    httpd_method_t method;
+    esp_err_t (*handler)(httpd_req_t *req);
+    latency_hist_t latency;
+} http_route_t;
+
+static esp_err_t stats_handler(httpd_req_t *req);
+static int memory_stats_json(char *buf, size_t len);
+
+static http_route_t http_routes[] = {
+    { "/getData",  HTTP_GET,  data_handler },
+    { "/getStats", HTTP_GET,  stats_handler },
+    { "/setMode",  HTTP_POST, set_mode_handler },
+    { "/setLCD",   HTTP_POST, set_lcd_handler },
+    { "/setLED",   HTTP_POST, set_led_handler },
+    { "/control",  HTTP_POST, control_handler },
+    { "/result",   HTTP_GET,  result_handler },
+    { "/ota",      HTTP_POST, ota_start_handler },
+    { "/ota",      HTTP_GET,  ota_status_handler },
+    { "/log",      HTTP_GET,  log_handler },
+    { "/trace",    HTTP_GET,  trace_handler },
+    { "/config",   HTTP_GET,  config_get_handler },
+    { "/config",   HTTP_PATCH, config_patch_handler },
+    // Панель управления из SPIFFS - последней, чтобы не перекрывать API
+    { "/*",        HTTP_GET,  webui_handler },
+};
+
+#define HTTP_ROUTE_COUNT (sizeof(http_routes) / sizeof(http_routes[0]))
+
+static esp_err_t timed_handler(httpd_req_t *req)
+{
+    http_route_t *route = (http_route_t *)req->user_ctx;
+    uint8_t index = route - http_routes;
+    int64_t started = esp_timer_get_time();
+    trace_begin(TRACE_HTTPD, index);
+    esp_err_t ret = route->handler(req);
+    trace_end(TRACE_HTTPD, index);
+    latency_record(&route->latency, (uint32_t)(esp_timer_get_time() - started));
+    return ret;
+}
+
+// Статистика: задержки обработчиков и очередь команд
+static esp_err_t stats_handler(httpd_req_t *req)
+{
+    char buf[384];
+    wifi_link_stats_t wifi;
+    httpd_resp_set_type(req, "application/json");
+
+    snprintf(buf, sizeof(buf),
+             "{\"uptime_ms\":%u,\"control\":{\"submitted\":%u,\"applied\":%u,\"dropped\":%u},"
+             "\"derived\":{\"count\":%u,\"cycles_last\":%u,\"cycles_avg\":%u,\"cycles_max\":%u},",
+             (uint32_t)(esp_timer_get_time() / 1000), control_next_id, control_applied_id,
+             control_dropped, derived_count, derived_cycles_last,
+             derived_count ? (uint32_t)(derived_cycles_total / derived_count) : 0,
+             derived_cycles_max);
+    httpd_resp_send_chunk(req, buf, strlen(buf));
+
+    snprintf(buf, sizeof(buf),
+             "\"sensor\":{\"period_ms\":%u,\"conversion_us\":%u,\"samples\":%u,\"errors\":%u,"
+             "\"skipped\":%u,\"latency_us\":{\"p50\":%u,\"p99\":%u,\"max\":%u},"
+             "\"jitter_us\":{\"p50\":%u,\"p99\":%u,\"max\":%u},"
+             "\"health\":\"%s\",\"failures\":%u,\"transitions\":%u,\"reinits\":%u},",
+             app_config.sensor_ms, bme280_measure_time_us(), sensor_latency.count, sensor_errors,
+             sensor_skipped, latency_percentile(&sensor_latency, 50),
+             latency_percentile(&sensor_latency, 99), sensor_latency.max_us,
+             latency_percentile(&sensor_jitter, 50), latency_percentile(&sensor_jitter, 99),
+             sensor_jitter.max_us, health_name(sensor_health.state), sensor_health.failures,
+             sensor_health.transitions, sensor_poll.reinits);
+    httpd_resp_send_chunk(req, buf, strlen(buf));
+
+    i2c_bus_stats_t i2c;
+    i2c_bus_get_stats(&i2c);
+    snprintf(buf, sizeof(buf),
+             "\"i2c\":{\"transactions\":%u,\"errors\":%u,\"busy\":%u,\"recoveries\":%u,"
+             "\"stuck\":%u},",
+             i2c.transactions, i2c.errors, i2c.busy, i2c.recoveries, i2c.stuck);
+    httpd_resp_send_chunk(req, buf, strlen(buf));
+
+    config_store_stats_t cfg;
+    config_store_get_stats(&cfg);
+    snprintf(buf, sizeof(buf),
+             "\"config\":{\"stored_version\":%u,\"migrated\":%s,\"imported\":%s,\"load_us\":%u,"
+             "\"invalid\":%u,\"patches\":%u,\"rejected\":%u,\"restart_pending\":%u},",
+             cfg.version, cfg.migrated ? "true" : "false", cfg.legacy_imported ? "true" : "false",
+             cfg.load_us, cfg.invalid, cfg.patches, cfg.rejected, cfg.restart_pending);
+    httpd_resp_send_chunk(req, buf, strlen(buf));
+
+    webui_stats_t web;
+    webui_get_stats(&web);
+    snprintf(buf, sizeof(buf),
+             "\"web\":{\"requests\":%u,\"gzip\":%u,\"not_found\":%u,\"bytes\":%u},",
+             web.requests, web.gzip, web.not_found, web.bytes);
+    httpd_resp_send_chunk(req, buf, strlen(buf));
+
+    // Байты, переданные каждому дисплею: неизменный кадр шину не занимает
+    httpd_resp_send_chunk(req, "\"displays\":[", 12);
+    for (size_t i = 0; i < DISPLAY_COUNT; i++) {
+        const display_t *display = &displays[i];
+        snprintf(buf, sizeof(buf),
+                 "%s{\"addr\":%u,\"size\":\"%ux%u\",\"role\":\"%s\",\"ready\":%s,\"bytes\":%u}",
+                 i ? "," : "", display->config.addr, display->config.cols, display->config.rows,
+                 display->role == DISPLAY_ALARM ? "alarm" : "main",
+                 display->ready ? "true" : "false", display->lcd.bytes_written);
+        httpd_resp_send_chunk(req, buf, strlen(buf));
+    }
+    httpd_resp_send_chunk(req, "],", 2);
+
+    mqtt_uplink_stats_t mqtt;
+    beacon_stats_t beacon;
+    mqtt_uplink_get_stats(&mqtt);
+    beacon_get_stats(&beacon);
+    snprintf(buf, sizeof(buf),
+             "\"telemetry\":{\"transport\":\"%s\",\"pending\":%u,\"dropped\":%u},"
+             "\"mqtt\":{\"connected\":%s,\"connects\":%u,\"published\":%u,\"acked\":%u,"
+             "\"expired\":%u,\"window_full\":%u,\"in_flight\":%u,\"commands\":%u},"
+             "\"beacon\":{\"enabled\":%s,\"sent\":%u,\"errors\":%u},",
+             app_config.mqtt_uri[0] ? "mqtt" : server_tls ? "https" : "http", telemetry_batch.count, telemetry_batch.dropped,
+             mqtt.connected ? "true" : "false", mqtt.connects, mqtt.published, mqtt.acked,
+             mqtt.expired, mqtt.window_full, mqtt.in_flight, mqtt.commands,
+             beacon.enabled ? "true" : "false", beacon.sent, beacon.errors);
+    httpd_resp_send_chunk(req, buf, strlen(buf));
+
+    // Рукопожатия TLS: полные и возобновленные отдельно, пик кучи при подключении
+    tls_uplink_stats_t tls;
+    tls_uplink_get_stats(&tls);
+    snprintf(buf, sizeof(buf),
+             "\"tls\":{\"enabled\":%s,\"connected\":%s,\"requests\":%u,\"reused\":%u,"
+             "\"connects\":%u,\"offered\":%u,\"resumed\":%u,\"failures\":%u,"
+             "\"heap_last\":%u,\"heap_peak\":%u,\"full_ms\":{\"p50\":%u,\"max\":%u},"
+             "\"resumed_ms\":{\"p50\":%u,\"max\":%u}},",
+             server_tls ? "true" : "false", tls.connected ? "true" : "false", tls.requests,
+             tls.reused, tls.connects, tls.offered, tls.resumed, tls.failures, tls.heap_last,
+             tls.heap_peak, latency_percentile(&tls.full_ms, 50), tls.full_ms.max_us,
+             latency_percentile(&tls.resumed_ms, 50), tls.resumed_ms.max_us);
+    httpd_resp_send_chunk(req, buf, strlen(buf));
+
+    memory_stats_json(buf, sizeof(buf));
+    httpd_resp_send_chunk(req, buf, strlen(buf));
+
+    // Доля CPU задач (промилле) с момента старта или /trace?clear=1
+    int task_count = trace_get_tasks(trace_tasks);
+    uint64_t cycles = 0;
+    for (int i = 0; i < task_count; i++) {
+        cycles += trace_tasks[i].cycles;
+    }
+    snprintf(buf, sizeof(buf), "\"cpu\":{\"window_ms\":%u,\"tasks\":{",
+             (uint32_t)(cycles / (TRACE_CPU_HZ / 1000)));
+    httpd_resp_send_chunk(req, buf, strlen(buf));
+    for (int i = 0; i < task_count; i++) {
+        snprintf(buf, sizeof(buf), "%s\"%s\":{\"permille\":%u,\"switches\":%u}",
+                 i ? "," : "", trace_tasks[i].name,
+                 cycles ? (uint32_t)(trace_tasks[i].cycles * 1000 / cycles) : 0,
+                 trace_tasks[i].switches);
+        httpd_resp_send_chunk(req, buf, strlen(buf));
+    }
+    httpd_resp_send_chunk(req, "}},", 3);
+
+    wifi_link_get_stats(&wifi);
+    snprintf(buf, sizeof(buf),
+             "\"wifi\":{\"state\":%d,\"channel\":%u,\"cached\":%s,\"attempt\":%u,\"down_ms\":%u,"
+             "\"last_reason\":%u,\"boot_connect_ms\":%u,\"reconnects\":%u,\"fast_connects\":%u,"
+             "\"failed_attempts\":%u,\"reconnect_ms\":{\"last\":%u,\"avg\":%u,\"max\":%u}},"
+             "\"handlers\":{",
+             wifi.state, wifi.channel, wifi.cache_valid ? "true" : "false", wifi.attempt,
+             wifi.down_ms, wifi.last_reason, wifi.boot_connect_ms, wifi.reconnects,
+             wifi.fast_connects, wifi.failed_attempts, wifi.last_reconnect_ms,
+             wifi.avg_reconnect_ms, wifi.max_reconnect_ms);
+    httpd_resp_send_chunk(req, buf, strlen(buf));
+
+    for (size_t i = 0; i < HTTP_ROUTE_COUNT; i++) {
+        const http_route_t *route = &http_routes[i];
+        snprintf(buf, sizeof(buf),
+                 "%s\"%s %s\":{\"count\":%u,\"p50_us\":%u,\"p99_us\":%u,\"max_us\":%u}",
+                 i ? "," : "", route->method == HTTP_GET ? "GET" :
+                 route->method == HTTP_PATCH ? "PATCH" : "POST", route->uri,
+                 route->latency.count, latency_percentile(&route->latency, 50),
+                 latency_percentile(&route->latency, 99), route->latency.max_us);
+        httpd_resp_send_chunk(req, buf, strlen(buf));
+    }
+
+    httpd_resp_send_chunk(req, "}}", 2);
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
 // Запуск веб-сервера
 static httpd_handle_t start_webserver(void)
 {
     httpd_handle_t server = NULL;
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-    config.max_uri_handlers = 8;
+    config.max_uri_handlers = HTTP_ROUTE_COUNT;
+    config.uri_match_fn = httpd_uri_match_wildcard;
+    // Медленный клиент не должен надолго занимать единственную задачу httpd
+    config.recv_wait_timeout = 2;
+    config.send_wait_timeout = 2;
 
     if (httpd_start(&server, &config) == ESP_OK) {
-        httpd_uri_t data = {
-            .uri       = "/getData",
-            .method    = HTTP_GET,
-            .handler   = data_handler,
-            .user_ctx  = NULL
-        };
-        
-        httpd_uri_t set_mode = {
-            .uri       = "/setMode",
-            .method    = HTTP_POST,
-            .handler   = set_mode_handler,
-            .user_ctx  = NULL
-        };
-        
-        httpd_uri_t set_lcd = {
-            .uri       = "/setLCD",
-            .method    = HTTP_POST,
-            .handler   = set_lcd_handler,
-            .user_ctx  = NULL
-        };
-        
-        httpd_uri_t set_led = {
-            .uri       = "/setLED",
-            .method    = HTTP_POST,
-            .handler   = set_led_handler,
-            .user_ctx  = NULL
-        };
-        
-        httpd_register_uri_handler(server, &data);
-        httpd_register_uri_handler(server, &set_mode);
-        httpd_register_uri_handler(server, &set_lcd);
-        httpd_register_uri_handler(server, &set_led);
+        for (size_t i = 0; i < HTTP_ROUTE_COUNT; i++) {
+            httpd_uri_t uri = {
+                .uri       = http_routes[i].uri,
+                .method    = http_routes[i].method,
+                .handler   = timed_handler,
+                .user_ctx  = &http_routes[i]
+            };
+            httpd_register_uri_handler(server, &uri);
+        }
         
         return server;
     }
@@ -374,64 +1316,265 @@ static httpd_handle_t start_webserver(void)
     return NULL;
 }
 
-// Задача чтения сенсоров
+// Время для health_poll; измерение и восстановление - components/sensor_poll
+static int64_t sensor_poll_now(void *ctx)
+{
+    return esp_timer_get_time();
+}
+
+static const health_policy_t sensor_policy = {
+    .attempts = SENSOR_ATTEMPTS,
+    .budget_ms = SENSOR_BUDGET_MS,
+    .failed_every = SENSOR_FAILED_RETRY_SLOTS,
+};
+
+// Задача чтения сенсоров. Измерение запускается по расписанию (forced mode),
+// на время преобразования задача уступает CPU и шину, затем забирает результат.
 static void sensor_task(void *pvParameters)
 {
-    TickType_t xLastWakeTime = xTaskGetTickCount();
-    const TickType_t xFrequency = pdMS_TO_TICKS(5000);
+    uint32_t period_ms = app_config.sensor_ms;
+    TickType_t period = pdMS_TO_TICKS(period_ms);
+    int avg_window = app_config.avg_count;
+    TickType_t next = xTaskGetTickCount();
+    int64_t origin = esp_timer_get_time();
+    uint32_t slot = 0;
+    const health_ops_t ops = {
+        .measure = sensor_poll_measure,
+        .recover = sensor_poll_recover,
+        .now_us = sensor_poll_now,
+        .ctx = &sensor_poll,
+    };
     
     while (1) {
-        float temp, hum, press;
-        if (bme280_read(&temp, &hum, &press) == ESP_OK) {
-            sensor_data.temperature = update_average(&temp_avg, temp);
-            sensor_data.humidity = update_average(&hum_avg, hum);
-            sensor_data.pressure = update_average(&press_avg, press);
+        int64_t started = esp_timer_get_time();
+
+        // Новый период из /config: расписание отсчитывается заново от этого цикла
+        if (app_config.sensor_ms != period_ms) {
+            period_ms = app_config.sensor_ms;
+            period = pdMS_TO_TICKS(period_ms);
+            origin = started;
+            slot = 0;
+            next = xTaskGetTickCount();
+        }
+        // Новое окно среднего: накопленные значения начинаются заново
+        if ((int)app_config.avg_count != avg_window) {
+            avg_window = app_config.avg_count;
+            memset(&temp_avg, 0, sizeof(temp_avg));
+            memset(&hum_avg, 0, sizeof(hum_avg));
+            memset(&press_avg, 0, sizeof(press_avg));
+        }
+
+        int64_t jitter = started - (origin + (int64_t)slot * period_ms * 1000);
+        latency_record(&sensor_jitter, (uint32_t)(jitter < 0 ? -jitter : jitter));
+
+        // Повтор с восстановлением начинается, только если бюджет цикла не исчерпан;
+        // отказавший датчик не занимает шину восстановлением каждый цикл
+        health_state_t health = sensor_health.state;
+        esp_err_t ret = health_poll(&sensor_health, &sensor_policy, &ops, slot);
+        uint32_t latency = (uint32_t)(esp_timer_get_time() - started);
+        float temp = sensor_poll.temp, hum = sensor_poll.hum, press = sensor_poll.press;
+
+        if (sensor_health.state != health) {
+            DLOGW(TAG, "Sensor health: %s", health_name(sensor_health.state));
+        }
+
+        if (ret == ESP_OK) {
+            latency_record(&sensor_latency, latency);
+            sensor_data.temperature = update_average(&temp_avg, temp, avg_window);
+            sensor_data.humidity = update_average(&hum_avg, hum, avg_window);
+            sensor_data.pressure = update_average(&press_avg, press, avg_window);
+            sensor_data.acquired_us = started;
+            sensor_data.latency_us = latency;
+
+            // Производные величины считаются один раз на измерение, в целых числах
+            uint32_t cycles = trace_cycles();
+            derived_compute((int32_t)(sensor_data.temperature * 100),
+                            (int32_t)(sensor_data.humidity * 100),
+                            (int32_t)(sensor_data.pressure * 100),
+                            app_config.altitude, &sensor_data.derived);
+            derived_cycles_last = trace_cycles() - cycles;
+            if (derived_cycles_last > derived_cycles_max) {
+                derived_cycles_max = derived_cycles_last;
+            }
+            derived_cycles_total += derived_cycles_last;
+            derived_count++;
+
+            // В сводки идут сами измерения, без скользящего среднего
+            const float values[TELEMETRY_CHANNELS] = { temp, hum, press };
+            uint32_t now_s = (uint32_t)(started / 1000000);
+            for (int w = 0; w < SUMMARY_WINDOWS; w++) {
+                for (int c = 0; c < TELEMETRY_CHANNELS; c++) {
+                    summary_window_add(&summary_windows[w][c], now_s, values[c]);
+                }
+            }
             
-            ESP_LOGI(TAG, "T=%.1f°C, H=%.1f%%, P=%.1fhPa", 
+            DLOGI(TAG, "T=%.1f°C, H=%.1f%%, P=%.1fhPa",
                      sensor_data.temperature, sensor_data.humidity, sensor_data.pressure);
         } else {
-            ESP_LOGE(TAG, "Failed to read BME280");
+            sensor_errors++;
+            DLOGE(TAG, "Failed to read BME280: %s", esp_err_to_name(ret));
         }
-        
-        vTaskDelayUntil(&xLastWakeTime, xFrequency);
+
+        // Следующий запуск - по расписанию от первого, а не от конца этого цикла.
+        // Если цикл затянулся (ошибки шины), пропущенные слоты не догоняются.
+        next += period;
+        slot++;
+        TickType_t now = xTaskGetTickCount();
+        if ((int32_t)(now - next) >= 0) {
+            uint32_t missed = (now - next) / period + 1;
+            next += missed * period;
+            slot += missed;
+            sensor_skipped += missed;
+        }
+        vTaskDelay(next - now);
+    }
+}
+
+// Раскладка полей по строкам дисплея: если строк хватает - по полю на строку,
+// иначе поля идут подряд через пробел. Не поместившиеся в конце отбрасываются,
+// поэтому поля перечисляются по убыванию важности.
+static void lcd_layout(const lcd_t *lcd, lcd_frame_t frame, char fields[][LCD_MAX_COLS + 1], int count)
+{
+    int cols = lcd->config.cols;
+    int rows = lcd->config.rows;
+    int row = 0;
+
+    for (int i = 0; i < count; i++) {
+        int len = MIN((int)strlen(fields[i]), cols);
+        int used = strlen(frame[row]);
+        if (used > 0 && (count <= rows || used + 1 + len > cols)) {
+            if (++row == rows) break;
+            used = 0;
+        }
+        snprintf(frame[row] + used, LCD_MAX_COLS + 1 - used, "%s%.*s",
+                 used ? " " : "", len, fields[i]);
     }
 }
 
-// Задача обновления LCD
+// Кадр для текущего режима отображения с учетом размера дисплея
+static void lcd_render_mode(const lcd_t *lcd, lcd_frame_t frame)
+{
+    char fields[4][LCD_MAX_COLS + 1];
+
+    switch (lcd_mode) {
+        case '0':
+            snprintf(fields[0], sizeof(fields[0]), "T=%.1fC", sensor_data.temperature);
+            snprintf(fields[1], sizeof(fields[1]), "H=%.1f%%", sensor_data.humidity);
+            snprintf(fields[2], sizeof(fields[2]), "P=%.1fhPa", sensor_data.pressure);
+            snprintf(fields[3], sizeof(fields[3]), "Td=%.1fC", sensor_data.derived.dew_point / 100.0f);
+            lcd_layout(lcd, frame, fields, 4);
+            break;
+        case '1':
+            memcpy(frame, lcd_text, sizeof(lcd_text));
+            break;
+        case '2':
+            strcpy(fields[0], "IP Address:");
+            copy_lcd_line(fields[1], current_ip);
+            snprintf(fields[2], sizeof(fields[2]), "RSSI=%ddBm", current_rssi);
+            copy_lcd_line(fields[3], current_mac);
+            lcd_layout(lcd, frame, fields, 4);
+            break;
+        case '3':
+            snprintf(fields[0], sizeof(fields[0]), "Td=%.1f", sensor_data.derived.dew_point / 100.0f);
+            snprintf(fields[1], sizeof(fields[1]), "AH=%.1f", sensor_data.derived.abs_humidity / 1000.0f);
+            snprintf(fields[2], sizeof(fields[2]), "HI=%.1f", sensor_data.derived.heat_index / 100.0f);
+            snprintf(fields[3], sizeof(fields[3]), "P0=%.0f",
+                     sensor_data.derived.sea_level_pressure / 100.0f);
+            lcd_layout(lcd, frame, fields, 4);
+            break;
+    }
+}
+
+// Задача обновления LCD: единственный владелец дисплеев и их состояния.
+// Команды приходят через control_queue; драйвер передает по шине только
+// изменившиеся символы, поэтому дисплей с прежним кадром шину не занимает.
 static void lcd_task(void *pvParameters)
 {
-    char buf[32];
-    TickType_t xLastWakeTime = xTaskGetTickCount();
+    lcd_frame_t frame;
+    int step = -1;
+    int repeats_left = 0;
+    uint32_t generation = 0;
+    uint32_t last_id = 0;
+    TickType_t step_deadline = 0;
+    control_batch_t batch;
     const TickType_t xFrequency = pdMS_TO_TICKS(2000);
     
     while (1) {
-        switch(lcd_mode) {
-            case '0':
-                lcd_clear();
-                lcd_set_cursor(0, 0);
-                snprintf(buf, sizeof(buf), "T=%.1fC H=%.1f%%", sensor_data.temperature, sensor_data.humidity);
-                lcd_print(buf);
-                lcd_set_cursor(0, 1);
-                snprintf(buf, sizeof(buf), "P=%.1fhPa", sensor_data.pressure);
-                lcd_print(buf);
-                break;
-            case '1':
-                lcd_clear();
-                lcd_set_cursor(0, 0);
-                lcd_print(lcd_string1);
-                lcd_set_cursor(0, 1);
-                lcd_print(lcd_string2);
-                break;
-            case '2':
-                lcd_clear();
-                lcd_set_cursor(0, 0);
-                lcd_print("IP Address:");
-                lcd_set_cursor(0, 1);
-                lcd_print(current_ip);
-                break;
+        TickType_t now = xTaskGetTickCount();
+        TickType_t wait = xFrequency;
+
+        if (generation != script_generation) {
+            // Новый сценарий заменяет текущий
+            generation = script_generation;
+            step = (script_len > 0) ? 0 : -1;
+            repeats_left = script_repeat;
+            if (step >= 0) {
+                step_deadline = now + pdMS_TO_TICKS(script_steps[0].hold_ms);
+            }
+        } else if (step >= 0 && (int32_t)(now - step_deadline) >= 0) {
+            if (++step == script_len) {
+                step = 0;
+                if (repeats_left > 0 && --repeats_left == 0) {
+                    step = -1;
+                }
+            }
+            if (step >= 0) {
+                step_deadline = now + pdMS_TO_TICKS(script_steps[step].hold_ms);
+            }
         }
+
+        const script_step_t *playing = (step >= 0) ? &script_steps[step] : NULL;
+        if (playing) {
+            wait = step_deadline - now;
+        }
+
+        esp_err_t err = ESP_OK;
+        for (size_t i = 0; i < DISPLAY_COUNT; i++) {
+            display_t *display = &displays[i];
+            bool backlight = lcd_backlight;
+            if (!display->ready) continue;
+
+            // Дисплей тревог без сценария остается пустым
+            memset(frame, 0, sizeof(frame));
+            if (playing && display->role == script_role) {
+                memcpy(frame, playing->line, sizeof(frame));
+                if (playing->backlight >= 0) {
+                    backlight = playing->backlight;
+                }
+            } else if (display->role == DISPLAY_MAIN) {
+                lcd_render_mode(&display->lcd, frame);
+            }
+
+            for (int row = 0; row < display->lcd.config.rows; row++) {
+                esp_err_t ret = lcd_write_row(&display->lcd, row, frame[row]);
+                if (ret != ESP_OK) {
+                    err = ret;
+                }
+            }
+
+            if (backlight != display->backlight_shown) {
+                esp_err_t ret = lcd_set_backlight(&display->lcd, backlight);
+                if (ret == ESP_OK) {
+                    display->backlight_shown = backlight;
+                } else {
+                    err = ret;
+                }
+            }
+        }
+
+        // Результат отрисовки относится ко всем пакетам, примененным перед ней
+        for (uint32_t id = control_applied_id + 1; id <= last_id; id++) {
+            control_results[id % CONTROL_RESULTS].err = err;
+        }
+        control_applied_id = last_id;
         
-        vTaskDelayUntil(&xLastWakeTime, xFrequency);
+        // Пробуждение по таймеру или по новому пакету; все ожидающие пакеты применяются разом
+        if (xQueueReceive(control_queue, &batch, wait) == pdTRUE) {
+            do {
+                control_apply(&batch);
+                last_id = batch.id;
+            } while (xQueueReceive(control_queue, &batch, 0) == pdTRUE);
+        }
     }
 }
 
@@ -439,14 +1582,46 @@ static void lcd_task(void *pvParameters)
 static void server_task(void *pvParameters)
 {
     TickType_t xLastWakeTime = xTaskGetTickCount();
-    const TickType_t xFrequency = pdMS_TO_TICKS(60000);
+    uint32_t since_publish = 0;
     
     while (1) {
+        // Периоды перечитываются каждый цикл: /config меняет их на ходу
+        uint32_t sample_ms = app_config.sample_ms;
+
+        // Измерения копятся в буфере и уходят пакетом раз в app_config.publish_ms
+        telemetry_sample_t sample = {
+            .uptime_s = (uint32_t)(sensor_data.acquired_us / 1000000),
+            .temperature = sensor_data.temperature,
+            .humidity = sensor_data.humidity,
+            .pressure = sensor_data.pressure,
+            .derived = sensor_data.derived,
+            .health = sensor_health.state,
+        };
+        telemetry_batch_push(&telemetry_batch, &sample);
         if (xEventGroupGetBits(s_wifi_event_group) & WIFI_CONNECTED_BIT) {
-            send_data_to_server();
+            trace_begin(TRACE_UPLINK, TRACE_UPLINK_BEACON);
+            beacon_send(&sample, current_rssi, sample_ms / 1000);
+            trace_end(TRACE_UPLINK, TRACE_UPLINK_BEACON);
+        }
+
+        since_publish += sample_ms;
+        if (since_publish >= app_config.publish_ms &&
+            (xEventGroupGetBits(s_wifi_event_group) & WIFI_CONNECTED_BIT)) {
+            since_publish = 0;
+            // Сеть доступна - обновленный образ работоспособен
+            ota_mark_healthy();
+            if (app_config.mqtt_uri[0]) {
+                trace_begin(TRACE_UPLINK, TRACE_UPLINK_MQTT);
+                publish_telemetry();
+                trace_end(TRACE_UPLINK, TRACE_UPLINK_MQTT);
+            } else if (app_config.server_url[0]) {
+                trace_begin(TRACE_UPLINK, TRACE_UPLINK_HTTP);
+                send_data_to_server();
+                trace_end(TRACE_UPLINK, TRACE_UPLINK_HTTP);
+            }
         }
         
-        vTaskDelayUntil(&xLastWakeTime, xFrequency);
+        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(sample_ms));
     }
 }
 
@@ -466,7 +1641,7 @@ static void IRAM_ATTR button_isr_handler(void* arg)
 static void button_task(void *pvParameters)
 {
     gpio_config_t io_conf = {
-        .pin_bit_mask = (1ULL << BUTTON_1_GPIO) | (1ULL << BUTTON_2_GPIO),
+        .pin_bit_mask = (1ULL << app_config.button1_io) | (1ULL << app_config.button2_io),
         .mode = GPIO_MODE_INPUT,
         .pull_up_en = GPIO_PULLUP_ENABLE,
         .pull_down_en = GPIO_PULLDOWN_DISABLE,
@@ -475,35 +1650,127 @@ static void button_task(void *pvParameters)
     gpio_config(&io_conf);
     
     gpio_install_isr_service(0);
-    gpio_isr_handler_add(BUTTON_1_GPIO, button_isr_handler, &button1_state);
-    gpio_isr_handler_add(BUTTON_2_GPIO, button_isr_handler, &button2_state);
+    gpio_isr_handler_add(app_config.button1_io, button_isr_handler, &button1_state);
+    gpio_isr_handler_add(app_config.button2_io, button_isr_handler, &button2_state);
     
     while (1) {
         if (button1_state.is_pressed) {
-            lcd_mode = (lcd_mode == '2') ? '0' : (lcd_mode + 1);
+            control_batch_t batch = {.next_mode = true};
+            control_submit(&batch);
             button1_state.is_pressed = false;
-            ESP_LOGI(TAG, "Button 1 pressed, LCD mode: %c", lcd_mode);
+            DLOGI(TAG, "Button 1 pressed, next LCD mode");
         }
         
         if (button2_state.is_pressed) {
-            lcd_backlight = !lcd_backlight;
-            if (lcd_backlight) {
-                lcd_backlight_on();
-            } else {
-                lcd_backlight_off();
-            }
+            control_batch_t batch = {.toggle_backlight = true};
+            control_submit(&batch);
             button2_state.is_pressed = false;
-            ESP_LOGI(TAG, "Button 2 pressed, backlight: %s", lcd_backlight ? "ON" : "OFF");
+            DLOGI(TAG, "Button 2 pressed, toggle backlight");
         }
         
         vTaskDelay(pdMS_TO_TICKS(50));
     }
 }
 
+// Задачи приложения. Размер стека = (глубина своего кода по -fstack-usage +
+// оценка вызовов SDK) x 1.25, с округлением вверх до 512 байт. Своя глубина:
+// lcd 976 (lcd_write_row -> lcd_write_byte -> dlog_write), server 1408
+// (send_data_to_server -> tls_uplink_post -> dlog_write), button 528. Оценка
+// SDK: printf с плавающей точкой 1024, драйвер I2C 256, рукопожатие mbedTLS 4096.
+// sensor_task оставлен с прежним запасом 4096: -fstack-usage не проходит через
+// указатели health_ops_t, а восстановление (health_poll -> sensor_poll_recover ->
+// i2c_bus_recover с переустановкой драйвера, затем bme280_init с ESP_LOGx)
+// глубже цепочки измерения. Уменьшать только по stack_free, измеренному на
+// устройстве после сбоев шины. Сверять с stack_free в /getStats: при запасе
+// меньше 512 байт стек увеличить
+#define SENSOR_TASK_STACK   4096
+#define LCD_TASK_STACK      3072
+#define SERVER_TASK_STACK   7168
+#define BUTTON_TASK_STACK   2048
+
+typedef struct {
+    const char *name;
+    TaskFunction_t fn;
+    uint32_t stack_size;
+    UBaseType_t priority;
+    StackType_t *stack;
+    StaticTask_t *tcb;
+    TaskHandle_t handle;
+} app_task_t;
+
+static StackType_t sensor_stack[SENSOR_TASK_STACK];
+static StackType_t lcd_stack[LCD_TASK_STACK];
+static StackType_t server_stack[SERVER_TASK_STACK];
+static StackType_t button_stack[BUTTON_TASK_STACK];
+static StaticTask_t task_tcbs[4];
+
+static app_task_t app_tasks[] = {
+    { "sensor_task", sensor_task, SENSOR_TASK_STACK, 5, sensor_stack, &task_tcbs[0] },
+    { "lcd_task",    lcd_task,    LCD_TASK_STACK,    4, lcd_stack,    &task_tcbs[1] },
+    { "server_task", server_task, SERVER_TASK_STACK, 3, server_stack, &task_tcbs[2] },
+    { "button_task", button_task, BUTTON_TASK_STACK, 2, button_stack, &task_tcbs[3] },
+};
+#define APP_TASK_COUNT (sizeof(app_tasks) / sizeof(app_tasks[0]))
+
+// Запас стека задачи в байтах (глубина стека считается в StackType_t)
+static uint32_t stack_free_bytes(TaskHandle_t task)
+{
+    return (uint32_t)uxTaskGetStackHighWaterMark(task) * sizeof(StackType_t);
+}
+
+// Наибольший свободный блок. Аллокатор SDK размер блока не сообщает, поэтому
+// проба идет двоичным поиском через malloc: не чаще раза в минуту и с запасом
+// кучи, который остается свободным для выделений Wi-Fi из прерываний
+#define HEAP_PROBE_PERIOD_US    (60 * 1000000LL)
+#define HEAP_PROBE_RESERVE      4096
+
+static uint32_t heap_largest_block;
+static int64_t heap_probe_at_us;
+static bool heap_probed;
+
+static uint32_t largest_free_block(void)
+{
+    int64_t now = esp_timer_get_time();
+    if (heap_probed && now - heap_probe_at_us < HEAP_PROBE_PERIOD_US) {
+        return heap_largest_block;
+    }
+    // Пока идет проба, другие задачи не должны получить отказ в malloc
+    vTaskSuspendAll();
+    uint32_t limit = esp_get_free_heap_size();
+    limit = limit > HEAP_PROBE_RESERVE ? limit - HEAP_PROBE_RESERVE : 0;
+    heap_largest_block = (uint32_t)metrics_largest_free_block(limit);
+    xTaskResumeAll();
+    heap_probe_at_us = now;
+    heap_probed = true;
+    return heap_largest_block;
+}
+
+// Память: свободная куча, исторический минимум, наибольший блок и запас стеков задач
+static int memory_stats_json(char *buf, size_t len)
+{
+    uint32_t free_heap = esp_get_free_heap_size();
+    uint32_t largest = largest_free_block();
+
+    int pos = snprintf(buf, len,
+                       "\"memory\":{\"free_heap\":%u,\"min_free_heap\":%u,\"largest_block\":%u,"
+                       "\"stack_free\":{\"httpd\":%u",
+                       free_heap, esp_get_minimum_free_heap_size(),
+                       largest,
+                       stack_free_bytes(NULL));
+    for (size_t i = 0; i < APP_TASK_COUNT && pos > 0 && (size_t)pos < len; i++) {
+        pos += snprintf(buf + pos, len - pos, ",\"%s\":%u", app_tasks[i].name,
+                        app_tasks[i].handle ? stack_free_bytes(app_tasks[i].handle) : 0);
+    }
+    if (pos > 0 && (size_t)pos < len) {
+        pos += snprintf(buf + pos, len - pos, "}},");
+    }
+    return pos;
+}
+
 // Инициализация WiFi
 static void wifi_init_sta(void)
 {
-    s_wifi_event_group = xEventGroupCreate();
+    s_wifi_event_group = xEventGroupCreateStatic(&s_wifi_event_group_buf);
 
     tcpip_adapter_init();
     ESP_ERROR_CHECK(esp_event_loop_create_default());
@@ -511,16 +1778,17 @@ static void wifi_init_sta(void)
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
     ESP_ERROR_CHECK(esp_wifi_init(&cfg));
 
-    ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &event_handler, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &event_handler, NULL));
     ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &event_handler, NULL));
 
     wifi_config_t wifi_config = {
         .sta = {
-            .ssid = WIFI_SSID,
-            .password = WIFI_PASS,
             .threshold.authmode = WIFI_AUTH_WPA2_PSK,
         },
     };
+    // Поля драйвера без завершающего нуля при максимальной длине
+    strncpy((char *)wifi_config.sta.ssid, app_config.wifi_ssid, sizeof(wifi_config.sta.ssid));
+    strncpy((char *)wifi_config.sta.password, app_config.wifi_pass, sizeof(wifi_config.sta.password));
 
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_APSTA));
     ESP_ERROR_CHECK(esp_wifi_set_config(ESP_IF_WIFI_STA, &wifi_config));
@@ -528,14 +1796,17 @@ static void wifi_init_sta(void)
     // Настройка AP
     wifi_config_t ap_config = {
         .ap = {
-            .ssid = AP_SSID,
-            .ssid_len = strlen(AP_SSID),
-            .password = AP_PASS,
+            .ssid_len = strlen(app_config.ap_ssid),
             .max_connection = AP_MAX_CONN,
             .authmode = WIFI_AUTH_WPA_WPA2_PSK
         },
     };
+    strncpy((char *)ap_config.ap.ssid, app_config.ap_ssid, sizeof(ap_config.ap.ssid));
+    strncpy((char *)ap_config.ap.password, app_config.ap_pass, sizeof(ap_config.ap.password));
     ESP_ERROR_CHECK(esp_wifi_set_config(ESP_IF_WIFI_AP, &ap_config));
+
+    // Переподключение с экспоненциальной задержкой и быстрым путем по кэшу BSSID/канала
+    ESP_ERROR_CHECK(wifi_link_init());
     
     ESP_ERROR_CHECK(esp_wifi_start());
 
@@ -544,6 +1815,14 @@ static void wifi_init_sta(void)
 
 void app_main(void)
 {
+    // Признак образа: записи журнала прошлой загрузки читаются только той же прошивкой
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    uint32_t image_tag = (uint32_t)(uintptr_t)&app_main ^ (running ? running->address : 0);
+    for (const char *p = __DATE__ " " __TIME__; *p; p++) {
+        image_tag = image_tag * 31 + (uint8_t)*p;
+    }
+    dlog_init(image_tag);
+
     ESP_LOGI(TAG, "Starting Hydra-L firmware");
     
     // Инициализация NVS
@@ -556,21 +1835,8 @@ void app_main(void)
     ESP_ERROR_CHECK(ret);
     ESP_LOGI(TAG, "NVS initialized successfully");
 
-    // Инициализация I2C
-    ESP_ERROR_CHECK(i2c_master_init());
-    ESP_LOGI(TAG, "I2C initialized successfully");
-
-    // Инициализация LCD
-    ESP_ERROR_CHECK(lcd_init());
-    lcd_clear();
-    lcd_set_cursor(0, 0);
-    lcd_print("Hydra-L v2.0");
-    lcd_set_cursor(0, 1);
-    lcd_print("Starting...");
-
-    // Инициализация BME280
-    ESP_ERROR_CHECK(bme280_init());
-    ESP_LOGI(TAG, "BME280 initialized successfully");
+    // Проверка необходимости отката после OTA обновления
+    ota_check_rollback();
 
     // Инициализация SPIFFS
     esp_vfs_spiffs_conf_t conf = {
@@ -586,17 +1852,92 @@ void app_main(void)
         ESP_LOGI(TAG, "SPIFFS initialized successfully");
     }
 
-    // Загрузка конфигурации
-    load_config();
+    // Настройки из NVS; при первом запуске переносится config.txt (нужен SPIFFS)
+    config_store_load(&app_config_defaults, &app_config);
+
+    // Инициализация I2C
+    i2c_bus_config.sda_io = app_config.sda_io;
+    i2c_bus_config.scl_io = app_config.scl_io;
+    ESP_ERROR_CHECK(i2c_bus_init(&i2c_bus_config));
+    ESP_LOGI(TAG, "I2C initialized successfully");
+
+    // Инициализация дисплеев: отсутствующий дисплей не мешает остальным
+    for (size_t i = 0; i < DISPLAY_COUNT; i++) {
+        display_t *display = &displays[i];
+        esp_err_t ret = lcd_init(&display->lcd, &display->config);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "LCD 0x%02x not available: %s", display->config.addr, esp_err_to_name(ret));
+            continue;
+        }
+        display->ready = true;
+        display->backlight_shown = true;
+        if (display->role == DISPLAY_ALARM) {
+            script_role = DISPLAY_ALARM;
+        }
+        lcd_write_row(&display->lcd, 0, "Hydra-L v2.0");
+        if (display->config.rows > 1) {
+            lcd_write_row(&display->lcd, 1, "Starting...");
+        }
+    }
+
+    // Инициализация BME280: без датчика устройство работает, sensor_task
+    // будет пытаться его восстановить
+    if (sensor_poll_init(&sensor_poll) == ESP_OK) {
+        ESP_LOGI(TAG, "BME280 initialized successfully");
+    } else {
+        health_record(&sensor_health, false);
+    }
+
+    const uint32_t summary_periods[SUMMARY_WINDOWS] = { app_config.stats_short_s, app_config.stats_long_s };
+    for (int w = 0; w < SUMMARY_WINDOWS; w++) {
+        for (int c = 0; c < TELEMETRY_CHANNELS; c++) {
+            summary_window_init(&summary_windows[w][c], summary_periods[w],
+                                (uint32_t)(esp_timer_get_time() / 1000000));
+        }
+    }
+
+    // HTTPS без CA не включается и не заменяется на HTTP: Akey не уходит открытым текстом
+    if (strncmp(app_config.server_url, "https://", 8) == 0) {
+        if (tls_uplink_init(app_config.server_url, SERVER_CA_PATH) == ESP_OK) {
+            server_tls = true;
+        } else {
+            ESP_LOGE(TAG, "HTTPS uplink disabled");
+            app_config.server_url[0] = '\0';
+        }
+    }
 
     // Инициализация WiFi
     wifi_init_sta();
 
-    // Создание задач
-    xTaskCreate(sensor_task, "sensor_task", 4096, NULL, 5, NULL);
-    xTaskCreate(lcd_task, "lcd_task", 2048, NULL, 4, NULL);
-    xTaskCreate(server_task, "server_task", 4096, NULL, 3, NULL);
-    xTaskCreate(button_task, "button_task", 2048, NULL, 2, NULL);
+    // MQTT клиент сам переподключается к брокеру после появления сети
+    if (app_config.mqtt_uri[0]) {
+        ESP_ERROR_CHECK(mqtt_uplink_start(app_config.mqtt_uri, app_config.device_name,
+                                          mqtt_command_handler));
+    }
+
+    // Пассивный сбор шлюзом: UDP маяк и объявление mDNS
+    if (app_config.beacon_uri[0]) {
+        char group[16];
+        uint16_t port;
+        if (beacon_parse_uri(app_config.beacon_uri, group, &port) != ESP_OK ||
+            beacon_start(group, port, app_config.device_name, app_config.akey, 80) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to start beacon %s", app_config.beacon_uri);
+        }
+    }
+
+    // Создание задач: стеки и очередь размещены статически (см. app_tasks)
+    control_queue = xQueueCreateStatic(CONTROL_QUEUE_LEN, sizeof(control_batch_t),
+                                       control_queue_storage, &control_queue_buf);
+    control_lock = xSemaphoreCreateMutexStatic(&control_lock_buf);
+    uint32_t static_stacks = 0;
+    for (size_t i = 0; i < APP_TASK_COUNT; i++) {
+        app_task_t *task = &app_tasks[i];
+        task->handle = xTaskCreateStatic(task->fn, task->name, task->stack_size, NULL,
+                                         task->priority, task->stack, task->tcb);
+        static_stacks += task->stack_size * sizeof(StackType_t);
+    }
+    ESP_LOGI(TAG, "Static RAM: task stacks %u, control queue %u bytes; free heap %u",
+             static_stacks, (uint32_t)sizeof(control_queue_storage), esp_get_free_heap_size());
 
     // Запуск веб-сервера
     httpd_handle_t server = start_webserver();
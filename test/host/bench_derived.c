@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "derived.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+/*
+ * Стоимость derived_compute на хосте: такты (TSC на x86) и наносекунды на
+ * вызов по сетке входных значений. Для ESP8266 это только относительная
+ * оценка при изменении алгоритма; стоимость на устройстве считается по
+ * регистру CCOUNT и выводится в /getStats (объект derived).
+ */
+
+#define ROUNDS  20
+
+static volatile int32_t sink;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t run(void)
+{
+    uint32_t calls = 0;
+    for (int32_t t = -2000; t <= 4500; t += 25) {
+        for (int32_t rh = 500; rh <= 10000; rh += 250) {
+            derived_t d;
+            derived_compute(t, rh, 95000 + rh, 150 + t / 10, &d);
+            sink = d.dew_point + d.abs_humidity + d.heat_index + d.sea_level_pressure;
+            calls++;
+        }
+    }
+    return calls;
+}
+
+int main(void)
+{
+    run();
+
+    uint64_t best_ns = UINT64_MAX;
+#ifdef HAVE_TSC
+    uint64_t best_cycles = UINT64_MAX;
+#endif
+    uint32_t calls = 0;
+    for (int i = 0; i < ROUNDS; i++) {
+        uint64_t ns = now_ns();
+#ifdef HAVE_TSC
+        uint64_t cycles = __rdtsc();
+#endif
+        calls = run();
+#ifdef HAVE_TSC
+        cycles = __rdtsc() - cycles;
+        if (cycles < best_cycles) best_cycles = cycles;
+#endif
+        ns = now_ns() - ns;
+        if (ns < best_ns) best_ns = ns;
+    }
+
+    printf("derived_compute: %u calls, %.1f ns/call", calls, (double)best_ns / calls);
+#ifdef HAVE_TSC
+    printf(", %.0f TSC cycles/call", (double)best_cycles / calls);
+#endif
+    printf("\n");
+    return 0;
+}
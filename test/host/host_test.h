@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdio.h>
+#include <math.h>
+
+/*
+ * Минимальные проверки для тестов на хосте: без сторонних библиотек,
+ * ошибка печатается с файлом и строкой, тест продолжается до конца.
+ * Код возврата main - число неудачных проверок (0 - успех для ctest).
+ */
+
+static int host_test_failures = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            host_test_failures++; \
+        } \
+    } while (0)
+
+#define CHECK_EQ(a, b) do { \
+        long long a_ = (long long)(a), b_ = (long long)(b); \
+        if (a_ != b_) { \
+            fprintf(stderr, "%s:%d: %s == %s failed: %lld != %lld\n", \
+                    __FILE__, __LINE__, #a, #b, a_, b_); \
+            host_test_failures++; \
+        } \
+    } while (0)
+
+#define CHECK_NEAR(a, b, tol) do { \
+        double a_ = (double)(a), b_ = (double)(b); \
+        if (!(fabs(a_ - b_) <= (double)(tol))) { \
+            fprintf(stderr, "%s:%d: |%s - %s| <= %s failed: %g vs %g\n", \
+                    __FILE__, __LINE__, #a, #b, #tol, a_, b_); \
+            host_test_failures++; \
+        } \
+    } while (0)
+
+#define HOST_TEST_DONE() do { \
+        if (host_test_failures) fprintf(stderr, "%d check(s) failed\n", host_test_failures); \
+        else printf("OK\n"); \
+        return host_test_failures ? 1 : 0; \
+    } while (0)
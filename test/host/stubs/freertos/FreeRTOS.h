@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stdint.h>
+
+// Заглушка SDK для тестов на хосте: тик 10 мс, как в sdkconfig прошивки
+typedef uint32_t TickType_t;
+typedef int32_t BaseType_t;
+
+#define configTICK_RATE_HZ      100
+#define portTICK_PERIOD_MS      (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)       ((TickType_t)((uint64_t)(ms) * configTICK_RATE_HZ / 1000))
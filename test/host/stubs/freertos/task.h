@@ -0,0 +1,6 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+// Реализует тест: задержка сдвигает его модельное время
+void vTaskDelay(TickType_t ticks);
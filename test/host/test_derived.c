@@ -0,0 +1,179 @@
+#include <stdint.h>
+#include <math.h>
+#include "host_test.h"
+#include "derived.h"
+
+/*
+ * Целочисленные производные величины (components/derived/derived.c) против
+ * тех же формул в double. Допуски:
+ *   давление насыщенного пара - 5e-4 относительных (интерполяция по таблице
+ *     1 °C) плюс 0.15 Па (шаг таблицы 0.1 Па);
+ *   точка росы - 0.1 °C, ниже -35 °C - 0.2 °C (там 0.1 Па пара - около 0.07 °C);
+ *   абсолютная влажность - 0.075 г/м³;
+ *   индекс жары - 0.1 °C (в полосе 0.05 °F у переключения Стедман/Ротфус -
+ *     до ближайшей из двух формул);
+ *   давление на уровне моря - 2.5e-5 относительных (около 2.5 Па при 1000 гПа)
+ *     для высот -400..3000 м.
+ */
+
+#define MAGNUS_B    17.62
+#define MAGNUS_C    243.12
+
+static double ref_saturation(double t)
+{
+    return 611.2 * exp(MAGNUS_B * t / (MAGNUS_C + t));
+}
+
+static double ref_dew_point(double t, double rh)
+{
+    double g = log(rh / 100.0) + MAGNUS_B * t / (MAGNUS_C + t);
+    return MAGNUS_C * g / (MAGNUS_B - g);
+}
+
+// г/м³
+static double ref_abs_humidity(double t, double rh)
+{
+    return ref_saturation(t) * rh / 100.0 / (461.5 * (t + 273.15)) * 1000.0;
+}
+
+static double ref_steadman_f(double tf, double rh)
+{
+    return 0.5 * (tf + 61.0 + (tf - 68.0) * 1.2 + rh * 0.094);
+}
+
+static double ref_rothfusz_f(double tf, double rh)
+{
+    double hi = -42.379 + 2.04901523 * tf + 10.14333127 * rh
+              - 0.22475541 * tf * rh - 0.00683783 * tf * tf
+              - 0.05481717 * rh * rh + 0.00122874 * tf * tf * rh
+              + 0.00085282 * tf * rh * rh - 0.00000199 * tf * tf * rh * rh;
+    if (rh < 13.0 && tf >= 80.0 && tf <= 112.0) {
+        hi -= (13.0 - rh) / 4.0 * sqrt((17.0 - fabs(tf - 95.0)) / 17.0);
+    } else if (rh > 85.0 && tf >= 80.0 && tf <= 87.0) {
+        hi += (rh - 85.0) / 10.0 * (87.0 - tf) / 5.0;
+    }
+    return hi;
+}
+
+// Величина, по которой NWS выбирает формулу (°F): ниже 80 - Стедман
+static double ref_switch_f(double tf, double rh)
+{
+    return (ref_steadman_f(tf, rh) + tf) / 2.0;
+}
+
+static double f_to_c(double f)
+{
+    return (f - 32.0) * 5.0 / 9.0;
+}
+
+static double ref_sea_level(double t, double p, double h)
+{
+    double tm = t + 273.15 + 0.0065 * h / 2.0;
+    return p * exp(9.80665 * h / (287.05 * tm));
+}
+
+static void test_saturation(void)
+{
+    for (int32_t t = DERIVED_T_MIN * 100; t <= DERIVED_T_MAX * 100; t += 7) {
+        double ref = ref_saturation(t / 100.0);
+        CHECK_NEAR(derived_saturation(t) / 10.0, ref, ref * 5e-4 + 0.15);
+    }
+    // За пределами таблицы значение ограничивается
+    CHECK_EQ(derived_saturation(-5000), derived_saturation(DERIVED_T_MIN * 100));
+    CHECK_EQ(derived_saturation(7000), derived_saturation(DERIVED_T_MAX * 100));
+}
+
+static void test_humidity(void)
+{
+    for (int32_t t = DERIVED_T_MIN * 100; t <= DERIVED_T_MAX * 100; t += 13) {
+        for (int32_t rh = 100; rh <= 10000; rh += 37) {
+            derived_t d;
+            derived_compute(t, rh, 101325, 0, &d);
+            double tc = t / 100.0, h = rh / 100.0;
+            double dew = ref_dew_point(tc, h);
+            // Ниже таблицы точка росы ограничивается -40 °C
+            if (dew > DERIVED_T_MIN) CHECK_NEAR(d.dew_point / 100.0, dew, dew > -35.0 ? 0.1 : 0.2);
+            else CHECK_EQ(d.dew_point, DERIVED_T_MIN * 100);
+            CHECK_NEAR(d.abs_humidity / 1000.0, ref_abs_humidity(tc, h), 0.075);
+        }
+    }
+
+    // Насыщенный воздух: точка росы равна температуре
+    derived_t d;
+    derived_compute(2000, 10000, 101325, 0, &d);
+    CHECK_NEAR(d.dew_point, 2000, 2);
+}
+
+static void test_heat_index(void)
+{
+    for (int32_t t = 0; t <= 5000; t += 3) {
+        for (int32_t rh = 0; rh <= 10000; rh += 29) {
+            derived_t d;
+            derived_compute(t, rh, 101325, 0, &d);
+            double tf = t / 100.0 * 9.0 / 5.0 + 32.0, h = rh / 100.0;
+            double got = d.heat_index / 100.0;
+            double steadman = f_to_c(ref_steadman_f(tf, h));
+            double rothfusz = f_to_c(ref_rothfusz_f(tf, h));
+
+            double sw = ref_switch_f(tf, h);
+            if (fabs(sw - 80.0) < 0.05) {
+                // Округление в 0.01 °F может выбрать любую из формул
+                double err = fmin(fabs(got - steadman), fabs(got - rothfusz));
+                CHECK_NEAR(err, 0.0, 0.1);
+            } else {
+                CHECK_NEAR(got, sw < 80.0 ? steadman : rothfusz, 0.1);
+            }
+        }
+    }
+
+    // Переключение около 26-27 °C: при 50 % ниже порога - Стедман, выше - Ротфус
+    derived_t d;
+    derived_compute(2600, 5000, 101325, 0, &d);
+    CHECK(ref_switch_f(78.8, 50.0) < 80.0);
+    CHECK_NEAR(d.heat_index / 100.0, f_to_c(ref_steadman_f(78.8, 50.0)), 0.1);
+    derived_compute(2750, 5000, 101325, 0, &d);
+    CHECK(ref_switch_f(81.5, 50.0) >= 80.0);
+    CHECK_NEAR(d.heat_index / 100.0, f_to_c(ref_rothfusz_f(81.5, 50.0)), 0.1);
+
+    // Поправка для влажности выше 85 % при 80..87 °F (до 1.2 °C)
+    derived_compute(2700, 10000, 101325, 0, &d);
+    CHECK_NEAR(d.heat_index / 100.0, f_to_c(ref_rothfusz_f(80.6, 100.0)), 0.1);
+    // Поправка для влажности ниже 13 % при 80..112 °F
+    derived_compute(3500, 500, 101325, 0, &d);
+    CHECK_NEAR(d.heat_index / 100.0, f_to_c(ref_rothfusz_f(95.0, 5.0)), 0.1);
+}
+
+static void test_sea_level(void)
+{
+    for (int32_t t = DERIVED_T_MIN * 100; t <= DERIVED_T_MAX * 100; t += 97) {
+        for (int32_t alt = -400; alt <= 3000; alt += 17) {
+            // Давление на станции, соответствующее 870..1085 гПа на уровне моря
+            for (int32_t p0 = 87000; p0 <= 108500; p0 += 2150) {
+                int32_t p = (int32_t)lround(p0 / ref_sea_level(t / 100.0, 1.0, alt));
+                derived_t d;
+                derived_compute(t, 5000, p, alt, &d);
+                double ref = ref_sea_level(t / 100.0, p, alt);
+                CHECK_NEAR(d.sea_level_pressure, ref, ref * 2.5e-5);
+            }
+        }
+    }
+
+    // На уровне моря давление не меняется
+    derived_t d;
+    derived_compute(1500, 5000, 101325, 0, &d);
+    CHECK_EQ(d.sea_level_pressure, 101325);
+    // Высота за пределами диапазона ограничивается
+    derived_t clamped;
+    derived_compute(1500, 5000, 30000, 12000, &d);
+    derived_compute(1500, 5000, 30000, DERIVED_ALT_MAX, &clamped);
+    CHECK_EQ(d.sea_level_pressure, clamped.sea_level_pressure);
+}
+
+int main(void)
+{
+    test_saturation();
+    test_humidity();
+    test_heat_index();
+    test_sea_level();
+    HOST_TEST_DONE();
+}
@@ -0,0 +1,452 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "host_test.h"
+#include "health.h"
+#include "bme280.h"
+#include "sensor_poll.h"
+#include "freertos/task.h"
+
+/*
+ * Автомат исправности (components/health/health.c) и цикл опроса датчика с
+ * восстановлением. Цикл собран как в sensor_task (main/main.c): health_poll
+ * с политикой SENSOR_ATTEMPTS / SENSOR_BUDGET_MS / SENSOR_FAILED_RETRY_SLOTS,
+ * измерение и восстановление - components/sensor_poll, как в прошивке.
+ * Значения SENSOR_* CMake берет из main/main.c.
+ *
+ * Драйвер BME280 настоящий, а шина - модель: i2c_bus_cmd выполняет
+ * транзакцию над регистрами модели датчика и по сценарию отвечает NACK,
+ * таймаутом или зависает с прижатой SDA. Время модельное: транзакция идет
+ * 10 мкс на бит, таймаут - I2C_BUS_TIMEOUT_MS, vTaskDelay - тиками по 10 мс.
+ */
+
+// ---- Модельное время ----
+
+static int64_t now_us;
+
+void vTaskDelay(TickType_t ticks)
+{
+    now_us += (int64_t)ticks * portTICK_PERIOD_MS * 1000;
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    return "ERR";
+}
+
+void dlog_write(uint8_t level, const char *tag, const char *fmt, uint16_t spec, ...)
+{
+}
+
+// ---- Модель BME280 ----
+
+static uint8_t regs[256];
+
+static void put16(uint8_t reg, uint16_t value)
+{
+    regs[reg] = value & 0xFF;
+    regs[reg + 1] = value >> 8;
+}
+
+static void put20(uint8_t reg, uint32_t value)
+{
+    regs[reg] = value >> 12;
+    regs[reg + 1] = (value >> 4) & 0xFF;
+    regs[reg + 2] = (value & 0x0F) << 4;
+}
+
+// Калибровка и сырые значения из примера в datasheet Bosch: 25.08 °C, 1006.53 гПа
+static void device_power_on(void)
+{
+    memset(regs, 0, sizeof(regs));
+    regs[0xD0] = 0x60;
+    static const int16_t tp[12] = {
+        27504, 26435, -1000, (int16_t)36477, -10685, 3024, 2855, 140, -7, 15500, -14600, 6000,
+    };
+    for (int i = 0; i < 12; i++) put16(0x88 + 2 * i, (uint16_t)tp[i]);
+    regs[0xA1] = 75;                    // H1
+    put16(0xE1, 362);                   // H2
+    regs[0xE3] = 0;                     // H3
+    regs[0xE4] = 313 >> 4;              // H4
+    regs[0xE5] = (313 & 0x0F) | ((50 & 0x0F) << 4);
+    regs[0xE6] = 50 >> 4;               // H5
+    regs[0xE7] = 30;                    // H6
+    // До первого измерения - значения "измерение пропущено"
+    put20(0xF7, 0x80000);
+    put20(0xFA, 0x80000);
+    put16(0xFD, 0x0080);
+}
+
+static void device_write(uint8_t reg, uint8_t value)
+{
+    if (reg == 0xE0 && value == 0xB6) {
+        uint8_t id = regs[0xD0];
+        device_power_on();
+        regs[0xD0] = id;
+        return;
+    }
+    regs[reg] = value;
+    if (reg == 0xF4 && (value & 0x03) == 0x01) {
+        put20(0xF7, 415148);
+        put20(0xFA, 519888);
+        regs[0xFD] = 30000 >> 8;
+        regs[0xFE] = 30000 & 0xFF;
+        regs[0xF4] &= ~0x03;            // Forced: после измерения снова сон
+    }
+}
+
+// ---- Модель шины ----
+
+typedef struct {
+    uint8_t write[4];
+    int write_len;
+    uint8_t *read;
+    size_t read_len;
+} fake_cmd_t;
+
+static struct {
+    int nack;                   // Сколько следующих транзакций получат NACK
+    int timeout;                // Сколько следующих транзакций зависнут до таймаута
+    bool absent;                // Датчик не отвечает (NACK на адрес)
+    bool sda_stuck;             // SDA прижата: все транзакции - таймаут
+    bool stuck_clears;          // i2c_bus_recover освобождает прижатую SDA
+    uint32_t transactions;
+    uint32_t recoveries;
+} bus;
+
+i2c_cmd_handle_t i2c_cmd_link_create(void)
+{
+    static fake_cmd_t cmd;
+    memset(&cmd, 0, sizeof(cmd));
+    return &cmd;
+}
+
+void i2c_cmd_link_delete(i2c_cmd_handle_t cmd)
+{
+}
+
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd)
+{
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd, uint8_t data, bool ack_en)
+{
+    fake_cmd_t *c = cmd;
+    // Адрес чтения после повторного START не нужен модели
+    if ((data >> 1) == BME280_ADDR && c->write_len > 0) return ESP_OK;
+    c->write[c->write_len++] = data;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_read(i2c_cmd_handle_t cmd, uint8_t *data, size_t len, i2c_ack_type_t ack)
+{
+    fake_cmd_t *c = cmd;
+    c->read = data;
+    c->read_len = len;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_read_byte(i2c_cmd_handle_t cmd, uint8_t *data, i2c_ack_type_t ack)
+{
+    return i2c_master_read(cmd, data, 1, ack);
+}
+
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd)
+{
+    return ESP_OK;
+}
+
+esp_err_t i2c_bus_cmd(uint8_t addr, i2c_cmd_handle_t cmd)
+{
+    fake_cmd_t *c = cmd;
+    bus.transactions++;
+
+    if (bus.sda_stuck || bus.timeout > 0) {
+        if (bus.timeout > 0) bus.timeout--;
+        now_us += I2C_BUS_TIMEOUT_MS * 1000;
+        return ESP_ERR_TIMEOUT;
+    }
+    if (bus.absent || bus.nack > 0) {
+        if (bus.nack > 0) bus.nack--;
+        now_us += 100;
+        return ESP_FAIL;
+    }
+
+    // Адрес и регистр, затем запись или чтение подряд идущих регистров
+    now_us += (int64_t)(c->write_len + 1 + c->read_len) * 9 * 10;
+    uint8_t reg = c->write[1];
+    for (int i = 2; i < c->write_len; i++) device_write(reg, c->write[i]);
+    for (size_t i = 0; i < c->read_len; i++) c->read[i] = regs[(uint8_t)(reg + i)];
+    return ESP_OK;
+}
+
+esp_err_t i2c_bus_recover(void)
+{
+    bus.recoveries++;
+    now_us += 300;                      // 9 импульсов SCL, STOP и переустановка драйвера
+    if (bus.sda_stuck && bus.stuck_clears) bus.sda_stuck = false;
+    return bus.sda_stuck ? ESP_ERR_INVALID_STATE : ESP_OK;
+}
+
+// ---- Цикл опроса, как в sensor_task ----
+
+static const health_policy_t sensor_policy = {
+    .attempts = SENSOR_ATTEMPTS,
+    .budget_ms = SENSOR_BUDGET_MS,
+    .failed_every = SENSOR_FAILED_RETRY_SLOTS,
+};
+
+static health_t sensor_health;
+static sensor_poll_t sensor_poll;
+static int64_t cycle_start;
+static uint32_t cycle_attempts;
+
+// sensor_poll_measure с подсчетом попыток
+static int poll_measure(void *ctx)
+{
+    // Повтор начинается только в пределах бюджета цикла
+    if (cycle_attempts > 0) CHECK(now_us - cycle_start < SENSOR_BUDGET_MS * 1000);
+    cycle_attempts++;
+    return sensor_poll_measure(ctx);
+}
+
+static int64_t poll_now(void *ctx)
+{
+    return now_us;
+}
+
+static const health_ops_t sensor_ops = { poll_measure, sensor_poll_recover, poll_now, &sensor_poll };
+
+static uint32_t slot;
+static int64_t worst_cycle_us;
+
+// Один цикл sensor_task; проверяет число попыток и длительность
+static esp_err_t sensor_cycle(void)
+{
+    cycle_start = now_us;
+    cycle_attempts = 0;
+    esp_err_t ret = health_poll(&sensor_health, &sensor_policy, &sensor_ops, slot++);
+    int64_t elapsed = now_us - cycle_start;
+    if (elapsed > worst_cycle_us) worst_cycle_us = elapsed;
+
+    CHECK(cycle_attempts >= 1);
+    CHECK(cycle_attempts <= SENSOR_ATTEMPTS);
+    CHECK(elapsed <= SENSOR_BUDGET_MS * 1000);
+    return ret;
+}
+
+static void sensor_boot(void)
+{
+    memset(&bus, 0, sizeof(bus));
+    memset(&sensor_health, 0, sizeof(sensor_health));
+    device_power_on();
+    now_us = 0;
+    slot = 0;
+    memset(&sensor_poll, 0, sizeof(sensor_poll));
+    CHECK_EQ(sensor_poll_init(&sensor_poll), ESP_OK);
+}
+
+// ---- Тесты ----
+
+// ok -> degraded -> failed -> degraded -> ok, пороги и счетчики
+static void test_state_machine(void)
+{
+    health_t h;
+    memset(&h, 0, sizeof(h));
+    CHECK_EQ(health_record(&h, true), HEALTH_OK);
+    CHECK_EQ(h.transitions, 0);
+
+    for (int i = 1; i < HEALTH_FAIL_AFTER; i++) CHECK_EQ(health_record(&h, false), HEALTH_DEGRADED);
+    CHECK_EQ(health_record(&h, false), HEALTH_FAILED);
+    CHECK_EQ(h.failures, HEALTH_FAIL_AFTER);
+    CHECK_EQ(h.transitions, 2);
+
+    // Из FAILED первый успех ведет в DEGRADED, в OK - только серия успехов
+    CHECK_EQ(health_record(&h, true), HEALTH_DEGRADED);
+    for (int i = 1; i < HEALTH_RECOVER_AFTER - 1; i++) CHECK_EQ(health_record(&h, true), HEALTH_DEGRADED);
+    // Ошибка обрывает серию: отсчет успехов начинается заново
+    CHECK_EQ(health_record(&h, false), HEALTH_DEGRADED);
+    for (int i = 1; i < HEALTH_RECOVER_AFTER; i++) CHECK_EQ(health_record(&h, true), HEALTH_DEGRADED);
+    CHECK_EQ(health_record(&h, true), HEALTH_OK);
+    CHECK_EQ(h.transitions, 4);
+    CHECK_EQ(h.failures, HEALTH_FAIL_AFTER + 1);
+
+    // Одиночные ошибки не доводят до FAILED
+    for (int i = 0; i < 10; i++) {
+        health_record(&h, false);
+        health_record(&h, true);
+    }
+    CHECK(h.state != HEALTH_FAILED);
+
+    CHECK(strcmp(health_name(HEALTH_OK), "ok") == 0);
+    CHECK(strcmp(health_name(HEALTH_DEGRADED), "degraded") == 0);
+    CHECK(strcmp(health_name(HEALTH_FAILED), "failed") == 0);
+}
+
+// Политика без шины: число попыток, бюджет и редкое восстановление в FAILED
+typedef struct {
+    int64_t now;
+    uint32_t cost_ms;
+    uint32_t measures;
+    uint32_t recovers;
+} fake_ops_t;
+
+static int fake_measure(void *ctx)
+{
+    fake_ops_t *f = ctx;
+    f->measures++;
+    f->now += (int64_t)f->cost_ms * 1000;
+    return -1;
+}
+
+static void fake_recover(void *ctx, int err)
+{
+    ((fake_ops_t *)ctx)->recovers++;
+}
+
+static int64_t fake_now(void *ctx)
+{
+    return ((fake_ops_t *)ctx)->now;
+}
+
+static void test_poll_policy(void)
+{
+    health_policy_t policy = { .attempts = 3, .budget_ms = 500, .failed_every = 4 };
+    fake_ops_t f = { 0 };
+    health_ops_t ops = { fake_measure, fake_recover, fake_now, &f };
+    health_t h;
+    memset(&h, 0, sizeof(h));
+
+    // Быстрые отказы: все попытки
+    CHECK(health_poll(&h, &policy, &ops, 1) != 0);
+    CHECK_EQ(f.measures, 3);
+    CHECK_EQ(f.recovers, 2);
+
+    // Бюджет: попытка дольше бюджета - повтора нет
+    memset(&f, 0, sizeof(f));
+    f.cost_ms = 600;
+    health_poll(&h, &policy, &ops, 1);
+    CHECK_EQ(f.measures, 1);
+    CHECK_EQ(f.recovers, 0);
+
+    // Бюджет исчерпывается на второй попытке
+    memset(&f, 0, sizeof(f));
+    f.cost_ms = 300;
+    health_poll(&h, &policy, &ops, 1);
+    CHECK_EQ(f.measures, 2);
+
+    // FAILED: восстановление только в циклах, кратных failed_every
+    CHECK_EQ(h.state, HEALTH_FAILED);
+    memset(&f, 0, sizeof(f));
+    for (uint32_t cycle = 1; cycle <= 12; cycle++) health_poll(&h, &policy, &ops, cycle);
+    CHECK_EQ(f.measures, 12 + 3 * 2);
+    CHECK_EQ(f.recovers, 3 * 2);
+}
+
+// Одиночный NACK: восстановление и повтор в том же цикле
+static void test_nack(void)
+{
+    sensor_boot();
+    CHECK_EQ(sensor_cycle(), ESP_OK);
+    CHECK_NEAR(sensor_poll.temp, 25.08, 0.01);
+    CHECK_NEAR(sensor_poll.press, 1006.53, 0.1);
+
+    bus.nack = 1;
+    CHECK_EQ(sensor_cycle(), ESP_OK);
+    CHECK_EQ(cycle_attempts, 2);
+    CHECK_EQ(bus.recoveries, 1);
+    CHECK_EQ(sensor_health.state, HEALTH_OK);
+    CHECK_EQ(sensor_health.failures, 0);
+
+    // Две ошибки подряд: цикл неудачен, следующий уже успешен
+    bus.nack = 2;
+    CHECK(sensor_cycle() != ESP_OK);
+    CHECK_EQ(sensor_health.state, HEALTH_DEGRADED);
+    CHECK_EQ(sensor_cycle(), ESP_OK);
+}
+
+// Датчик пропал: таймауты, переход в FAILED, шина занимается раз в минуту
+static void test_absent(void)
+{
+    sensor_boot();
+    bus.absent = true;
+    for (int i = 0; i < HEALTH_FAIL_AFTER; i++) CHECK(sensor_cycle() != ESP_OK);
+    CHECK_EQ(sensor_health.state, HEALTH_FAILED);
+    CHECK(!sensor_poll.ready);
+
+    // В FAILED без восстановления цикл не трогает шину
+    while (slot % SENSOR_FAILED_RETRY_SLOTS != 1) sensor_cycle();
+    uint32_t transactions = bus.transactions, recoveries = bus.recoveries;
+    for (int i = 0; i < SENSOR_FAILED_RETRY_SLOTS - 1; i++) sensor_cycle();
+    CHECK_EQ(bus.transactions, transactions);
+    CHECK_EQ(bus.recoveries, recoveries);
+    CHECK_EQ(slot % SENSOR_FAILED_RETRY_SLOTS, 0);
+    sensor_cycle();
+    CHECK_EQ(bus.recoveries, recoveries + 1);
+
+    // Датчик вернулся: восстановление в ближайшем разрешенном цикле
+    bus.absent = false;
+    while (slot % SENSOR_FAILED_RETRY_SLOTS != 0) CHECK(sensor_cycle() != ESP_OK);
+    CHECK_EQ(sensor_cycle(), ESP_OK);
+    CHECK_EQ(sensor_health.state, HEALTH_DEGRADED);
+    for (int i = 1; i < HEALTH_RECOVER_AFTER; i++) CHECK_EQ(sensor_cycle(), ESP_OK);
+    CHECK_EQ(sensor_health.state, HEALTH_OK);
+}
+
+// Таймауты шины (устройство растягивает такт дольше I2C_BUS_TIMEOUT_MS)
+static void test_timeout(void)
+{
+    sensor_boot();
+    bus.timeout = 1;
+    CHECK_EQ(sensor_cycle(), ESP_OK);
+    CHECK_EQ(cycle_attempts, 2);
+
+    // Таймаут на каждой транзакции: цикл не выходит за бюджет
+    bus.timeout = 1000;
+    for (int i = 0; i < 30; i++) sensor_cycle();
+    CHECK_EQ(sensor_health.state, HEALTH_FAILED);
+}
+
+// Прижатая SDA: восстановление не помогает, пока устройство не отпустит линию
+static void test_stuck_sda(void)
+{
+    sensor_boot();
+    bus.sda_stuck = true;
+    for (int i = 0; i < HEALTH_FAIL_AFTER; i++) CHECK(sensor_cycle() != ESP_OK);
+    CHECK_EQ(sensor_health.state, HEALTH_FAILED);
+    CHECK_EQ(bus.recoveries, HEALTH_FAIL_AFTER);
+
+    // Линию освобождают импульсы SCL при следующем разрешенном восстановлении
+    bus.stuck_clears = true;
+    while (slot % SENSOR_FAILED_RETRY_SLOTS != 0) sensor_cycle();
+    CHECK_EQ(sensor_cycle(), ESP_OK);
+    CHECK(!bus.sda_stuck);
+    CHECK_EQ(sensor_health.state, HEALTH_DEGRADED);
+}
+
+// Провал питания датчика: настройки потеряны, шину освобождать не нужно
+static void test_config_lost(void)
+{
+    sensor_boot();
+    CHECK_EQ(sensor_cycle(), ESP_OK);
+    regs[0xF2] = 0;
+    regs[0xF5] = 0xFF;
+    CHECK_EQ(sensor_cycle(), ESP_OK);
+    CHECK_EQ(cycle_attempts, 2);
+    CHECK_EQ(bus.recoveries, 0);
+    CHECK_EQ(sensor_health.state, HEALTH_OK);
+}
+
+int main(void)
+{
+    test_state_machine();
+    test_poll_policy();
+    test_nack();
+    test_absent();
+    test_timeout();
+    test_stuck_sda();
+    test_config_lost();
+    printf("worst sensor cycle: %lld us (budget %d ms)\n", (long long)worst_cycle_us, SENSOR_BUDGET_MS);
+    HOST_TEST_DONE();
+}
@@ -0,0 +1,41 @@
+#include <string.h>
+#include "host_test.h"
+#include "jsonstr.h"
+
+static void check_quote(const char *text, const char *expected)
+{
+    char buf[64];
+    int n = jsonstr_quote(buf, sizeof(buf), text);
+    CHECK_EQ(n, (int)strlen(expected));
+    CHECK(strcmp(buf, expected) == 0);
+}
+
+static void test_escape(void)
+{
+    check_quote("", "\"\"");
+    check_quote("Hydra-L-001", "\"Hydra-L-001\"");
+    check_quote("pa\"ss\\word", "\"pa\\\"ss\\\\word\"");
+    check_quote("a\nb\rc\td", "\"a\\nb\\rc\\td\"");
+    check_quote("\x01\x1f", "\"\\u0001\\u001f\"");
+    // UTF-8 переносится без изменений
+    check_quote("Дом", "\"Дом\"");
+}
+
+static void test_overflow(void)
+{
+    char buf[8];
+    // "abcde" + кавычки + ноль = 8 байт
+    CHECK_EQ(jsonstr_quote(buf, sizeof(buf), "abcde"), 7);
+    CHECK_EQ(jsonstr_quote(buf, sizeof(buf), "abcdef"), -1);
+    // Экранированный символ не разрывается на границе буфера
+    CHECK_EQ(jsonstr_quote(buf, sizeof(buf), "abcd\""), -1);
+    CHECK_EQ(jsonstr_quote(buf, 2, ""), -1);
+    CHECK_EQ(jsonstr_quote(buf, 3, ""), 2);
+}
+
+int main(void)
+{
+    test_escape();
+    test_overflow();
+    HOST_TEST_DONE();
+}
@@ -0,0 +1,169 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include "host_test.h"
+#include "summary.h"
+
+/*
+ * Сводка ряда (components/summary/summary.c) против точных значений по
+ * отсортированному массиву. Квантиль - ближайший ранг p * (n - 1).
+ * Допуски для квантилей P² в долях размаха ряда:
+ *   равномерный, нормальный и монотонный ряды - 0.2% (фактически до 0.06%);
+ *   суточный ход с шумом - 3% (фактически до 2.5%, см. summary.h);
+ *   постоянный ряд и не больше пяти измерений - точное совпадение.
+ * Среднее и стандартное отклонение - 1e-4 от размаха (накопление в double,
+ * итог во float).
+ */
+
+#define SERIES_LEN  17280       // Сутки при измерении раз в 5 с
+
+static const float probs[SUMMARY_QUANTILES] = { 0.05f, 0.50f, 0.95f };
+
+static float series[SERIES_LEN];
+static float sorted[SERIES_LEN];
+
+// Детерминированный генератор, чтобы результат не зависел от libc
+static uint32_t rng_state;
+
+static double rng_uniform(void)
+{
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return ((rng_state >> 8) + 0.5) / 16777216.0;
+}
+
+static double rng_normal(void)
+{
+    double u = rng_uniform(), v = rng_uniform();
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+static int cmp_float(const void *a, const void *b)
+{
+    float x = *(const float *)a, y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+// Сводка ряда и сравнение с точными значениями; tol - доля размаха
+static void check_series(const char *name, size_t n, double tol)
+{
+    summary_t s;
+    summary_result_t r;
+    summary_reset(&s);
+    double sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        summary_add(&s, series[i]);
+        sum += series[i];
+        sorted[i] = series[i];
+    }
+    qsort(sorted, n, sizeof(sorted[0]), cmp_float);
+    summary_get(&s, &r);
+
+    double mean = sum / n, m2 = 0;
+    for (size_t i = 0; i < n; i++) m2 += (series[i] - mean) * (series[i] - mean);
+    double sd = n > 1 ? sqrt(m2 / (n - 1)) : 0;
+    double range = sorted[n - 1] - sorted[0];
+
+    CHECK_EQ(r.count, n);
+    CHECK_EQ(r.min, sorted[0]);
+    CHECK_EQ(r.max, sorted[n - 1]);
+    CHECK_NEAR(r.mean, mean, range * 1e-4 + 1e-6);
+    CHECK_NEAR(r.stddev, sd, range * 1e-4 + 1e-6);
+    for (int q = 0; q < SUMMARY_QUANTILES; q++) {
+        float exact = sorted[(size_t)(probs[q] * (n - 1) + 0.5f)];
+        if (fabs(r.quantile[q] - exact) > range * tol) {
+            fprintf(stderr, "%s: p%d\n", name, (int)(probs[q] * 100 + 0.5f));
+        }
+        CHECK_NEAR(r.quantile[q], exact, range * tol);
+    }
+}
+
+static void test_uniform(void)
+{
+    rng_state = 1;
+    for (size_t i = 0; i < SERIES_LEN; i++) series[i] = (float)(15.0 + 10.0 * rng_uniform());
+    check_series("uniform", SERIES_LEN, 0.002);
+}
+
+static void test_normal(void)
+{
+    rng_state = 2;
+    for (size_t i = 0; i < SERIES_LEN; i++) series[i] = (float)(1013.0 + 5.0 * rng_normal());
+    check_series("normal", SERIES_LEN, 0.002);
+}
+
+static void test_monotone(void)
+{
+    for (size_t i = 0; i < SERIES_LEN; i++) series[i] = 10.0f + i * 0.001f;
+    check_series("increasing", SERIES_LEN, 0.002);
+    for (size_t i = 0; i < SERIES_LEN; i++) series[i] = 30.0f - i * 0.001f;
+    check_series("decreasing", SERIES_LEN, 0.002);
+}
+
+// Суточный ход температуры: измерения приходят почти упорядоченными
+static void test_diurnal(void)
+{
+    rng_state = 3;
+    for (size_t i = 0; i < SERIES_LEN; i++) {
+        double phase = 2.0 * M_PI * i / SERIES_LEN;
+        series[i] = (float)(18.0 - 6.0 * cos(phase) + 0.2 * rng_normal());
+    }
+    check_series("diurnal", SERIES_LEN, 0.03);
+}
+
+static void test_constant(void)
+{
+    for (size_t i = 0; i < SERIES_LEN; i++) series[i] = 21.5f;
+    check_series("constant", SERIES_LEN, 0);
+}
+
+// До пяти измерений включительно квантили точные, по самим измерениям
+static void test_short(void)
+{
+    static const float values[] = { 3.0f, -1.0f, 7.5f, 2.0f, 4.0f };
+    for (size_t n = 1; n <= 5; n++) {
+        for (size_t i = 0; i < n; i++) series[i] = values[i];
+        check_series("short", n, 0);
+    }
+
+    summary_t s;
+    summary_result_t r;
+    summary_reset(&s);
+    summary_get(&s, &r);
+    CHECK_EQ(r.count, 0);
+    summary_add(&s, 5.0f);
+    summary_get(&s, &r);
+    CHECK_EQ(r.stddev, 0);
+    CHECK_EQ(r.quantile[SUMMARY_P5], 5.0f);
+    CHECK_EQ(r.quantile[SUMMARY_P95], 5.0f);
+}
+
+// Окно закрывается на границе периода, пустые периоды пропускаются
+static void test_window(void)
+{
+    summary_window_t w;
+    summary_window_init(&w, 3600, 100);
+    CHECK_EQ(w.start_s, 0);
+    CHECK(!summary_window_add(&w, 100, 1.0f));
+    CHECK(!summary_window_add(&w, 3599, 3.0f));
+    CHECK(summary_window_add(&w, 3600, 10.0f));
+    CHECK_EQ(w.closed, 1);
+    CHECK_EQ(w.last_start_s, 0);
+    CHECK_EQ(w.last.count, 2);
+    CHECK_NEAR(w.last.mean, 2.0, 1e-6);
+    CHECK(summary_window_add(&w, 4 * 3600 + 5, 20.0f));
+    CHECK_EQ(w.last_start_s, 3600);
+    CHECK_EQ(w.start_s, 4 * 3600);
+    CHECK_EQ(w.current.count, 1);
+}
+
+int main(void)
+{
+    test_uniform();
+    test_normal();
+    test_monotone();
+    test_diurnal();
+    test_constant();
+    test_short();
+    test_window();
+    HOST_TEST_DONE();
+}
@@ -0,0 +1,87 @@
+#include <stdlib.h>
+#include <string.h>
+#include "host_test.h"
+#include "telemetry.h"
+
+static void push(telemetry_batch_t *batch, uint32_t uptime_s)
+{
+    telemetry_sample_t sample = { .uptime_s = uptime_s };
+    telemetry_batch_push(batch, &sample);
+}
+
+static uint32_t head_uptime(const telemetry_batch_t *batch)
+{
+    return batch->samples[batch->head].uptime_s;
+}
+
+// Первое измерение следующего пакета
+static uint32_t next_uptime(const telemetry_batch_t *batch)
+{
+    static const telemetry_device_t device = { .serial = "s", .akey = "k", .mac = "", .ip = "" };
+    char buf[512];
+    uint32_t encoded = 0;
+    if (telemetry_encode_batch(&device, batch, 1, buf, sizeof(buf), &encoded) < 0) return 0;
+    const char *p = strstr(buf, "[[");
+    return p ? (uint32_t)strtoul(p + 2, NULL, 10) : 0;
+}
+
+static void test_ack(void)
+{
+    static telemetry_batch_t batch;
+    memset(&batch, 0, sizeof(batch));
+    for (uint32_t i = 1; i <= 10; i++) push(&batch, i);
+
+    // Два пакета по 4 измерения в пути: следующий начинается с 9-го
+    telemetry_batch_mark_sent(&batch, 4);
+    telemetry_batch_mark_sent(&batch, 4);
+    CHECK_EQ(batch.count, 10);
+    CHECK_EQ(next_uptime(&batch), 9);
+
+    // PUBACK первого пакета удаляет только его измерения
+    telemetry_batch_ack(&batch, 4);
+    CHECK_EQ(batch.count, 6);
+    CHECK_EQ(batch.sent, 4);
+    CHECK_EQ(head_uptime(&batch), 5);
+
+    // Второй пакет потерян: отправка заново с первого неподтвержденного
+    telemetry_batch_resend(&batch);
+    CHECK_EQ(batch.count, 6);
+    CHECK_EQ(next_uptime(&batch), 5);
+
+    // Подтверждений больше, чем отправлено, не бывает: лишнее не удаляет буфер
+    telemetry_batch_mark_sent(&batch, 2);
+    telemetry_batch_ack(&batch, 5);
+    CHECK_EQ(batch.count, 4);
+    CHECK_EQ(batch.sent, 0);
+    CHECK_EQ(head_uptime(&batch), 7);
+}
+
+static void test_evicted(void)
+{
+    static telemetry_batch_t batch;
+    memset(&batch, 0, sizeof(batch));
+    for (uint32_t i = 1; i <= TELEMETRY_BATCH_MAX; i++) push(&batch, i);
+    telemetry_batch_mark_sent(&batch, 4);
+
+    // Переполнение вытесняет два отправленных, но не подтвержденных измерения
+    push(&batch, 100);
+    push(&batch, 101);
+    CHECK_EQ(batch.dropped, 2);
+    CHECK_EQ(batch.sent, 2);
+    CHECK_EQ(batch.sent_evicted, 2);
+    CHECK_EQ(head_uptime(&batch), 3);
+
+    // PUBACK пакета удаляет только оставшиеся в буфере измерения из него
+    telemetry_batch_ack(&batch, 4);
+    CHECK_EQ(batch.sent, 0);
+    CHECK_EQ(batch.sent_evicted, 0);
+    CHECK_EQ(head_uptime(&batch), 5);
+    CHECK_EQ(batch.count, TELEMETRY_BATCH_MAX - 2);
+}
+
+int main(void)
+{
+    test_ack();
+    test_evicted();
+    HOST_TEST_DONE();
+}
@@ -0,0 +1,197 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include "host_test.h"
+#include "wifi_sm.h"
+
+/*
+ * Автомат переподключения (components/wifi_link/wifi_sm.c): события драйвера
+ * Wi-Fi подаются так, как их подает wifi_link.c. Код причины обрыва автомат не
+ * принимает (wifi_link.c только пишет его в журнал и /getStats), поэтому в
+ * сценариях он указан для читаемости. Отказа от попыток нет: точка доступа
+ * Hydra-L работает всегда (режим APSTA), станция переподключается бесконечно.
+ */
+
+// Допустимая задержка попытки номер attempt: [d/2, d], d = MIN * 2^(attempt-1) <= MAX
+static uint32_t backoff_ceiling(uint32_t attempt)
+{
+    uint64_t d = WIFI_SM_BACKOFF_MIN_MS;
+    for (uint32_t i = 1; i < attempt && d < WIFI_SM_BACKOFF_MAX_MS; i++) d <<= 1;
+    return d > WIFI_SM_BACKOFF_MAX_MS ? WIFI_SM_BACKOFF_MAX_MS : (uint32_t)d;
+}
+
+static void check_delay(uint32_t attempt, uint32_t delay)
+{
+    uint32_t ceiling = backoff_ceiling(attempt);
+    CHECK(delay >= ceiling / 2);
+    CHECK(delay <= ceiling);
+}
+
+// Старт, подключение по кэшу и статистика первого подключения
+static void test_boot(void)
+{
+    wifi_sm_t sm;
+    wifi_sm_init(&sm, true, 1);
+    CHECK_EQ(wifi_sm_start(&sm, 100), WIFI_SM_CONNECT_FAST);
+    CHECK_EQ(sm.state, WIFI_SM_CONNECTING);
+    wifi_sm_connected(&sm, 2100);
+    CHECK_EQ(sm.state, WIFI_SM_CONNECTED);
+    CHECK_EQ(sm.boot_connect_ms, 2000);
+    CHECK_EQ(sm.fast_connects, 1);
+    CHECK_EQ(sm.reconnects, 0);
+
+    // Повторный GOT_IP не считается вторым подключением
+    wifi_sm_connected(&sm, 3000);
+    CHECK_EQ(sm.fast_connects, 1);
+    CHECK_EQ(sm.boot_connect_ms, 2000);
+
+    // Без кэша первая попытка - со сканированием
+    wifi_sm_init(&sm, false, 1);
+    CHECK_EQ(wifi_sm_start(&sm, 0), WIFI_SM_CONNECT_SCAN);
+}
+
+typedef enum { EV_DISCONNECT, EV_TIMER, EV_GOT_IP } event_t;
+
+typedef struct {
+    uint32_t at_ms;
+    event_t event;
+    uint8_t reason;             // Код причины из события драйвера (только для чтения сценария)
+} step_t;
+
+// Обрыв, неудачная быстрая попытка, попытки со сканированием, восстановление
+static void test_outage_replay(void)
+{
+    static const step_t steps[] = {
+        { 10000, EV_DISCONNECT, 8 },    // ASSOC_LEAVE: точка перезагружается
+        { 10000, EV_TIMER, 0 },         // Задержка 0: сразу попытка по кэшу
+        { 12000, EV_DISCONNECT, 201 },  // NO_AP_FOUND
+        { 12500, EV_TIMER, 0 },
+        { 14000, EV_DISCONNECT, 201 },
+        { 15000, EV_TIMER, 0 },
+        { 17000, EV_DISCONNECT, 15 },   // 4WAY_HANDSHAKE_TIMEOUT
+        { 19000, EV_TIMER, 0 },
+        { 21000, EV_GOT_IP, 0 },
+    };
+
+    wifi_sm_t sm;
+    wifi_sm_init(&sm, true, 7);
+    wifi_sm_start(&sm, 0);
+    wifi_sm_connected(&sm, 1000);
+
+    uint32_t expected_attempt = 0;
+    for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+        const step_t *s = &steps[i];
+        uint32_t delay = UINT32_MAX;
+        switch (s->event) {
+            case EV_DISCONNECT:
+                CHECK(wifi_sm_disconnected(&sm, s->at_ms, &delay));
+                CHECK_EQ(sm.state, WIFI_SM_WAITING);
+                CHECK_EQ(sm.attempt, expected_attempt);
+                if (expected_attempt == 0) {
+                    CHECK_EQ(delay, 0);
+                } else {
+                    check_delay(expected_attempt, delay);
+                }
+                // Повторное событие во время ожидания таймер не перезапускает
+                CHECK(!wifi_sm_disconnected(&sm, s->at_ms, &delay));
+                expected_attempt++;
+                break;
+            case EV_TIMER: {
+                wifi_sm_action_t action = wifi_sm_timeout(&sm, s->at_ms);
+                // Только первая попытка после обрыва идет по кэшу
+                CHECK_EQ(action, expected_attempt == 1 ? WIFI_SM_CONNECT_FAST : WIFI_SM_CONNECT_SCAN);
+                CHECK_EQ(sm.state, WIFI_SM_CONNECTING);
+                break;
+            }
+            case EV_GOT_IP:
+                wifi_sm_connected(&sm, s->at_ms);
+                break;
+        }
+    }
+
+    CHECK_EQ(sm.state, WIFI_SM_CONNECTED);
+    CHECK_EQ(sm.failed_attempts, 3);
+    CHECK_EQ(sm.reconnects, 1);
+    CHECK_EQ(sm.last_reconnect_ms, 11000);
+    CHECK_EQ(sm.max_reconnect_ms, 11000);
+    CHECK_EQ(sm.fast_connects, 1);      // Только при старте
+
+    // GOT_IP сбрасывает счетчик и восстанавливает кэш: следующий обрыв снова
+    // начинается с немедленной попытки без сканирования
+    CHECK_EQ(sm.attempt, 0);
+    CHECK(sm.cache_valid);
+    uint32_t delay = UINT32_MAX;
+    CHECK(wifi_sm_disconnected(&sm, 30000, &delay));
+    CHECK_EQ(delay, 0);
+    CHECK_EQ(wifi_sm_timeout(&sm, 30000), WIFI_SM_CONNECT_FAST);
+    wifi_sm_connected(&sm, 30500);
+    CHECK_EQ(sm.reconnects, 2);
+    CHECK_EQ(sm.fast_connects, 2);
+    CHECK_EQ(sm.last_reconnect_ms, 500);
+    CHECK_EQ(sm.max_reconnect_ms, 11000);
+}
+
+// Долгий обрыв: рост задержки до потолка, попытки не прекращаются
+static void test_backoff_bounds(void)
+{
+    wifi_sm_t sm;
+    wifi_sm_init(&sm, true, 12345);
+    wifi_sm_start(&sm, 0);
+    wifi_sm_connected(&sm, 0);
+
+    uint32_t now = 1000;
+    uint32_t delay = 0;
+    CHECK(wifi_sm_disconnected(&sm, now, &delay));
+    for (uint32_t attempt = 1; attempt <= 200; attempt++) {
+        now += delay;
+        wifi_sm_action_t action = wifi_sm_timeout(&sm, now);
+        CHECK(action == WIFI_SM_CONNECT_FAST || action == WIFI_SM_CONNECT_SCAN);
+        // Зависшая попытка прерывается, драйвер затем сообщает об обрыве
+        now += WIFI_SM_ATTEMPT_TIMEOUT_MS;
+        CHECK_EQ(wifi_sm_timeout(&sm, now), WIFI_SM_ABORT);
+        CHECK(wifi_sm_disconnected(&sm, now, &delay));
+        CHECK_EQ(sm.attempt, attempt);
+        check_delay(attempt, delay);
+    }
+    CHECK_EQ(sm.failed_attempts, 200);
+    CHECK(!sm.cache_valid);
+    CHECK_EQ(backoff_ceiling(200), WIFI_SM_BACKOFF_MAX_MS);
+}
+
+// Разброс: задержки покрывают весь интервал [d/2, d], а не одну точку
+static void test_jitter_range(void)
+{
+    const uint32_t attempt = 4;         // d = 4000 мс
+    uint32_t ceiling = backoff_ceiling(attempt);
+    uint32_t lo = UINT32_MAX, hi = 0;
+    uint32_t first = 0;
+    bool differ = false;
+
+    for (uint32_t seed = 1; seed <= 500; seed++) {
+        wifi_sm_t sm;
+        wifi_sm_init(&sm, false, seed);
+        wifi_sm_start(&sm, 0);
+        uint32_t delay = 0;
+        for (uint32_t n = 1; n <= attempt; n++) {
+            wifi_sm_disconnected(&sm, 0, &delay);
+            wifi_sm_timeout(&sm, 0);
+        }
+        check_delay(attempt, delay);
+        if (delay < lo) lo = delay;
+        if (delay > hi) hi = delay;
+        if (seed == 1) first = delay;
+        else if (delay != first) differ = true;
+    }
+    CHECK(differ);
+    // Устройства, потерявшие точку одновременно, не должны стучаться в нее хором
+    CHECK(lo < ceiling / 2 + ceiling / 10);
+    CHECK(hi > ceiling - ceiling / 10);
+}
+
+int main(void)
+{
+    test_boot();
+    test_outage_replay();
+    test_backoff_bounds();
+    test_jitter_range();
+    HOST_TEST_DONE();
+}
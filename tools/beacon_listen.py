@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+"""Приемник UDP маяков Hydra-L: разбор кадров, потери и пропускная способность.
+
+Слушает многоадресную группу, проверяет подпись кадров (HMAC-SHA256 с ключом
+устройства, первые 8 байт) и по номерам кадров считает потери, дубликаты и
+перезапуски каждого устройства. Формат кадра описан в
+components/telemetry/include/telemetry.h.
+
+Пример:
+    python3 tools/beacon_listen.py --key default_key --interval 10
+    python3 tools/beacon_listen.py --key default_key --show-frames
+"""
+import argparse
+import hashlib
+import hmac
+import socket
+import struct
+import time
+
+FRAME = struct.Struct('<2sBBII6shHIbBHH')
+TAG_SIZE = 8
+HEALTH = ('ok', 'degraded', 'failed', '?')
+
+
+class Device:
+    def __init__(self):
+        self.received = 0
+        self.lost = 0
+        self.duplicates = 0
+        self.restarts = 0
+        self.last_seq = None
+        self.last = None
+
+
+def decode(data, key):
+    if len(data) != FRAME.size + TAG_SIZE:
+        return None, 'size'
+    body, tag = data[:FRAME.size], data[FRAME.size:]
+    (magic, version, flags, seq, uptime, mac, temp, hum, press, rssi,
+     _res, interval, _res2) = FRAME.unpack(body)
+    if magic != b'HY' or version != 1:
+        return None, 'format'
+    if key is not None:
+        expected = hmac.new(key, body, hashlib.sha256).digest()[:TAG_SIZE]
+        if not hmac.compare_digest(expected, tag):
+            return None, 'signature'
+    return {
+        'mac': ':'.join('%02x' % b for b in mac),
+        'seq': seq,
+        'uptime': uptime,
+        'temperature': temp / 100.0,
+        'humidity': hum / 100.0,
+        'pressure': press / 100.0,
+        'rssi': rssi,
+        'interval': interval,
+        'health': HEALTH[flags & 0x03],
+    }, None
+
+
+def open_socket(group, port):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.bind(('', port))
+    mreq = struct.pack('4s4s', socket.inet_aton(group), socket.inet_aton('0.0.0.0'))
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, mreq)
+    sock.settimeout(1.0)
+    return sock
+
+
+def report(devices, rejected, packets, octets, elapsed):
+    total_rx = sum(d.received for d in devices.values())
+    total_lost = sum(d.lost for d in devices.values())
+    loss = 100.0 * total_lost / max(total_rx + total_lost, 1)
+    print('%d devices, %.1f pkt/s, %.0f B/s, loss %.2f%%, rejected %s' %
+          (len(devices), packets / elapsed, octets / elapsed, loss,
+           ' '.join('%s=%d' % kv for kv in sorted(rejected.items())) or '0'))
+    for mac, d in sorted(devices.items()):
+        f = d.last
+        print('  %s rx %d lost %d dup %d restarts %d  T=%.2f H=%.2f P=%.2f RSSI=%d sensor %s' %
+              (mac, d.received, d.lost, d.duplicates, d.restarts,
+               f['temperature'], f['humidity'], f['pressure'], f['rssi'], f['health']))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--group', default='239.255.76.72')
+    parser.add_argument('--port', type=int, default=7272)
+    parser.add_argument('--key', help='ключ подписи (akey устройства); без него подпись не проверяется')
+    parser.add_argument('--interval', type=float, default=10.0, help='период отчета (с)')
+    parser.add_argument('--show-frames', action='store_true', help='печатать каждый кадр')
+    args = parser.parse_args()
+
+    key = args.key.encode() if args.key is not None else None
+    sock = open_socket(args.group, args.port)
+    devices = {}
+    rejected = {}
+    packets = octets = 0
+    window_start = time.time()
+    print('Listening on %s:%d' % (args.group, args.port))
+
+    while True:
+        try:
+            data, addr = sock.recvfrom(512)
+        except socket.timeout:
+            data = None
+
+        if data is not None:
+            frame, error = decode(data, key)
+            if error:
+                rejected[error] = rejected.get(error, 0) + 1
+            else:
+                packets += 1
+                octets += len(data)
+                dev = devices.setdefault(frame['mac'], Device())
+                if dev.last_seq is None:
+                    pass
+                elif frame['seq'] == dev.last_seq:
+                    dev.duplicates += 1
+                    continue
+                elif frame['seq'] < dev.last_seq:
+                    # Номер сбрасывается при перезагрузке устройства
+                    dev.restarts += 1
+                else:
+                    dev.lost += frame['seq'] - dev.last_seq - 1
+                dev.received += 1
+                dev.last_seq = frame['seq']
+                dev.last = frame
+                if args.show_frames:
+                    print('%s %s' % (addr[0], frame))
+
+        elapsed = time.time() - window_start
+        if elapsed >= args.interval:
+            report(devices, rejected, packets, octets, elapsed)
+            packets = octets = 0
+            window_start = time.time()
+
+
+if __name__ == '__main__':
+    main()
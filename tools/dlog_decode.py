@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+"""Декодер отложенного журнала Hydra-L (components/dlog).
+
+Читает двоичную выгрузку "/log?format=bin" и восстанавливает текст по
+строкам формата из ELF файла той же сборки прошивки: в записи хранится
+только адрес строки формата, адрес тега и сырые аргументы.
+
+Пример:
+    curl -o log.bin "http://192.168.4.1/log?format=bin"
+    python3 tools/dlog_decode.py log.bin build/hydra_l.elf
+"""
+import argparse
+import re
+import struct
+import sys
+
+MAGIC = 0x31474C44
+HEADER = struct.Struct('<IHHII')
+SLOT = struct.Struct('<IIIHBB16s')
+ARG_INT, ARG_FLOAT, ARG_STR = 0, 1, 2
+LEVELS = 'NEWIDV'
+SPEC_RE = re.compile(r'%(%|[-+ #0-9.]*)([hlLqjzt]*)([diouxXcsfFeEgGp]?)')
+
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+
+class Elf:
+    """Минимальный разбор ELF32: чтение строк по адресу из загружаемых секций."""
+
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.data = f.read()
+        if self.data[:4] != b'\x7fELF' or self.data[4] != 1:
+            raise ValueError('%s: ожидается ELF32' % path)
+        shoff, = struct.unpack_from('<I', self.data, 0x20)
+        shentsize, shnum = struct.unpack_from('<HH', self.data, 0x2E)
+        self.sections = []
+        for i in range(shnum):
+            (_name, sh_type, flags, addr, offset, size) = struct.unpack_from(
+                '<IIIIII', self.data, shoff + i * shentsize)
+            if flags & SHF_ALLOC and sh_type != SHT_NOBITS and size:
+                self.sections.append((addr, size, offset))
+
+    def string(self, addr):
+        for base, size, offset in self.sections:
+            if base <= addr < base + size:
+                start = offset + addr - base
+                end = self.data.find(b'\0', start, offset + size)
+                if end < 0:
+                    return None
+                return self.data[start:end].decode('utf-8', 'replace')
+        return None
+
+
+def read_args(spec, payload):
+    count = (spec >> 12) & 0x7
+    args, pos = [], 0
+    for i in range(count):
+        kind = (spec >> (i * 2)) & 0x3
+        if kind == ARG_STR:
+            length = payload[pos]
+            args.append((kind, payload[pos + 1:pos + 1 + length].decode('utf-8', 'replace')))
+            pos += 1 + length
+        elif kind == ARG_FLOAT:
+            args.append((kind, struct.unpack_from('<f', payload, pos)[0]))
+            pos += 4
+        else:
+            args.append((kind, struct.unpack_from('<I', payload, pos)[0]))
+            pos += 4
+    return args
+
+
+def format_record(fmt, args):
+    it = iter(args)
+
+    def replace(match):
+        flags, _length, conv = match.groups()
+        if flags == '%':
+            return '%'
+        kind, value = next(it, (None, None))
+        if kind == ARG_STR and conv == 's':
+            return ('%' + flags + 's') % value
+        if kind == ARG_FLOAT and conv in 'fFeEgG':
+            return ('%' + flags + conv) % value
+        if kind == ARG_INT and conv in 'diouxXc':
+            if conv in 'di' and value >= 0x80000000:
+                value -= 1 << 32
+            if conv == 'c':
+                return chr(value & 0xFF)
+            return ('%' + flags + ('d' if conv == 'i' else conv)) % value
+        return '<?>'
+
+    return SPEC_RE.sub(replace, fmt)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('dump', help='выгрузка /log?format=bin')
+    parser.add_argument('elf', help='ELF файл прошивки, которая записала журнал')
+    args = parser.parse_args()
+
+    with open(args.dump, 'rb') as f:
+        data = f.read()
+    magic, slot_size, slots, total, count = HEADER.unpack_from(data, 0)
+    if magic != MAGIC or slot_size != SLOT.size:
+        sys.exit('%s: неизвестный формат выгрузки' % args.dump)
+    elf = Elf(args.elf)
+
+    print('# %d records in buffer of %d, %d written since clear' % (count, slots, total))
+    offset = HEADER.size
+    prev_boot = None
+    for _ in range(count):
+        fmt_addr, tag_addr, time_ms, spec, level, prev, payload = SLOT.unpack_from(data, offset)
+        offset += SLOT.size
+        if prev != prev_boot:
+            print('# --- %s ---' % ('previous boot' if prev else 'current boot'))
+            prev_boot = prev
+        fmt = elf.string(fmt_addr)
+        tag = elf.string(tag_addr) or '?'
+        text = format_record(fmt, read_args(spec, payload)) if fmt is not None \
+            else '<fmt 0x%08x not in ELF>' % fmt_addr
+        print('%s (%d) %s: %s' % (LEVELS[level] if level < len(LEVELS) else '?', time_ms, tag, text))
+
+
+if __name__ == '__main__':
+    main()
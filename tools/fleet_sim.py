@@ -0,0 +1,795 @@
+#!/usr/bin/env python3
+"""Эмулятор парка устройств Hydra-L и нагрузочный тест приема телеметрии.
+
+Запускает тысячи виртуальных устройств против локальной замены jsonadd.php
+(или внешнего сервера, --url) и сообщает запросы в секунду, трафик на
+устройство в сутки, число подключений и задержку ответа (p50/p99/p99.9).
+
+Полезную нагрузку строит код прошивки: components/telemetry и
+components/derived не зависят от SDK, собираются компилятором хоста в
+разделяемую библиотеку и вызываются через ctypes, поэтому изменение формата
+в прошивке сразу меняет и нагрузку. Периоды и размеры берутся из
+main/main.c и заголовков. Каждое устройство повторяет server_task:
+измерение раз в TELEMETRY_SAMPLE_MS в кольцевой буфер, отправка раз в
+TELEMETRY_PUBLISH_MS, если есть Wi-Fi; буфер очищается только если сервер
+ответил (любым кодом - так считает прошивка), после неудачи следующая
+попытка - через период отправки, а после простоя без сети - на ближайшем
+измерении. Вызов блокирует задачу до ответа или таймаута, после чего
+пропущенные измерения снимаются подряд, как у vTaskDelayUntil.
+
+Способы отправки (--transport):
+    close       http:// через esp_http_client - новое соединение на запрос
+    keepalive   https:// через components/tls_uplink - соединение держится;
+                по открытому соединению один повтор по новому, только если
+                запрос не дошел: запись не удалась или сервер закрыл
+                соединение (EOF, сброс) до первого байта ответа. После
+                таймаута или оборванного ответа повтора нет (сам TLS не
+                эмулируется: число подключений - это число рукопожатий)
+Кодирование (--encoding): post - последнее измерение, как send_data_to_server();
+batch - все накопленные пакетами telemetry_encode_batch (оценка перехода на
+пакеты, как в MQTT).
+
+Сценарии (время - секунды от начала эмуляции, можно повторять):
+    --outage 600:300[:refuse|hang|503]  сервер недоступен: отказ в соединении,
+                                        зависание до таймаута или ответ 503
+    --wifi-outage 1200:600[:30]         устройства без сети; после восстановления
+                                        подключаются в течение 30 с - шквал
+                                        отправок на ближайшем измерении
+    --power-cycle 2400[:2]              все устройства перезагружаются в течение
+                                        2 с и дальше отправляют синхронно
+
+--speed ускоряет время устройств (периоды, таймауты, сценарии): 5000
+устройств при --speed 10 нагружают сервер как 50000 в реальном времени.
+Задержка ответа измеряется в реальном времени, поэтому для нее лучше
+--speed 1. Если задержка цикла событий эмулятора (loop lag) велика,
+результат ограничен самим эмулятором, а не сервером.
+
+Пример:
+    python3 tools/fleet_sim.py --devices 2000 --duration 3600 --speed 10 \\
+        --outage 900:300 --wifi-outage 2000:600:20 --timeline 60
+    python3 tools/fleet_sim.py --devices 5000 --duration 7200 --speed 20 \\
+        --transport keepalive --encoding batch --json build/fleet.json
+"""
+import argparse
+import asyncio
+import ctypes
+import json
+import math
+import multiprocessing
+import os
+import random
+import re
+import resource
+import subprocess
+import sys
+import time
+from urllib.parse import urlsplit
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SOURCES = ['components/telemetry/telemetry.c', 'components/derived/derived.c',
+           'components/jsonstr/jsonstr.c']
+INCLUDES = ['components/telemetry/include', 'components/derived/include',
+            'components/summary/include', 'components/jsonstr/include']
+HEADERS = ['components/telemetry/include/telemetry.h', 'components/derived/include/derived.h',
+           'components/summary/include/summary.h', 'components/jsonstr/include/jsonstr.h']
+
+POST_BUF = 512                  # json_str в send_data_to_server() и buf в publish_telemetry()
+USER_AGENT = 'ESP32 HTTP Client/1.0'
+TCP_CONNECT_OVERHEAD = 7 * 40   # SYN, SYN-ACK, ACK, FIN/ACK с обеих сторон: заголовки IP+TCP
+TCP_SEGMENT_OVERHEAD = 2 * 40   # Сегмент данных и ACK на него
+REQUEST_TIMEOUT_S = 60.0        # Ожидание первого запроса в соединении (Timeout Apache)
+LAG_WARN_MS = 10.0
+
+
+def firmware_define(path, name):
+    """Значение #define из исходника прошивки (число или строка в кавычках)."""
+    with open(os.path.join(ROOT, path)) as f:
+        match = re.search(r'^#define\s+%s\s+(\S+)' % name, f.read(), re.M)
+    if match is None:
+        sys.exit('%s: нет #define %s' % (path, name))
+    value = match.group(1)
+    return value.strip('"') if value.startswith('"') else int(value)
+
+
+# Структуры из telemetry.h и derived.h
+class Derived(ctypes.Structure):
+    _fields_ = [('dew_point', ctypes.c_int32), ('abs_humidity', ctypes.c_int32),
+                ('heat_index', ctypes.c_int32), ('sea_level_pressure', ctypes.c_int32)]
+
+
+class Sample(ctypes.Structure):
+    _fields_ = [('uptime_s', ctypes.c_uint32), ('temperature', ctypes.c_float),
+                ('humidity', ctypes.c_float), ('pressure', ctypes.c_float),
+                ('derived', Derived), ('health', ctypes.c_uint8)]
+
+
+class DeviceInfo(ctypes.Structure):
+    _fields_ = [('serial', ctypes.c_char_p), ('akey', ctypes.c_char_p), ('rssi', ctypes.c_int),
+                ('mac', ctypes.c_char_p), ('ip', ctypes.c_char_p),
+                ('sensor_health', ctypes.c_char_p)]
+
+
+BATCH_MAX = firmware_define('components/telemetry/include/telemetry.h', 'TELEMETRY_BATCH_MAX')
+
+
+class Batch(ctypes.Structure):
+    _fields_ = [('samples', Sample * BATCH_MAX), ('head', ctypes.c_uint32),
+                ('count', ctypes.c_uint32), ('dropped', ctypes.c_uint32),
+                ('sent', ctypes.c_uint32), ('sent_evicted', ctypes.c_uint32)]
+
+
+def build_library(directory):
+    """Сборка components/telemetry, derived и jsonstr для хоста (при изменении исходников)."""
+    os.makedirs(directory, exist_ok=True)
+    lib = os.path.join(directory, 'libtelemetry.so')
+    inputs = [os.path.join(ROOT, p) for p in SOURCES + HEADERS]
+    if os.path.exists(lib) and os.path.getmtime(lib) >= max(map(os.path.getmtime, inputs)):
+        return lib
+    cmd = [os.environ.get('CC', 'cc'), '-std=gnu11', '-O2', '-shared', '-fPIC', '-o', lib]
+    cmd += ['-I' + os.path.join(ROOT, p) for p in INCLUDES]
+    cmd += [os.path.join(ROOT, p) for p in SOURCES] + ['-lm']
+    subprocess.check_call(cmd)
+    return lib
+
+
+class Firmware:
+    """Кодирование и кольцевой буфер телеметрии из прошивки."""
+
+    def __init__(self, path):
+        lib = ctypes.CDLL(path)
+        self.push = lib.telemetry_batch_push
+        self.push.argtypes = [ctypes.POINTER(Batch), ctypes.POINTER(Sample)]
+        self.push.restype = None
+        self.consume = lib.telemetry_batch_consume
+        self.consume.argtypes = [ctypes.POINTER(Batch), ctypes.c_uint32]
+        self.consume.restype = None
+        self._post = lib.telemetry_encode_post
+        self._post.argtypes = [ctypes.POINTER(DeviceInfo), ctypes.POINTER(Sample),
+                               ctypes.c_char_p, ctypes.c_size_t]
+        self._batch = lib.telemetry_encode_batch
+        self._batch.argtypes = [ctypes.POINTER(DeviceInfo), ctypes.POINTER(Batch), ctypes.c_uint32,
+                                ctypes.c_char_p, ctypes.c_size_t, ctypes.POINTER(ctypes.c_uint32)]
+        self._derived = lib.derived_compute
+        self._derived.argtypes = [ctypes.c_int32] * 4 + [ctypes.POINTER(Derived)]
+        self._derived.restype = None
+        self.buf = ctypes.create_string_buffer(POST_BUF)
+
+    def encode_post(self, device, sample):
+        n = self._post(ctypes.byref(device), ctypes.byref(sample), self.buf, POST_BUF)
+        return self.buf.raw[:n] if n > 0 else None
+
+    def encode_batch(self, device, batch, max_samples):
+        encoded = ctypes.c_uint32(0)
+        n = self._batch(ctypes.byref(device), ctypes.byref(batch), max_samples,
+                        self.buf, POST_BUF, ctypes.byref(encoded))
+        return (self.buf.raw[:n], encoded.value) if n > 0 else (None, 0)
+
+    def derived(self, t, h, p, altitude, out):
+        # Как в sensor_task: 0.01 °C, 0.01 %, Па
+        self._derived(int(t * 100), int(h * 100), int(p * 100), altitude, ctypes.byref(out))
+
+    def self_test(self):
+        """Проверка, что структуры ctypes совпадают с заголовками прошивки."""
+        device = DeviceInfo(b'Hydra-L-TEST', b'key', -60, b'00:11:22:33:44:55', b'10.0.0.1', b'ok')
+        batch = Batch()
+        for i in range(BATCH_MAX + 1):
+            sample = Sample(uptime_s=i, temperature=20.5, humidity=40.25, pressure=1000.0)
+            self.derived(20.5, 40.25, 1000.0, 150, sample.derived)
+            self.push(ctypes.byref(batch), ctypes.byref(sample))
+        body, count = self.encode_batch(device, batch, 3)
+        doc = json.loads(body)
+        post = json.loads(self.encode_post(device, sample))
+        if (batch.count != BATCH_MAX or batch.dropped != 1 or count != 3 or
+                [s[0] for s in doc['samples']] != [1, 2, 3] or doc['samples'][0][1] != 20.5 or
+                post['system']['Serial'] != 'Hydra-L-TEST' or post['BME280']['humidity'] != 40.25 or
+                not 0 < post['derived']['dew_point'] < 20.5):
+            sys.exit('структуры ctypes не совпадают с components/telemetry')
+
+
+def parse_scenario(text, kind):
+    parts = text.split(':')
+    try:
+        start = float(parts[0])
+        if kind == 'power':
+            return start, float(parts[1]) if len(parts) > 1 else 2.0
+        duration = float(parts[1])
+        if kind == 'outage':
+            mode = parts[2] if len(parts) > 2 else 'refuse'
+            if mode not in ('refuse', 'hang', '503'):
+                raise ValueError(mode)
+            return start, start + duration, mode
+        return start, start + duration, float(parts[2]) if len(parts) > 2 else 5.0
+    except (IndexError, ValueError):
+        raise argparse.ArgumentTypeError('неверный сценарий: ' + text)
+
+
+def percentile(values, q):
+    if not values:
+        return 0.0
+    return values[min(len(values) - 1, int(math.ceil(q * len(values))) - 1)]
+
+
+class Clock:
+    """Время устройств (секунды эмуляции), в speed раз быстрее реального."""
+
+    def __init__(self, start, speed):
+        self.start = start
+        self.speed = speed
+
+    def now(self):
+        return (time.monotonic() - self.start) * self.speed
+
+    async def sleep_until(self, t):
+        delay = (t - self.now()) / self.speed
+        if delay > 0:
+            await asyncio.sleep(delay)
+
+
+# ---------------------------------------------------------------------------
+# Замена jsonadd.php (отдельный процесс, чтобы эмулятор не искажал задержку)
+
+class CollectorStats:
+    def __init__(self):
+        self.connections = 0
+        self.open = 0
+        self.open_peak = 0
+        self.requests = 0
+        self.samples = 0
+        self.invalid = 0
+        self.status = {}
+        self.idle_closed = 0
+
+
+class Collector:
+    def __init__(self, args, clock):
+        self.args = args
+        self.clock = clock
+        self.stats = CollectorStats()
+        self.writers = set()
+        self.server = None
+
+    def outage(self):
+        now = self.clock.now()
+        for start, end, mode in self.args.outage:
+            if start <= now < end:
+                return mode
+        return None
+
+    async def handle(self, reader, writer):
+        st = self.stats
+        st.connections += 1
+        st.open += 1
+        st.open_peak = max(st.open_peak, st.open)
+        self.writers.add(writer)
+        # Первый запрос ждем долго, следующие - не дольше --idle-timeout
+        wait = REQUEST_TIMEOUT_S / self.clock.speed
+        try:
+            while True:
+                try:
+                    head = await asyncio.wait_for(reader.readuntil(b'\r\n\r\n'), wait)
+                except asyncio.TimeoutError:
+                    st.idle_closed += 1
+                    break
+                wait = self.args.idle_timeout / self.clock.speed
+                match = re.search(rb'\r\ncontent-length:\s*(\d+)', head, re.I)
+                body = await reader.readexactly(int(match.group(1)) if match else 0)
+                mode = self.outage()
+                if mode == 'hang':
+                    await reader.read()     # До таймаута и закрытия со стороны устройства
+                    break
+                st.requests += 1
+                if self.args.server_delay_ms:
+                    await asyncio.sleep(self.args.server_delay_ms / 1000.0)
+                if mode == '503':
+                    code, reply = 503, b'Service Unavailable'
+                else:
+                    code, reply = 200, b'OK'
+                    try:
+                        doc = json.loads(body)
+                        st.samples += len(doc['samples']) if 'samples' in doc else 1
+                        if 'samples' not in doc and 'Serial' not in doc['system']:
+                            raise KeyError('Serial')
+                    except (ValueError, KeyError, TypeError):
+                        st.invalid += 1
+                        code, reply = 400, b'Bad Request'
+                st.status[code] = st.status.get(code, 0) + 1
+                writer.write(b'HTTP/1.1 %d %s\r\nContent-Type: text/plain\r\n'
+                             b'Content-Length: %d\r\n\r\n%s' %
+                             (code, b'OK' if code == 200 else b'Error', len(reply), reply))
+                await writer.drain()
+        except (asyncio.IncompleteReadError, asyncio.LimitOverrunError, ConnectionError):
+            pass
+        finally:
+            st.open -= 1
+            self.writers.discard(writer)
+            writer.close()
+
+    async def listen(self):
+        self.server = await asyncio.start_server(self.handle, '127.0.0.1', self.args.port,
+                                                 reuse_address=True, backlog=4096)
+
+    async def run(self, ready, stop):
+        await self.listen()
+        ready.set()
+        while not stop.is_set():
+            down = self.outage() == 'refuse'
+            if down and self.server is not None:
+                # Сервер лежит: новые соединения отвергаются, открытые рвутся
+                self.server.close()
+                self.server = None
+                for writer in list(self.writers):
+                    writer.transport.abort()
+            elif not down and self.server is None:
+                await self.listen()
+            await asyncio.sleep(0.01)
+
+
+def collector_main(args, start, ready, stop, results):
+    raise_fd_limit()
+    collector = Collector(args, Clock(start, args.speed))
+    asyncio.run(collector.run(ready, stop))
+    results.put(vars(collector.stats))
+
+
+# ---------------------------------------------------------------------------
+# Устройства
+
+class FleetStats:
+    def __init__(self, bucket_s):
+        self.bucket_s = bucket_s
+        self.requests = 0
+        self.answered = 0
+        self.status = {}
+        self.failures = {}
+        self.connects = 0
+        self.reused = 0
+        self.retries = 0
+        self.http_bytes = 0         # Запросы и ответы целиком, в обе стороны
+        self.tcp_overhead = 0       # Оценка заголовков IP и TCP
+        self.payload_bytes = 0
+        self.latency_ms = []
+        self.taken = 0
+        self.delivered = 0
+        self.discarded = 0
+        self.dropped_ring = 0
+        self.timeline = {}
+        self.peak = {}
+
+    def bucket(self, t):
+        return self.timeline.setdefault(int(t // self.bucket_s), [0, 0, 0, []])
+
+    def record(self, t, latency_ms, failure, new_connection):
+        entry = self.bucket(t)
+        entry[0] += 1
+        entry[1] += new_connection
+        if failure:
+            entry[2] += 1
+        else:
+            entry[3].append(latency_ms)
+        second = int(t)
+        self.peak[second] = self.peak.get(second, 0) + 1
+
+
+class NotDelivered(Exception):
+    """Запрос не дошел до сервера: его можно повторить, как ERR_NOT_DELIVERED в tls_uplink."""
+
+
+class Transport:
+    """Отправка одного устройства: esp_http_client (close) или tls_uplink (keepalive)."""
+
+    def __init__(self, fleet):
+        self.fleet = fleet
+        self.reader = None
+        self.writer = None
+
+    def drop(self):
+        if self.writer is None:
+            return
+        if self.fleet.abort:
+            self.writer.transport.abort()
+        else:
+            self.writer.close()
+        self.reader = self.writer = None
+
+    async def exchange(self, request):
+        try:
+            self.writer.write(request)
+            await self.writer.drain()
+            first = await self.reader.readexactly(1)
+        except (ConnectionError, asyncio.IncompleteReadError):
+            raise NotDelivered()
+        head = first + await self.reader.readuntil(b'\r\n\r\n')
+        status = int(head.split(b' ', 2)[1])
+        match = re.search(rb'\r\ncontent-length:\s*(\d+)', head, re.I)
+        body = await self.reader.readexactly(int(match.group(1)) if match else 0)
+        keep = not re.search(rb'\r\nconnection:\s*close', head, re.I)
+        return status, len(head) + len(body), keep
+
+    async def attempt(self, request):
+        fleet = self.fleet
+        st = fleet.stats
+        new = self.writer is None
+        if new:
+            self.reader, self.writer = await asyncio.open_connection(fleet.host, fleet.port)
+            st.connects += 1
+            st.tcp_overhead += TCP_CONNECT_OVERHEAD
+        else:
+            st.reused += 1
+        st.http_bytes += len(request)
+        st.tcp_overhead += TCP_SEGMENT_OVERHEAD
+        status, received, keep = await self.exchange(request)
+        st.http_bytes += received
+        st.tcp_overhead += TCP_SEGMENT_OVERHEAD
+        if not keep or fleet.transport == 'close':
+            self.drop()
+        return status
+
+    async def post(self, body):
+        fleet = self.fleet
+        st = fleet.stats
+        # esp_http_client добавляет User-Agent, tls_uplink - нет
+        agent = b'User-Agent: %s\r\n' % USER_AGENT.encode() if fleet.transport == 'close' else b''
+        request = (b'POST %s HTTP/1.1\r\n%sHost: %s\r\n'
+                   b'Content-Type: application/json\r\nContent-Length: %d\r\n\r\n%s' %
+                   (fleet.path, agent, fleet.host_header, len(body), body))
+        started_at = fleet.clock.now()
+        started = time.monotonic()
+        st.requests += 1
+        st.payload_bytes += len(body)
+        # По открытому соединению - один повтор по новому, если запрос не дошел,
+        # как tls_uplink_post
+        if self.writer is not None and self.reader.at_eof():
+            self.drop()
+        attempts = 2 if self.writer is not None else 1
+        failure = None
+        new_connection = self.writer is None
+        for n in range(attempts):
+            if n:
+                st.retries += 1
+                new_connection = True
+            try:
+                status = await asyncio.wait_for(self.attempt(request), fleet.timeout)
+                latency = (time.monotonic() - started) * 1000.0
+                st.answered += 1
+                st.status[status] = st.status.get(status, 0) + 1
+                st.latency_ms.append(latency)
+                st.record(started_at, latency, None, new_connection)
+                return True
+            except NotDelivered:
+                failure = 'reset'
+                self.drop()
+                continue
+            except ConnectionRefusedError:
+                failure = 'refused'
+            except asyncio.TimeoutError:
+                failure = 'timeout'
+            except (ConnectionError, asyncio.IncompleteReadError, ValueError, IndexError):
+                failure = 'reset'
+            except OSError as e:
+                failure = 'local: ' + (e.strerror or str(e))
+            self.drop()
+            break
+        st.failures[failure] = st.failures.get(failure, 0) + 1
+        st.record(started_at, 0.0, failure, new_connection)
+        return False
+
+
+class SimDevice:
+    def __init__(self, fleet, index, rng):
+        self.fleet = fleet
+        self.rng = rng
+        mac = '5c:cf:7f:%02x:%02x:%02x' % (index >> 16 & 0xFF, index >> 8 & 0xFF, index & 0xFF)
+        self.strings = [b'Hydra-L-%05d' % index, fleet.akey, mac.encode(),
+                        b'10.%d.%d.%d' % (index >> 16 & 0xFF, index >> 8 & 0xFF, index & 0xFF),
+                        b'ok']
+        s = self.strings
+        self.info = DeviceInfo(s[0], s[1], rng.randint(-85, -45), s[2], s[3], s[4])
+        self.altitude = rng.randint(0, 500)
+        self.base_t = rng.uniform(5.0, 25.0)
+        self.base_h = rng.uniform(35.0, 80.0)
+        self.base_p = 1013.25 * math.exp(-self.altitude / 8434.0)
+        self.boot_at = rng.uniform(0.0, fleet.boot_spread)
+        self.reconnect = [rng.uniform(0.0, jitter) for _, _, jitter in fleet.wifi_outages]
+        # Пропадание питания и загрузка этого устройства
+        self.power = sorted((at, at + rng.uniform(0.0, spread)) for at, spread in fleet.power_cycles)
+        self.transport = Transport(fleet)
+        self.batch = Batch()
+        self.sample = Sample()
+
+    def online(self, t):
+        for (start, end, _), delay in zip(self.fleet.wifi_outages, self.reconnect):
+            if start <= t < end + delay:
+                return False
+        return True
+
+    def measure(self, uptime, t):
+        # Суточный ход и небольшой шум: длина чисел в JSON как у живой станции
+        day = math.sin(2.0 * math.pi * t / 86400.0)
+        s = self.sample
+        s.uptime_s = int(uptime)
+        s.temperature = round(self.base_t + 6.0 * day + self.rng.gauss(0, 0.1), 2)
+        s.humidity = round(min(100.0, max(0.0, self.base_h - 15.0 * day + self.rng.gauss(0, 0.5))), 2)
+        s.pressure = round(self.base_p + self.rng.gauss(0, 0.3), 2)
+        self.fleet.fw.derived(s.temperature, s.humidity, s.pressure, self.altitude, s.derived)
+        self.fleet.fw.push(ctypes.byref(self.batch), ctypes.byref(s))
+        self.fleet.stats.taken += 1
+
+    async def publish(self):
+        fleet = self.fleet
+        fw = fleet.fw
+        batch = self.batch
+        if fleet.encoding == 'post':
+            # send_data_to_server(): последнее измерение, при ответе буфер очищается
+            latest = batch.samples[(batch.head + batch.count - 1) % BATCH_MAX]
+            body = fw.encode_post(self.info, latest)
+            if body is not None and await self.transport.post(body):
+                fleet.stats.delivered += 1
+                fleet.stats.discarded += batch.count - 1
+                fw.consume(ctypes.byref(batch), batch.count)
+            return
+        # Пакеты как в publish_telemetry(), пока сервер отвечает
+        while batch.count > 0:
+            body, encoded = fw.encode_batch(self.info, batch, fleet.batch_samples)
+            if body is None or not await self.transport.post(body):
+                break
+            fleet.stats.delivered += encoded
+            fw.consume(ctypes.byref(batch), encoded)
+
+    async def run(self):
+        fleet = self.fleet
+        clock = fleet.clock
+        sample_s = fleet.sample_ms / 1000.0
+        boot_at = self.boot_at
+        while boot_at < fleet.duration:
+            # Загрузка: буфер в RAM пуст, соединение закрыто
+            self.transport.drop()
+            ctypes.memset(ctypes.byref(self.batch), 0, ctypes.sizeof(self.batch))
+            since_publish = 0
+            wake = boot_at
+            off, reboot = next((p for p in self.power if p[0] > boot_at), (None, None))
+            while wake < fleet.duration and (off is None or wake < off):
+                await clock.sleep_until(wake)
+                now = clock.now()
+                self.measure(wake - boot_at, now)
+                since_publish += fleet.sample_ms
+                if since_publish >= fleet.publish_ms and self.online(now):
+                    since_publish = 0
+                    await self.publish()
+                # vTaskDelayUntil: после долгой отправки пропущенные циклы идут подряд
+                wake += sample_s
+            fleet.stats.dropped_ring += self.batch.dropped
+            if reboot is None:
+                break
+            boot_at = reboot
+
+
+class Fleet:
+    def __init__(self, args, fw, clock):
+        self.fw = fw
+        self.clock = clock
+        self.duration = args.duration
+        self.sample_ms = args.sample_ms
+        self.publish_ms = args.publish_ms
+        self.timeout = args.timeout_ms / 1000.0 / args.speed
+        self.transport = args.transport
+        self.encoding = args.encoding
+        self.batch_samples = args.batch_samples
+        self.boot_spread = args.boot_spread if args.boot_spread is not None else args.publish_ms / 1000.0
+        self.wifi_outages = args.wifi_outage
+        self.power_cycles = args.power_cycle
+        self.abort = args.abort
+        self.akey = args.akey.encode()
+        url = urlsplit(args.url or 'http://127.0.0.1:%d/core/jsonadd.php' % args.port)
+        self.host = url.hostname
+        self.port = url.port or 80
+        self.host_header = url.netloc.encode()
+        self.path = (url.path or '/').encode()
+        self.stats = FleetStats(args.timeline or args.duration)
+
+
+async def monitor_lag(lags, stop):
+    """Задержка цикла событий эмулятора: насколько позже просыпается sleep(0.05)."""
+    while not stop.is_set():
+        started = time.monotonic()
+        await asyncio.sleep(0.05)
+        lags.append((time.monotonic() - started - 0.05) * 1000.0)
+
+
+async def run_fleet(args, fw, start):
+    clock = Clock(start, args.speed)
+    fleet = Fleet(args, fw, clock)
+    rng = random.Random(args.seed)
+    devices = [SimDevice(fleet, i, random.Random(rng.random())) for i in range(args.devices)]
+    lags = []
+    done = asyncio.Event()
+    lag_task = asyncio.create_task(monitor_lag(lags, done))
+    await asyncio.gather(*(d.run() for d in devices))
+    done.set()
+    await lag_task
+    for d in devices:
+        d.transport.drop()
+    return fleet.stats, sorted(lags)
+
+
+def raise_fd_limit():
+    soft, hard = resource.getrlimit(resource.RLIMIT_NOFILE)
+    if soft < hard:
+        resource.setrlimit(resource.RLIMIT_NOFILE, (hard, hard))
+
+
+# ---------------------------------------------------------------------------
+# Отчет
+
+def report(args, st, server, lags, elapsed):
+    duration = args.duration
+    per_day = 86400.0 / duration / args.devices
+    latency = sorted(st.latency_ms)
+    failed = sum(st.failures.values())
+    peak_second, peak = max(st.peak.items(), key=lambda kv: kv[1], default=(0, 0))
+    result = {
+        'devices': args.devices,
+        'duration_s': duration,
+        'speed': args.speed,
+        'elapsed_s': round(elapsed, 1),
+        'transport': args.transport,
+        'encoding': args.encoding,
+        'sample_ms': args.sample_ms,
+        'publish_ms': args.publish_ms,
+        'requests': st.requests,
+        'requests_per_s': round(st.requests / duration, 2),
+        'peak_requests_per_s': peak,
+        'peak_at_s': peak_second,
+        'answered': st.answered,
+        'status': {str(k): v for k, v in sorted(st.status.items())},
+        'failures': st.failures,
+        'connections': st.connects,
+        'connections_per_s': round(st.connects / duration, 2),
+        'connections_per_request': round(st.connects / max(st.requests, 1), 3),
+        'reused': st.reused,
+        'retries': st.retries,
+        'latency_ms': {name: round(percentile(latency, q), 2) for name, q in
+                       (('p50', 0.5), ('p90', 0.9), ('p99', 0.99), ('p999', 0.999),
+                        ('max', 1.0))},
+        'bytes_per_device_day': {
+            'payload': round(st.payload_bytes * per_day),
+            'http': round(st.http_bytes * per_day),
+            'tcp_ip_estimate': round((st.http_bytes + st.tcp_overhead) * per_day),
+        },
+        'samples': {'taken': st.taken, 'delivered': st.delivered,
+                    'discarded_unsent': st.discarded,
+                    'dropped_ring': st.dropped_ring},
+        'loop_lag_ms': {'p50': round(percentile(lags, 0.5), 2),
+                        'p99': round(percentile(lags, 0.99), 2)},
+    }
+    if server is not None:
+        result['server'] = server
+    if args.timeline:
+        result['timeline'] = []
+        for bucket in range(int(math.ceil(duration / args.timeline))):
+            requests, connects, failures, lat = st.timeline.get(bucket, (0, 0, 0, []))
+            lat.sort()
+            first = bucket * args.timeline
+            result['timeline'].append({
+                't_s': first, 'requests_per_s': round(requests / args.timeline, 2),
+                'peak_per_s': max(st.peak.get(t, 0) for t in range(first, first + args.timeline)),
+                'connections_per_s': round(connects / args.timeline, 2), 'failures': failures,
+                'p99_ms': round(percentile(lat, 0.99), 2)})
+
+    print('%d devices, %s/%s, %.0f s simulated in %.0f s (x%g)' %
+          (args.devices, args.transport, args.encoding, duration, elapsed, args.speed))
+    print('requests     %d, %.2f/s, peak %d/s at %d s; answered %d %s, failed %d %s' %
+          (st.requests, result['requests_per_s'], peak, peak_second, st.answered,
+           result['status'], failed, st.failures or ''))
+    print('connections  %d, %.2f/s, %.3f per request; reused %d, retries %d' %
+          (st.connects, result['connections_per_s'], result['connections_per_request'],
+           st.reused, st.retries))
+    print('latency ms   p50 %(p50).2f  p90 %(p90).2f  p99 %(p99).2f  p99.9 %(p999).2f  max %(max).2f'
+          % result['latency_ms'])
+    b = result['bytes_per_device_day']
+    print('per device   %.1f KB/day payload, %.1f KB/day HTTP, ~%.1f KB/day TCP/IP' %
+          (b['payload'] / 1024.0, b['http'] / 1024.0, b['tcp_ip_estimate'] / 1024.0))
+    s = result['samples']
+    print('samples      taken %d, delivered %d (%.1f%%), discarded unsent %d, ring overflow %d' %
+          (s['taken'], s['delivered'], 100.0 * s['delivered'] / max(s['taken'], 1),
+           s['discarded_unsent'], s['dropped_ring']))
+    if server is not None:
+        print('collector    %d connections (peak %d open, %d idle-closed), %d requests, '
+              '%d samples, %d invalid' %
+              (server['connections'], server['open_peak'], server['idle_closed'],
+               server['requests'], server['samples'], server['invalid']))
+    print('loop lag ms  p50 %(p50).2f  p99 %(p99).2f' % result['loop_lag_ms'])
+    if result['loop_lag_ms']['p99'] > LAG_WARN_MS:
+        print('warning: эмулятор не успевает, задержка ответа завышена', file=sys.stderr)
+    if args.timeline:
+        print('\n%8s %9s %7s %9s %8s %9s' % ('t_s', 'req/s', 'peak/s', 'conn/s', 'failed', 'p99_ms'))
+        for row in result['timeline']:
+            print('%(t_s)8d %(requests_per_s)9.2f %(peak_per_s)7d %(connections_per_s)9.2f '
+                  '%(failures)8d %(p99_ms)9.2f' % row)
+    if args.json:
+        with open(args.json, 'w') as f:
+            json.dump(result, f, indent=1)
+        print('report written to %s' % args.json)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__.splitlines()[0],
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog='\n'.join(__doc__.splitlines()[1:]))
+    parser.add_argument('--devices', type=int, default=1000)
+    parser.add_argument('--duration', type=float, default=3600.0, help='время эмуляции (с)')
+    parser.add_argument('--speed', type=float, default=1.0,
+                        help='ускорение времени устройств относительно реального')
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('--transport', choices=('close', 'keepalive'), default='close')
+    parser.add_argument('--encoding', choices=('post', 'batch'), default='post')
+    parser.add_argument('--sample-ms', type=int,
+                        default=firmware_define('main/main.c', 'TELEMETRY_SAMPLE_MS'))
+    parser.add_argument('--publish-ms', type=int,
+                        default=firmware_define('main/main.c', 'TELEMETRY_PUBLISH_MS'))
+    parser.add_argument('--batch-samples', type=int,
+                        default=firmware_define('main/main.c', 'MQTT_BATCH_SAMPLES'),
+                        help='измерений в пакете для --encoding batch')
+    parser.add_argument('--timeout-ms', type=int,
+                        default=firmware_define('components/tls_uplink/include/tls_uplink.h',
+                                                'TLS_UPLINK_TIMEOUT_MS'))
+    parser.add_argument('--boot-spread', type=float,
+                        help='устройства включаются в течение стольких секунд '
+                             '(по умолчанию - период отправки)')
+    parser.add_argument('--akey', default='default_key')
+    parser.add_argument('--outage', type=lambda s: parse_scenario(s, 'outage'), action='append',
+                        default=[], help='START:DURATION[:refuse|hang|503]')
+    parser.add_argument('--wifi-outage', type=lambda s: parse_scenario(s, 'wifi'), action='append',
+                        default=[], help='START:DURATION[:RECONNECT_SPREAD]')
+    parser.add_argument('--power-cycle', type=lambda s: parse_scenario(s, 'power'), action='append',
+                        default=[], help='AT[:BOOT_SPREAD]')
+    parser.add_argument('--url', help='внешний сервер вместо локальной замены (без --outage)')
+    parser.add_argument('--port', type=int, default=8080, help='порт локальной замены jsonadd.php')
+    parser.add_argument('--idle-timeout', type=float, default=5.0,
+                        help='сервер закрывает простаивающее соединение (с эмуляции; '
+                             'как KeepAliveTimeout Apache)')
+    parser.add_argument('--server-delay-ms', type=float, default=0.0,
+                        help='время обработки запроса сервером (реальные мс)')
+    parser.add_argument('--abort', action='store_true',
+                        help='закрывать соединения RST вместо FIN (без TIME_WAIT у эмулятора)')
+    parser.add_argument('--timeline', type=int, help='печатать нагрузку по интервалам (с эмуляции)')
+    parser.add_argument('--json', help='сохранить отчет в JSON')
+    parser.add_argument('--lib-dir', default=os.path.join(ROOT, 'build', 'fleet_sim'),
+                        help='каталог для libtelemetry.so')
+    args = parser.parse_args()
+    if args.url and args.outage:
+        parser.error('--outage работает только с локальной заменой jsonadd.php')
+
+    fw = Firmware(build_library(args.lib_dir))
+    fw.self_test()
+    raise_fd_limit()
+
+    # Общая точка отсчета времени для эмулятора и сервера (CLOCK_MONOTONIC)
+    start = time.monotonic() + 0.5
+    server = None
+    if not args.url:
+        ready, stop = multiprocessing.Event(), multiprocessing.Event()
+        results = multiprocessing.Queue()
+        server = multiprocessing.Process(target=collector_main,
+                                         args=(args, start, ready, stop, results), daemon=True)
+        server.start()
+        if not ready.wait(10):
+            sys.exit('локальная замена jsonadd.php не запустилась')
+
+    began = time.monotonic()
+    try:
+        stats, lags = asyncio.run(run_fleet(args, fw, start))
+    except KeyboardInterrupt:
+        sys.exit(1)
+    elapsed = time.monotonic() - began
+
+    collector = None
+    if server is not None:
+        stop.set()
+        collector = results.get(timeout=10)
+        server.join(5)
+    report(args, stats, collector, lags, elapsed)
+
+
+if __name__ == '__main__':
+    main()
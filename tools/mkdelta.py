@@ -0,0 +1,217 @@
+#!/usr/bin/env python3
+"""Генератор дельта-патчей HDP1 для OTA обновления Hydra-L.
+
+Строит патч между двумя сборками проекта hydra_l (build/hydra_l.bin) в формате,
+описанном в components/delta/include/delta.h, и рядом кладет "<патч>.sha256"
+с хешем нового образа - его проверяет устройство после применения патча.
+
+Пример:
+    python3 tools/mkdelta.py old/hydra_l.bin build/hydra_l.bin -o hydra-l.delta
+    python3 tools/ota_server.py hydra-l.delta
+"""
+import argparse
+import hashlib
+import struct
+import sys
+import time
+
+MAGIC = b'HDP1'
+OP_END, OP_COPY, OP_ADD, OP_INSERT = 0, 1, 2, 3
+
+BLOCK = 8           # длина ключа для поиска совпадений в старом образе
+MAX_CANDIDATES = 8  # сколько позиций на ключ проверять
+MIN_MATCH = 12      # минимальная точная длина совпадения для COPY/ADD
+
+
+def varint(value):
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+def zigzag(value):
+    return (value << 1) if value >= 0 else ((-value << 1) - 1)
+
+
+def build_index(old):
+    index = {}
+    for pos in range(0, len(old) - BLOCK + 1):
+        key = old[pos:pos + BLOCK]
+        slot = index.get(key)
+        if slot is None:
+            index[key] = [pos]
+        elif len(slot) < MAX_CANDIDATES:
+            slot.append(pos)
+    return index
+
+
+def exact_len(old, new, src, dst):
+    n = 0
+    limit = min(len(old) - src, len(new) - dst)
+    while n < limit and old[src + n] == new[dst + n]:
+        n += 1
+    return n
+
+
+def extend_approx(old, new, src, dst):
+    """Расширение выравнивания как в bsdiff: максимум (2 * совпадения - длина)."""
+    limit = min(len(old) - src, len(new) - dst)
+    score, best_score, best_len = 0, 0, 0
+    for n in range(limit):
+        score += 1 if old[src + n] == new[dst + n] else -1
+        if score > best_score:
+            best_score, best_len = score, n + 1
+        elif score < best_score - 64:
+            break
+    return best_len
+
+
+def diff_ops(old, new):
+    """Последовательность команд COPY/ADD/INSERT."""
+    index = build_index(old)
+    ops = bytearray()
+    src_pos = 0
+    literal = bytearray()
+    dst = 0
+    last_src = 0
+
+    def flush_literal():
+        if literal:
+            ops.extend(bytes([OP_INSERT]) + varint(len(literal)) + literal)
+            literal.clear()
+
+    while dst < len(new):
+        best_src, best_len = -1, 0
+        candidates = [last_src] if last_src < len(old) else []
+        candidates += index.get(new[dst:dst + BLOCK], [])
+        for cand in candidates:
+            n = exact_len(old, new, cand, dst)
+            if n > best_len:
+                best_src, best_len = cand, n
+
+        if best_len < MIN_MATCH:
+            literal.append(new[dst])
+            dst += 1
+            last_src += 1
+            continue
+
+        flush_literal()
+        length = max(best_len, extend_approx(old, new, best_src, dst))
+        diff = bytes((new[dst + i] - old[best_src + i]) & 0xFF for i in range(length))
+        header = varint(zigzag(best_src - src_pos)) + varint(length)
+        if any(diff):
+            ops.extend(bytes([OP_ADD]) + header + diff)
+        else:
+            ops.extend(bytes([OP_COPY]) + header)
+        src_pos = best_src + length
+        last_src = src_pos
+        dst += length
+
+    flush_literal()
+    ops.append(OP_END)
+    return bytes(ops)
+
+
+class BitWriter:
+    def __init__(self):
+        self.out = bytearray()
+        self.acc = 0
+        self.count = 0
+
+    def write(self, value, bits):
+        self.acc = (self.acc << bits) | value
+        self.count += bits
+        while self.count >= 8:
+            self.count -= 8
+            self.out.append((self.acc >> self.count) & 0xFF)
+        self.acc &= (1 << self.count) - 1
+
+    def finish(self):
+        if self.count:
+            self.out.append((self.acc << (8 - self.count)) & 0xFF)
+        return bytes(self.out)
+
+
+def lzss(data, window_bits, length_bits):
+    window = 1 << window_bits
+    max_len = (1 << length_bits) + 2
+    chains = {}
+    writer = BitWriter()
+    pos = 0
+    while pos < len(data):
+        best_len, best_dist = 0, 0
+        key = data[pos:pos + 3]
+        if len(key) == 3:
+            for cand in reversed(chains.get(key, ())):
+                dist = pos - cand
+                if dist > window:
+                    break
+                n = 3
+                limit = min(max_len, len(data) - pos)
+                while n < limit and data[cand + n] == data[pos + n]:
+                    n += 1
+                if n > best_len:
+                    best_len, best_dist = n, dist
+                    if n == limit:
+                        break
+
+        step = best_len if best_len >= 3 else 1
+        if best_len >= 3:
+            writer.write(0, 1)
+            writer.write(best_dist - 1, window_bits)
+            writer.write(best_len - 3, length_bits)
+        else:
+            writer.write(1, 1)
+            writer.write(data[pos], 8)
+
+        for p in range(pos, pos + step):
+            k = data[p:p + 3]
+            if len(k) == 3:
+                chain = chains.setdefault(k, [])
+                chain.append(p)
+                if len(chain) > 16:
+                    del chain[0]
+        pos += step
+    return writer.finish()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('old', help='текущий образ на устройствах')
+    parser.add_argument('new', help='новый образ')
+    parser.add_argument('-o', '--output', required=True, help='файл патча')
+    parser.add_argument('--window-bits', type=int, default=10, choices=range(4, 11))
+    parser.add_argument('--length-bits', type=int, default=7, choices=range(2, 9))
+    args = parser.parse_args()
+
+    with open(args.old, 'rb') as f:
+        old = f.read()
+    with open(args.new, 'rb') as f:
+        new = f.read()
+
+    started = time.time()
+    ops = diff_ops(old, new)
+    body = lzss(ops, args.window_bits, args.length_bits)
+    header = MAGIC + struct.pack('<II', len(old), len(new)) + hashlib.sha256(old).digest()
+    header += bytes([args.window_bits, args.length_bits])
+
+    with open(args.output, 'wb') as f:
+        f.write(header + body)
+    with open(args.output + '.sha256', 'w') as f:
+        f.write(hashlib.sha256(new).hexdigest() + '\n')
+
+    patch_size = len(header) + len(body)
+    print('old %d bytes, new %d bytes' % (len(old), len(new)), file=sys.stderr)
+    print('ops %d bytes, patch %d bytes (%.1f%% of new image), %.1f s' %
+          (len(ops), patch_size, 100.0 * patch_size / max(len(new), 1), time.time() - started),
+          file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
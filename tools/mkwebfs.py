@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+"""Сборка панели управления Hydra-L в образ SPIFFS.
+
+Берет файлы из каталога web/, добавляет хеш содержимого в имена ресурсов
+(app.js -> app.1a2b3c4d.js) и переписывает ссылки в index.html, сжимает
+все gzip и кладет в <staging>/www/<имя>.gz. Устройство отдает их как есть
+с Content-Encoding: gzip; ресурсы с хешем кэшируются браузером навсегда.
+
+Образ SPIFFS заменяет весь раздел storage, поэтому CA сервера для https://
+нужно передать через --ca. Настройки устройства хранятся в NVS и образом не
+затрагиваются; --config кладет config.txt, который прошивка переносит в NVS
+при первом старте (для новых устройств и обновления со старых прошивок).
+Образ собирается spiffsgen.py из SDK.
+
+Пример:
+    python3 tools/mkwebfs.py web build/webfs --image build/storage.bin
+    esptool.py --chip esp8266 write_flash 0x200000 build/storage.bin
+"""
+import argparse
+import gzip
+import hashlib
+import os
+import re
+import shutil
+import subprocess
+import sys
+
+INDEX = 'index.html'
+PARTITION_SIZE = 0x100000   # Раздел storage в partitions.csv
+SPIFFS_NAME_MAX = 31        # CONFIG_SPIFFS_OBJ_NAME_LEN - 1
+
+
+def compress(data):
+    # mtime=0: одинаковые исходники дают одинаковый образ
+    return gzip.compress(data, compresslevel=9, mtime=0)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('source', help='каталог с исходниками панели (web/)')
+    parser.add_argument('staging', help='каталог для содержимого образа')
+    parser.add_argument('--config', help='config.txt для переноса в NVS при первом старте')
+    parser.add_argument('--ca', help='сертификат CA сервера телеметрии (PEM) для ca.pem')
+    parser.add_argument('--image', help='собрать образ SPIFFS в этот файл')
+    parser.add_argument('--size', type=lambda v: int(v, 0), default=PARTITION_SIZE,
+                        help='размер раздела (по умолчанию 0x%x)' % PARTITION_SIZE)
+    args = parser.parse_args()
+
+    if os.path.isdir(args.staging):
+        shutil.rmtree(args.staging)
+    www = os.path.join(args.staging, 'www')
+    os.makedirs(www)
+
+    # Ресурсы получают имя с хешем, index.html остается по постоянному адресу
+    names = {}
+    files = {}
+    for name in sorted(os.listdir(args.source)):
+        path = os.path.join(args.source, name)
+        if not os.path.isfile(path) or name.startswith('.'):
+            continue
+        with open(path, 'rb') as f:
+            data = f.read()
+        if name != INDEX:
+            stem, ext = os.path.splitext(name)
+            digest = hashlib.sha256(data).hexdigest()[:8]
+            names[name] = '%s.%s%s' % (stem, digest, ext)
+        files[name] = data
+
+    if INDEX not in files:
+        sys.exit('%s: нет %s' % (args.source, INDEX))
+    index = files[INDEX].decode('utf-8')
+    for name, hashed in names.items():
+        index, count = re.subn(r'(["\'/])%s(["\'?#])' % re.escape(name),
+                               r'\g<1>%s\g<2>' % hashed, index)
+        if count == 0:
+            print('warning: %s не упоминается в %s' % (name, INDEX), file=sys.stderr)
+    files[INDEX] = index.encode('utf-8')
+
+    total_raw = total_gz = 0
+    print('%-28s %8s %8s %6s' % ('file', 'bytes', 'gzip', 'ratio'))
+    for name, data in files.items():
+        target = names.get(name, name) + '.gz'
+        if len('/www/' + target) > SPIFFS_NAME_MAX:
+            sys.exit('%s: имя длиннее %d символов для SPIFFS' % (target, SPIFFS_NAME_MAX))
+        packed = compress(data)
+        with open(os.path.join(www, target), 'wb') as f:
+            f.write(packed)
+        total_raw += len(data)
+        total_gz += len(packed)
+        print('%-28s %8d %8d %5.0f%%' % ('www/' + target, len(data), len(packed),
+                                        100.0 * len(packed) / len(data)))
+    print('%-28s %8d %8d %5.0f%%' % ('total', total_raw, total_gz, 100.0 * total_gz / total_raw))
+
+    if args.config:
+        shutil.copy(args.config, os.path.join(args.staging, 'config.txt'))
+    if args.ca:
+        with open(args.ca, 'rb') as f:
+            if b'-----BEGIN CERTIFICATE-----' not in f.read():
+                sys.exit('%s: нет сертификата в формате PEM' % args.ca)
+        shutil.copy(args.ca, os.path.join(args.staging, 'ca.pem'))
+
+    if args.image:
+        spiffsgen = os.path.join(os.environ.get('IDF_PATH', ''),
+                                 'components', 'spiffs', 'spiffsgen.py')
+        if not os.path.exists(spiffsgen):
+            sys.exit('%s не найден, проверьте IDF_PATH' % spiffsgen)
+        subprocess.check_call([sys.executable, spiffsgen, hex(args.size),
+                               args.staging, args.image])
+        print('image %s (%d bytes)' % (args.image, args.size))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+"""Локальный HTTP сервер для проверки OTA обновления Hydra-L.
+
+Отдает образ прошивки с поддержкой Range запросов и файл "<образ>.sha256".
+Для дельта-патча берется готовый "<патч>.sha256" от tools/mkdelta.py.
+Опция --drop-after обрывает первые соединения после указанного числа байт,
+чтобы проверить возобновление загрузки.
+
+Пример:
+    python3 tools/ota_server.py build/hydra_l.bin --port 8070 --drop-after 200000
+    curl -X POST http://192.168.4.1/ota -H "X-Akey: <akey>" -d "http://<host>:8070/hydra-l.bin"
+"""
+import argparse
+import hashlib
+import http.server
+import os
+import re
+import time
+
+
+class OtaHandler(http.server.BaseHTTPRequestHandler):
+    image = b''
+    digest = ''
+    drop_after = 0
+    drops_left = 0
+
+    def do_GET(self):
+        if self.path.endswith('.sha256'):
+            body = (self.digest + '\n').encode()
+            self.send_response(200)
+            self.send_header('Content-Length', str(len(body)))
+            self.end_headers()
+            self.wfile.write(body)
+            return
+
+        start = 0
+        match = re.match(r'bytes=(\d+)-', self.headers.get('Range', ''))
+        if match:
+            start = int(match.group(1))
+            self.send_response(206)
+            self.send_header('Content-Range', 'bytes %d-%d/%d' %
+                             (start, len(self.image) - 1, len(self.image)))
+        else:
+            self.send_response(200)
+        self.send_header('Content-Length', str(len(self.image) - start))
+        self.end_headers()
+
+        body = self.image[start:]
+        if OtaHandler.drops_left > 0:
+            OtaHandler.drops_left -= 1
+            body = body[:self.drop_after]
+            self.log_message('dropping connection after %d bytes', len(body))
+
+        began = time.time()
+        self.wfile.write(body)
+        elapsed = max(time.time() - began, 1e-6)
+        self.log_message('sent %d bytes from offset %d (%.1f KB/s)',
+                         len(body), start, len(body) / elapsed / 1024)
+        if len(body) < len(self.image) - start:
+            self.close_connection = True
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('image', help='файл образа прошивки (.bin)')
+    parser.add_argument('--port', type=int, default=8070)
+    parser.add_argument('--drop-after', type=int, default=0,
+                        help='обрывать соединение после N байт')
+    parser.add_argument('--drops', type=int, default=1,
+                        help='сколько соединений оборвать')
+    args = parser.parse_args()
+
+    with open(args.image, 'rb') as f:
+        OtaHandler.image = f.read()
+    if os.path.exists(args.image + '.sha256'):
+        with open(args.image + '.sha256') as f:
+            OtaHandler.digest = f.read().split()[0]
+    else:
+        OtaHandler.digest = hashlib.sha256(OtaHandler.image).hexdigest()
+    OtaHandler.drop_after = args.drop_after
+    OtaHandler.drops_left = args.drops if args.drop_after > 0 else 0
+
+    print('Serving %s (%d bytes, sha256 %s) on port %d' %
+          (os.path.basename(args.image), len(OtaHandler.image), OtaHandler.digest, args.port))
+    http.server.ThreadingHTTPServer(('', args.port), OtaHandler).serve_forever()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+"""Локальная замена jsonadd.php по HTTPS для проверки TLS канала Hydra-L.
+
+Принимает POST по HTTP/1.1 с keep-alive, отвечает 200 и печатает тело.
+Для каждого соединения пишет версию TLS, набор шифров и session_reused -
+было ли рукопожатие возобновлением сессии (билет или session ID).
+Только TLS 1.2: mbedTLS в SDK ESP8266 не поддерживает TLS 1.3.
+
+Без --cert генерирует самоподписанный сертификат ECDSA P-256 (через
+openssl) на имя или адрес из --name; он же служит CA для устройства и
+кладется в образ SPIFFS как ca.pem (tools/mkwebfs.py --ca).
+
+--idle-timeout закрывает простаивающие соединения раньше интервала
+отправки, чтобы каждое подключение было возобновлением; --no-tickets
+оставляет только возобновление по session ID.
+
+Пример:
+    python3 tools/tls_server.py --name 192.168.1.10 --dir build/tls --idle-timeout 30
+    python3 tools/mkwebfs.py web build/webfs --ca build/tls/ca.pem --image build/storage.bin
+    curl -X PATCH http://192.168.4.1/config -H "X-Akey: <akey>" \\
+        -d '{"server_url":"https://192.168.1.10:8443/core/jsonadd.php"}'
+"""
+import argparse
+import http.server
+import ipaddress
+import os
+import socketserver
+import ssl
+import subprocess
+import sys
+import threading
+
+
+class Stats:
+    lock = threading.Lock()
+    connections = 0
+    resumed = 0
+    requests = 0
+
+
+class UplinkHandler(http.server.BaseHTTPRequestHandler):
+    protocol_version = 'HTTP/1.1'
+    idle_timeout = None
+
+    def setup(self):
+        super().setup()
+        if self.idle_timeout:
+            self.connection.settimeout(self.idle_timeout)
+        reused = self.connection.session_reused
+        with Stats.lock:
+            Stats.connections += 1
+            Stats.resumed += reused
+        self.log_message('%s %s session_reused=%s (%d of %d connections resumed)',
+                         self.connection.version(), self.connection.cipher()[0], reused,
+                         Stats.resumed, Stats.connections)
+
+    def do_POST(self):
+        length = int(self.headers.get('Content-Length', 0))
+        body = self.rfile.read(length)
+        with Stats.lock:
+            Stats.requests += 1
+        self.log_message('POST %s %d bytes: %s', self.path, length,
+                         body.decode('utf-8', 'replace'))
+        reply = b'OK'
+        self.send_response(200)
+        self.send_header('Content-Type', 'text/plain')
+        self.send_header('Content-Length', str(len(reply)))
+        self.end_headers()
+        self.wfile.write(reply)
+
+    def handle_one_request(self):
+        try:
+            super().handle_one_request()
+        except (TimeoutError, ConnectionError, ssl.SSLError):
+            # Простой дольше --idle-timeout или обрыв со стороны устройства
+            self.close_connection = True
+
+
+class TlsServer(socketserver.ThreadingMixIn, http.server.HTTPServer):
+    daemon_threads = True
+
+    def __init__(self, address, context):
+        super().__init__(address, UplinkHandler)
+        self.context = context
+
+    def get_request(self):
+        sock, addr = super().get_request()
+        sock.settimeout(10)
+        try:
+            tls = self.context.wrap_socket(sock, server_side=True)
+        except (ssl.SSLError, OSError) as e:
+            sock.close()
+            print('handshake with %s failed: %s' % (addr[0], e), file=sys.stderr)
+            raise
+        return tls, addr
+
+
+def generate(name, directory):
+    """Самоподписанный сертификат ECDSA P-256 (он же CA) для имени или IP."""
+    os.makedirs(directory, exist_ok=True)
+    cert = os.path.join(directory, 'ca.pem')
+    key = os.path.join(directory, 'key.pem')
+    if os.path.exists(cert) and os.path.exists(key):
+        return cert, key
+    try:
+        ipaddress.ip_address(name)
+        san = 'IP:' + name
+    except ValueError:
+        san = 'DNS:' + name
+    subprocess.check_call([
+        'openssl', 'req', '-x509', '-newkey', 'ec', '-pkeyopt', 'ec_paramgen_curve:prime256v1',
+        '-nodes', '-days', '3650', '-subj', '/CN=' + name,
+        '-addext', 'subjectAltName=' + san,
+        '-addext', 'basicConstraints=critical,CA:TRUE',
+        '-keyout', key, '-out', cert], stderr=subprocess.DEVNULL)
+    print('generated %s for %s' % (cert, name))
+    return cert, key
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--port', type=int, default=8443)
+    parser.add_argument('--cert', help='сертификат сервера (PEM)')
+    parser.add_argument('--key', help='ключ сервера (PEM)')
+    parser.add_argument('--name', default='localhost',
+                        help='имя или IP сервера для сгенерированного сертификата')
+    parser.add_argument('--dir', default='tls', help='каталог для сгенерированных ca.pem и key.pem')
+    parser.add_argument('--idle-timeout', type=float,
+                        help='закрывать соединение после стольких секунд простоя')
+    parser.add_argument('--no-tickets', action='store_true',
+                        help='не выдавать билеты (возобновление только по session ID)')
+    args = parser.parse_args()
+
+    if args.cert:
+        cert, key = args.cert, args.key or args.cert
+    else:
+        cert, key = generate(args.name, args.dir)
+
+    context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    context.minimum_version = ssl.TLSVersion.TLSv1_2
+    context.maximum_version = ssl.TLSVersion.TLSv1_2
+    context.load_cert_chain(cert, key)
+    if args.no_tickets:
+        context.options |= ssl.OP_NO_TICKET
+
+    UplinkHandler.idle_timeout = args.idle_timeout
+    server = TlsServer(('', args.port), context)
+    print('listening on https://0.0.0.0:%d (CA %s)' % (args.port, cert))
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        print('\n%d connections, %d resumed, %d requests' %
+              (Stats.connections, Stats.resumed, Stats.requests))
+
+
+if __name__ == '__main__':
+    main()
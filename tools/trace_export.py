@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+"""Экспорт трассы исполнения Hydra-L (components/trace) в формат Chrome trace.
+
+Читает двоичную выгрузку "/trace" и пишет JSON для chrome://tracing или
+ui.perfetto.dev: дорожка "CPU" показывает, какая задача владела процессором,
+дорожки задач - участки I2C, обработчиков веб-сервера и отправки телеметрии.
+В stderr выводится сводка: доля CPU задач и длительность участков.
+
+Номера маршрутов веб-сервера совпадают с порядком объекта "handlers" в
+/getStats; если передать сохраненный ответ через --stats, участки будут
+подписаны адресами.
+
+Пример:
+    curl -o trace.bin http://192.168.4.1/trace
+    curl -o stats.json http://192.168.4.1/getStats
+    python3 tools/trace_export.py trace.bin --stats stats.json -o trace.json
+"""
+import argparse
+import json
+import struct
+import sys
+
+MAGIC = 0x31435254
+HEADER = struct.Struct('<IIIIBBBB')
+TASK = struct.Struct('<16sQII')
+EVENT = struct.Struct('<IBBH')
+EV_SWITCH, EV_BEGIN, EV_END = 0, 1, 2
+MARK_I2C, MARK_HTTPD, MARK_UPLINK = 0, 1, 2
+UPLINKS = {0: 'http', 1: 'mqtt', 2: 'beacon'}
+I2C_DEVICES = {0x76: 'bme280', 0x77: 'bme280'}
+
+
+def marker_name(arg, routes):
+    marker, detail = arg & 0xFF, arg >> 8
+    if marker == MARK_I2C:
+        if detail in I2C_DEVICES:
+            return 'i2c %s' % I2C_DEVICES[detail]
+        # Дисплеи на PCF8574 (0x20-0x27) и PCF8574A (0x38-0x3F)
+        if 0x20 <= detail <= 0x27 or 0x38 <= detail <= 0x3F:
+            return 'i2c lcd 0x%02x' % detail
+        return 'i2c 0x%02x' % detail
+    if marker == MARK_HTTPD:
+        return routes[detail] if detail < len(routes) else 'httpd #%d' % detail
+    if marker == MARK_UPLINK:
+        return 'uplink %s' % UPLINKS.get(detail, detail)
+    return 'marker %d/%d' % (marker, detail)
+
+
+def read_dump(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    magic, cpu_hz, total, count, ntasks, event_size, task_size, _ = HEADER.unpack_from(data, 0)
+    if magic != MAGIC or event_size != EVENT.size or task_size != TASK.size:
+        sys.exit('%s: неизвестный формат выгрузки' % path)
+    offset = HEADER.size
+    tasks = []
+    for _ in range(ntasks):
+        name, cycles, switches, _ = TASK.unpack_from(data, offset)
+        tasks.append((name.split(b'\0')[0].decode('utf-8', 'replace'), cycles, switches))
+        offset += TASK.size
+    events = []
+    if len(data) < offset + count * EVENT.size:
+        count = (len(data) - offset) // EVENT.size
+        print('warning: выгрузка обрезана, событий: %d' % count, file=sys.stderr)
+    for _ in range(count):
+        events.append(EVENT.unpack_from(data, offset))
+        offset += EVENT.size
+    return cpu_hz, total, tasks, events
+
+
+def unwrap(events):
+    """Счетчик тактов 32-битный: переполнения восстанавливаются по порядку событий."""
+    base, prev, out = 0, None, []
+    for cycles, kind, task, arg in events:
+        if prev is not None and cycles < prev:
+            base += 1 << 32
+        prev = cycles
+        out.append((base + cycles, kind, task, arg))
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('dump', help='выгрузка /trace')
+    parser.add_argument('-o', '--output', help='файл JSON (по умолчанию stdout)')
+    parser.add_argument('--stats', help='сохраненный ответ /getStats для имен маршрутов')
+    args = parser.parse_args()
+
+    cpu_hz, total, tasks, events = read_dump(args.dump)
+    routes = []
+    if args.stats:
+        with open(args.stats) as f:
+            routes = list(json.load(f).get('handlers', {}))
+    if not events:
+        sys.exit('в буфере нет событий')
+
+    events = unwrap(events)
+    start = events[0][0]
+    end = events[-1][0]
+
+    def us(cycles):
+        return (cycles - start) * 1e6 / cpu_hz
+
+    def task_name(index):
+        return tasks[index][0] if index < len(tasks) else 'task %d' % index
+
+    trace = [{'ph': 'M', 'pid': 1, 'name': 'process_name', 'args': {'name': 'Hydra-L'}},
+             {'ph': 'M', 'pid': 1, 'tid': 0, 'name': 'thread_name', 'args': {'name': 'CPU'}}]
+    for i in range(len(tasks)):
+        trace.append({'ph': 'M', 'pid': 1, 'tid': i + 1, 'name': 'thread_name',
+                      'args': {'name': task_name(i)}})
+
+    # Владелец CPU: интервалы между переключениями
+    running, since = None, start
+    busy = {}
+    open_marks = {}
+    spans = {}
+    for cycles, kind, task, arg in events:
+        if kind == EV_SWITCH:
+            if running is not None:
+                trace.append({'ph': 'X', 'pid': 1, 'tid': 0, 'name': task_name(running),
+                              'ts': us(since), 'dur': us(cycles) - us(since)})
+                busy[running] = busy.get(running, 0) + cycles - since
+            running, since = task, cycles
+        elif kind == EV_BEGIN:
+            open_marks[(task, arg)] = cycles
+            trace.append({'ph': 'B', 'pid': 1, 'tid': task + 1, 'ts': us(cycles),
+                          'name': marker_name(arg, routes)})
+        elif kind == EV_END and (task, arg) in open_marks:
+            began = open_marks.pop((task, arg))
+            trace.append({'ph': 'E', 'pid': 1, 'tid': task + 1, 'ts': us(cycles),
+                          'name': marker_name(arg, routes)})
+            spans.setdefault(marker_name(arg, routes), []).append(cycles - began)
+    if running is not None:
+        busy[running] = busy.get(running, 0) + end - since
+    # Участки, не закрытые до конца буфера
+    for (task, arg) in open_marks:
+        trace.append({'ph': 'E', 'pid': 1, 'tid': task + 1, 'ts': us(end),
+                      'name': marker_name(arg, routes)})
+
+    out = open(args.output, 'w') if args.output else sys.stdout
+    json.dump({'traceEvents': trace, 'displayTimeUnit': 'ms'}, out)
+    if args.output:
+        out.close()
+
+    window = end - start
+    print('%d events (%d since clear), window %.1f ms at %d MHz' %
+          (len(events), total, window * 1e3 / cpu_hz, cpu_hz // 1000000), file=sys.stderr)
+    print('\n%-16s %8s %10s %8s' % ('task', 'trace %', 'total %', 'switches'), file=sys.stderr)
+    overall = sum(cycles for _, cycles, _ in tasks) or 1
+    for i, (name, cycles, switches) in enumerate(tasks):
+        share = 100.0 * busy.get(i, 0) / window if window else 0
+        print('%-16s %8.1f %10.1f %8d' % (name, share, 100.0 * cycles / overall, switches),
+              file=sys.stderr)
+    if spans:
+        print('\n%-24s %6s %10s %10s' % ('span', 'count', 'avg us', 'max us'), file=sys.stderr)
+        for name, durations in sorted(spans.items()):
+            print('%-24s %6d %10.1f %10.1f' %
+                  (name, len(durations), sum(durations) * 1e6 / cpu_hz / len(durations),
+                   max(durations) * 1e6 / cpu_hz), file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,80 @@
+'use strict';
+
+const FIELDS = {
+  temperature: 1, humidity: 1, pressure: 1, dew_point: 1,
+  abs_humidity: 2, heat_index: 1, sea_level_pressure: 1,
+};
+const POLL_MS = 5000;
+
+const $ = (id) => document.getElementById(id);
+
+function setStatus(online) {
+  const el = $('status');
+  el.textContent = online ? 'в сети' : 'нет связи';
+  el.classList.toggle('online', online);
+}
+
+function row(name, value) {
+  const tr = document.createElement('tr');
+  for (const text of [name, value]) {
+    const td = document.createElement('td');
+    td.textContent = text;
+    tr.appendChild(td);
+  }
+  return tr;
+}
+
+async function getJson(url) {
+  const res = await fetch(url, { cache: 'no-store' });
+  if (!res.ok) throw new Error(res.status);
+  return res.json();
+}
+
+async function poll() {
+  try {
+    const data = await getJson('/getData');
+    for (const [key, digits] of Object.entries(FIELDS)) {
+      if (key in data) $(key).textContent = Number(data[key]).toFixed(digits);
+    }
+    const stats = await getJson('/getStats');
+    const table = $('device');
+    table.replaceChildren(
+      row('IP', data.ip),
+      row('MAC', data.mac),
+      row('RSSI', data.rssi + ' dBm'),
+      row('Время работы', Math.round(stats.uptime_ms / 60000) + ' мин'),
+      row('Свободно памяти', stats.memory.free_heap + ' байт'),
+      row('Отправка', stats.telemetry.transport + ', в очереди ' + stats.telemetry.pending),
+    );
+    setStatus(true);
+  } catch (e) {
+    setStatus(false);
+  }
+  setTimeout(poll, POLL_MS);
+}
+
+// Команды уходят одним пакетом /control; результат проверяется через /result
+$('control').addEventListener('submit', async (event) => {
+  event.preventDefault();
+  const form = event.target;
+  const body = {
+    mode: form.mode.value,
+    lcd: [form.line1.value || null, form.line2.value || null],
+    led: form.led.checked ? 1 : 0,
+  };
+  const result = $('result');
+  try {
+    const res = await fetch('/control', { method: 'POST', body: JSON.stringify(body) });
+    if (!res.ok) throw new Error(await res.text());
+    const { id } = await res.json();
+    result.textContent = 'отправлено';
+    setTimeout(async () => {
+      const state = await getJson('/result?id=' + id);
+      result.textContent = state.state === 'done' ? 'применено' : state.state;
+    }, 500);
+  } catch (e) {
+    result.textContent = 'ошибка: ' + e.message;
+  }
+});
+
+poll();